@@ -1,4 +1,10 @@
+#include <atomic>
+#include <map>
+#include <set>
+#include <tuple>
+
 #include "find2_index_approx.hpp"
+#include "locations.hpp"
 
 using namespace seqan;
 
@@ -16,17 +22,233 @@ void resetLimits(TMappVector & c, unsigned const kmerLength, TCumChromLengths co
         // std::min(): make sure that we don't mess up if a sequence is shorter than K
         for (uint64_t j = 1; j < std::min<uint64_t>(kmerLength, cumChromLengths[i] - cumChromLengths[i - 1] + 1); ++j)
         {
-            c[cumChromLengths[i] - j] = 0;
+            storeFrequency(c, cumChromLengths[i] - j, 0);
         }
     }
 }
 
+// Frequencies are written by multiple threads concurrently, e.g., to all occurrences of an exact repeat by whichever
+// thread computes one of them first, while other threads check whether a position has already been computed. Since the
+// frequency only depends on the k-mer, all writers of a position store the same value. Hence, relaxed atomic accesses
+// suffice to make this race-free and the result is identical for any number of threads.
+template <typename TContainer>
+inline typename TContainer::value_type loadFrequency(TContainer const & c, uint64_t const pos)
+{
+    return __atomic_load_n(&c[pos], __ATOMIC_RELAXED);
+}
+
+// Frequencies are computed with 32 bits and saturated to the value type of c when stored.
+template <typename TContainer>
+inline void storeFrequency(TContainer & c, uint64_t const pos, uint32_t const value)
+{
+    typedef typename TContainer::value_type TValue;
+    __atomic_store_n(&c[pos], static_cast<TValue>(std::min<uint32_t>(value, std::numeric_limits<TValue>::max())), __ATOMIC_RELAXED);
+}
+
+// Largest frequency that storeFrequency() stores without saturating it.
+template <typename TContainer>
+inline uint32_t maxStoredFrequency(TContainer const & /*c*/)
+{
+    return std::numeric_limits<typename TContainer::value_type>::max();
+}
+
+// Copies a frequency to an exact occurrence of the k-mer given by its position in the indexed text. c only covers the
+// text, which can be a window of the chromosomes of a fasta file (see --window-size). Occurrences outside of the window
+// are skipped, their frequencies are computed when their own window is processed.
+template <typename TContainer, typename TText>
+inline void copyFrequency(TContainer & c, TText const & text, uint64_t const globalPos, uint32_t const value)
+{
+    uint64_t const pos = globalPos - beginPosition(text); // wraps around for occurrences in front of the window
+    if (pos < c.size())
+        storeFrequency(c, pos, value);
+}
+
+// Indices built with --double-strand contain the reverse complement of each of the n sequences, i.e., sequence n + s is
+// the reverse complement of sequence s. An occurrence of a k-mer on sequence n + s is an occurrence of its reverse
+// complement on sequence s, which has the same frequency.
+template <typename TOcc, typename TLimits>
+inline bool isReverseStrand(TOcc const & occ, TLimits const & limits)
+{
+    return occ.i1 >= (length(limits) - 1) / 2;
+}
+
+// Returns the occurrence of the reverse complement on the forward strand. Requires a double-strand index.
+template <typename TOcc, typename TLimits>
+inline TOcc forwardStrandOccurrence(TOcc occ, TLimits const & limits, uint64_t const kmerLength)
+{
+    uint64_t const nbrSequences = (length(limits) - 1) / 2;
+    if (occ.i1 >= nbrSequences)
+    {
+        occ.i1 -= nbrSequences;
+        occ.i2 = limits[occ.i1 + 1] - limits[occ.i1] - occ.i2 - kmerLength;
+    }
+    return occ;
+}
+
+// Position in the text (forward strand) to which the frequency of an exact occurrence is copied.
+template <typename TOcc, typename TLimits>
+inline uint64_t forwardPosGlobalize(TOcc const & occ, TLimits const & limits, SearchParams const & params)
+{
+    return posGlobalize(params.doubleStrand ? forwardStrandOccurrence(occ, limits, params.length) : occ, limits);
+}
+
+// Identifier of the repeat class of a k-mer for the deduplicated csv output (--csv-classes). All k-mers with the same
+// exact SA interval have the same locations. K-mers without an exact occurrence (i.e., containing N) are a class of
+// their own.
+template <typename TFwdIter>
+inline uint64_t repeatClass(TFwdIter const & itExact, bool const exactMatch, uint64_t const pos)
+{
+    if (!exactMatch)
+        return (static_cast<uint64_t>(1) << 63) | pos;
+    return 2 * value(itExact).range.i1;
+}
+
+// Repeat class of a k-mer in a double-strand index. Its reverse complement has the same locations with swapped strands,
+// hence both share the smaller of their SA intervals: the class of the k-mer with the smaller interval is 2 * i1, the
+// other one has the odd class 2 * i1 + 1 (swapped strands). A position thus gets the same class from the search of its
+// own k-mer and from the search of the reverse complement.
+template <typename TFwdIter>
+inline uint64_t repeatClass(TFwdIter const & itExact, TFwdIter const & itExactRevCompl)
+{
+    uint64_t const i1 = value(itExact).range.i1;
+    uint64_t const i1RevCompl = value(itExactRevCompl).range.i1;
+    return 2 * std::min(i1, i1RevCompl) + (i1RevCompl < i1);
+}
+
+// Delegate of _optimalSearchSchemeGM() that ends the search as soon as done() holds after a reported match, e.g., once
+// the frequencies of all k-mers of a block have reached --max-frequency.
+template <typename TDelegate, typename TDone>
+struct StoppableDelegate
+{
+    TDelegate & delegate;
+    TDone & done;
+    bool stop;
+
+    template <typename... TArgs>
+    void operator()(TArgs &&... args)
+    {
+        delegate(std::forward<TArgs>(args)...);
+        stop = done();
+    }
+};
+
+template <typename TDelegate, typename TDone>
+inline bool _optimalSearchSchemeStopGM(StoppableDelegate<TDelegate, TDone> const & delegate)
+{
+    return delegate.stop;
+}
+
+// Searches the reverse complement of the k-mer starting at pos without errors. Sets itExactRevCompl and returns true if
+// it occurs.
+template <typename TBiIter, typename TIndex, typename TText>
+inline bool exactRevComplInterval(TIndex & index, TText const & text, uint64_t const pos, unsigned const length,
+                                  typename TBiIter::TFwdIndexIter & itExactRevCompl)
+{
+    typedef typename Value<TText>::Type TChar;
+    constexpr bool isDna5 = std::is_same<TChar, Dna5>::value;
+
+    // the reverse complement of text[pos..i] is extended to the left by the complement of text[i]
+    FunctorComplement<TChar> complement;
+    TBiIter itRevCompl(index);
+    for (uint64_t i = pos; i < pos + length; ++i)
+    {
+        if ((isDna5 && text[i] == Dna5('N')) || !goDown(itRevCompl, complement(text[i]), Fwd()))
+            return false;
+    }
+    itExactRevCompl = itRevCompl.fwdIter;
+    return true;
+}
+
+// Number of exact occurrences of the k-mer starting at pos (and of its reverse complement), i.e., a lower bound of its
+// frequency with errors. Sets itExact if the k-mer occurs (it does not if it contains an N).
+template <typename TBiIter, typename TIndex, typename TText>
+inline uint64_t exactFrequency(TIndex & index, TText const & text, uint64_t const pos, unsigned const length,
+                               bool const revCompl, typename TBiIter::TFwdIndexIter & itExact)
+{
+    typedef typename Value<TText>::Type TChar;
+    constexpr bool isDna5 = std::is_same<TChar, Dna5>::value;
+
+    TBiIter it(index);
+    for (uint64_t i = pos; i < pos + length; ++i)
+    {
+        if ((isDna5 && text[i] == Dna5('N')) || !goDown(it, text[i], Rev()))
+            return 0;
+    }
+    itExact = it.fwdIter;
+    uint64_t count = countOccurrences(it);
+
+    typename TBiIter::TFwdIndexIter itRevCompl;
+    if (revCompl && exactRevComplInterval<TBiIter>(index, text, pos, length, itRevCompl))
+        count += countOccurrences(itRevCompl);
+    return count;
+}
+
+// Lean state of the extension of a search scheme hit (extend(), approxSearch(), extendExact()). Instead of a
+// bidirectional iterator (the iterators of both directions with the index pointers and parent intervals) only the SA
+// intervals of both directions and the depth are copied at each recursion level. Steps are taken by a single cursor per
+// hit that holds the index. Children are enumerated by their character, i.e., parent intervals are not needed.
+template <typename TBiIter>
+class BiSearchCursor
+{
+public:
+    typedef typename TBiIter::TFwdIndexIter TFwdIter;
+    typedef typename std::decay<decltype(value(std::declval<TFwdIter &>()))>::type TVertexDesc;
+
+    struct State
+    {
+        decltype(TVertexDesc::range) fwdRange;
+        decltype(TVertexDesc::range) revRange;
+        decltype(TVertexDesc::repLen) depth;
+    };
+
+    explicit BiSearchCursor(TBiIter const & it) : it(it)
+    {}
+
+    State state() const
+    {
+        return {value(it.fwdIter).range, value(it.revIter).range, value(it.fwdIter).repLen};
+    }
+
+    template <typename TChar, typename TDirection>
+    bool goDown(State & s, TChar const c, TDirection const &)
+    {
+        load(s);
+        if (!seqan::goDown(it, c, TDirection()))
+            return false;
+        s = state();
+        return true;
+    }
+
+    uint64_t count(State const & s)
+    {
+        load(s);
+        return countOccurrences(it);
+    }
+
+    TFwdIter const & fwdIter(State const & s)
+    {
+        load(s);
+        return it.fwdIter;
+    }
+
+private:
+    TBiIter it;
+
+    void load(State const & s)
+    {
+        value(it.fwdIter).range = s.fwdRange;
+        value(it.fwdIter).repLen = s.depth;
+        value(it.revIter).range = s.revRange;
+        value(it.revIter).repLen = s.depth;
+    }
+};
+
 // TODO: avoid signed integers
 
-template <bool reportExactMatch, unsigned maxErrors, typename TBiIter, typename TValue, typename TText>
-inline void extendExact(TBiIter it, std::vector<TValue> & hits, std::vector<typename TBiIter::TFwdIndexIter> & itExact,
-                        std::vector<std::vector<typename TBiIter::TFwdIndexIter> > & itAll,
-                        TText const & text, unsigned const length,
+template <bool reportExactMatch, typename TCursor, typename TValue, typename TText>
+inline void extendExact(TCursor & cursor, typename TCursor::State s, std::vector<TValue> & hits, std::vector<typename TCursor::TFwdIter> & itExact,
+                        std::vector<std::vector<typename TCursor::TFwdIter> > & itAll,
+                        unsigned const maxErrors, TText const & text, unsigned const length,
                         uint64_t a, uint64_t b, // searched interval
                         uint64_t ab, uint64_t bb, // entire interval
                         bool const csvComputation)
@@ -37,20 +259,21 @@ inline void extendExact(TBiIter it, std::vector<TValue> & hits, std::vector<type
 
     if (b - a + 1 == length)
     {
-        SEQAN_IF_CONSTEXPR (reportExactMatch && maxErrors == 0)
+        SEQAN_IF_CONSTEXPR (reportExactMatch)
         {
-            itExact[a-ab] = it.fwdIter;
+            if (maxErrors == 0)
+                itExact[a-ab] = cursor.fwdIter(s);
         }
         if (csvComputation)
         {
-            itAll[a-ab].push_back(it.fwdIter);
+            itAll[a-ab].push_back(cursor.fwdIter(s));
         }
-        hits[a-ab] = std::min((uint64_t) countOccurrences(it) + hits[a-ab], max_val);
+        hits[a-ab] = std::min(cursor.count(s) + hits[a-ab], max_val);
         return;
     }
     //if (b + 1 <= bb)
     //{
-        TBiIter it2 = it;
+        typename TCursor::State s2 = s;
         uint64_t brm = a + length - 1;
         uint64_t b_new = b + (((brm - b) + 2 - 1) >> 1); // ceil((bb - b)/2)
         if (b_new <= bb)
@@ -58,10 +281,10 @@ inline void extendExact(TBiIter it, std::vector<TValue> & hits, std::vector<type
             bool success = true;
             for (uint64_t i = b + 1; i <= b_new && success; ++i)
             {
-                success = (!isDna5 || text[i] != Dna5('N')) && goDown(it2, text[i], Rev());
+                success = (!isDna5 || text[i] != Dna5('N')) && cursor.goDown(s2, text[i], Rev());
             }
             if (success)
-                extendExact<reportExactMatch, maxErrors>(it2, hits, itExact, itAll, text, length, a, b_new, ab, bb, csvComputation);
+                extendExact<reportExactMatch>(cursor, s2, hits, itExact, itAll, maxErrors, text, length, a, b_new, ab, bb, csvComputation);
         }
     //}
 
@@ -71,101 +294,107 @@ inline void extendExact(TBiIter it, std::vector<TValue> & hits, std::vector<type
         uint64_t a_new = alm + std::max<int64_t>(((a - alm) - 1) >> 1, 0);
         for (int64_t i = a - 1; i >= static_cast<int64_t>(a_new); --i)
         {
-            if((isDna5 && text[i] == Dna5('N')) || !goDown(it, text[i], Fwd()))
+            if((isDna5 && text[i] == Dna5('N')) || !cursor.goDown(s, text[i], Fwd()))
                 return;
         }
-        extendExact<reportExactMatch, maxErrors>(it, hits, itExact, itAll, text, length, a_new, b, ab, bb, csvComputation);
+        extendExact<reportExactMatch>(cursor, s, hits, itExact, itAll, maxErrors, text, length, a_new, b, ab, bb, csvComputation);
     }
 }
 
 // forward
-template <bool reportExactMatch, unsigned maxErrors, typename TBiIter, typename TValue, typename TText>
-inline void extend(TBiIter it, std::vector<TValue> & hits, std::vector<typename TBiIter::TFwdIndexIter> & itExact,
-                   std::vector<std::vector<typename TBiIter::TFwdIndexIter> > & itAll,
-                   unsigned errorsLeft, TText const & text, unsigned const length,
+template <bool reportExactMatch, typename TCursor, typename TValue, typename TText>
+inline void extend(TCursor & cursor, typename TCursor::State const & s, std::vector<TValue> & hits, std::vector<typename TCursor::TFwdIter> & itExact,
+                   std::vector<std::vector<typename TCursor::TFwdIter> > & itAll,
+                   unsigned const maxErrors, unsigned errorsLeft, TText const & text, unsigned const length,
                    uint64_t a, uint64_t b, // searched interval
                    uint64_t ab, uint64_t bb, // entire interval
                    bool const csvComputation);
 
-template <bool reportExactMatch, unsigned maxErrors, typename TBiIter, typename TValue, typename TText>
-inline void approxSearch(TBiIter it, std::vector<TValue> & hits, std::vector<typename TBiIter::TFwdIndexIter> & itExact,
-                         std::vector<std::vector<typename TBiIter::TFwdIndexIter> > & itAll,
-                         unsigned errorsLeft, TText const & text, unsigned const length,
+template <bool reportExactMatch, typename TCursor, typename TValue, typename TText>
+inline void approxSearch(TCursor & cursor, typename TCursor::State s, std::vector<TValue> & hits, std::vector<typename TCursor::TFwdIter> & itExact,
+                         std::vector<std::vector<typename TCursor::TFwdIter> > & itAll,
+                         unsigned const maxErrors, unsigned errorsLeft, TText const & text, unsigned const length,
                          uint64_t a, uint64_t b, // searched interval
                          uint64_t ab, uint64_t bb, // entire interval
                          uint64_t b_new,
                          Rev const &, bool const csvComputation)
 {
-    constexpr bool isDna5 = std::is_same<typename Value<TText>::Type, Dna5>::value;
+    typedef typename Value<TText>::Type TChar;
+    constexpr bool isDna5 = std::is_same<TChar, Dna5>::value;
 
     if (b == b_new)
     {
-        extend<reportExactMatch, maxErrors>(it, hits, itExact, itAll, errorsLeft, text, length, a, b, ab, bb, csvComputation);
+        extend<reportExactMatch>(cursor, s, hits, itExact, itAll, maxErrors, errorsLeft, text, length, a, b, ab, bb, csvComputation);
         return;
     }
     if (errorsLeft > 0)
     {
-        if (goDown(it, Rev()))
+        for (unsigned c = 0; c < ValueSize<TChar>::VALUE; ++c)
         {
-            do {
-                bool delta = !ordEqual(parentEdgeLabel(it, Rev()), text[b + 1])
+            typename TCursor::State child = s;
+            if (cursor.goDown(child, TChar(c), Rev()))
+            {
+                bool delta = c != ordValue(text[b + 1])
                              || (isDna5 && text[b + 1] == Dna5('N'));
-                approxSearch<reportExactMatch, maxErrors>(it, hits, itExact, itAll, errorsLeft - delta, text, length, a, b + 1, ab, bb, b_new, Rev(), csvComputation);
-            } while (goRight(it, Rev()));
+                approxSearch<reportExactMatch>(cursor, child, hits, itExact, itAll, maxErrors, errorsLeft - delta, text, length, a, b + 1, ab, bb, b_new, Rev(), csvComputation);
+            }
         }
     }
     else
     {
         for (uint64_t i = b + 1; i <= b_new; ++i)
         {
-            if ((isDna5 && text[i] == Dna5('N')) || !goDown(it, text[i], Rev()))
+            if ((isDna5 && text[i] == Dna5('N')) || !cursor.goDown(s, text[i], Rev()))
                 return;
         }
-        extendExact<reportExactMatch, maxErrors>(it, hits, itExact, itAll, text, length, a, b_new, ab, bb, csvComputation);
+        extendExact<reportExactMatch>(cursor, s, hits, itExact, itAll, maxErrors, text, length, a, b_new, ab, bb, csvComputation);
     }
 }
-template <bool reportExactMatch, unsigned maxErrors, typename TBiIter, typename TValue, typename TText>
-inline void approxSearch(TBiIter it, std::vector<TValue> & hits, std::vector<typename TBiIter::TFwdIndexIter> & itExact,
-                         std::vector<std::vector<typename TBiIter::TFwdIndexIter> > & itAll,
-                         unsigned errorsLeft, TText const & text, unsigned const length,
+template <bool reportExactMatch, typename TCursor, typename TValue, typename TText>
+inline void approxSearch(TCursor & cursor, typename TCursor::State s, std::vector<TValue> & hits, std::vector<typename TCursor::TFwdIter> & itExact,
+                         std::vector<std::vector<typename TCursor::TFwdIter> > & itAll,
+                         unsigned const maxErrors, unsigned errorsLeft, TText const & text, unsigned const length,
                          uint64_t a, uint64_t b, // searched interval
                          uint64_t ab, uint64_t bb, // entire interval
                          uint64_t a_new,
                          Fwd const & /*tag*/, bool const csvComputation)
 {
-    constexpr bool isDna5 = std::is_same<typename Value<TText>::Type, Dna5>::value;
+    typedef typename Value<TText>::Type TChar;
+    constexpr bool isDna5 = std::is_same<TChar, Dna5>::value;
 
     if (a == a_new)
     {
-        extend<reportExactMatch, maxErrors>(it, hits, itExact, itAll, errorsLeft, text, length, a, b, ab, bb, csvComputation);
+        extend<reportExactMatch>(cursor, s, hits, itExact, itAll, maxErrors, errorsLeft, text, length, a, b, ab, bb, csvComputation);
         return;
     }
     if (errorsLeft > 0)
     {
-        if (goDown(it, Fwd()))
+        for (unsigned c = 0; c < ValueSize<TChar>::VALUE; ++c)
         {
-            do {
-                bool delta = !ordEqual(parentEdgeLabel(it, Fwd()), text[a - 1])
+            typename TCursor::State child = s;
+            if (cursor.goDown(child, TChar(c), Fwd()))
+            {
+                bool delta = c != ordValue(text[a - 1])
                              || (isDna5 && text[a - 1] == Dna5('N'));
-                approxSearch<reportExactMatch, maxErrors>(it, hits, itExact, itAll, errorsLeft - delta, text, length, a - 1, b, ab, bb, a_new, Fwd(), csvComputation);
-            } while (goRight(it, Fwd()));
+                approxSearch<reportExactMatch>(cursor, child, hits, itExact, itAll, maxErrors, errorsLeft - delta, text, length, a - 1, b, ab, bb, a_new, Fwd(), csvComputation);
+            }
         }
     }
     else
     {
         for (int64_t i = a - 1; i >= static_cast<int64_t>(a_new); --i)
         {
-            if ((isDna5 && text[i] == Dna5('N')) || !goDown(it, text[i], Fwd()))
+            if ((isDna5 && text[i] == Dna5('N')) || !cursor.goDown(s, text[i], Fwd()))
                 return;
         }
-        extendExact<reportExactMatch, maxErrors>(it, hits, itExact, itAll, text, length, a_new, b, ab, bb, csvComputation);
+        extendExact<reportExactMatch>(cursor, s, hits, itExact, itAll, maxErrors, text, length, a_new, b, ab, bb, csvComputation);
     }
 }
 
-template <bool reportExactMatch, unsigned maxErrors, typename TBiIter, typename TValue, typename TText>
-inline void extend(TBiIter it, std::vector<TValue> & hits, std::vector<typename TBiIter::TFwdIndexIter> & itExact,
-                   std::vector<std::vector<typename TBiIter::TFwdIndexIter> > & itAll,
-                   unsigned errorsLeft, TText const & text, unsigned const length,
+template <bool reportExactMatch, typename TCursor, typename TValue, typename TText>
+inline void extend(TCursor & cursor, typename TCursor::State const & s, std::vector<TValue> & hits, std::vector<typename TCursor::TFwdIter> & itExact,
+                   std::vector<std::vector<typename TCursor::TFwdIter> > & itAll,
+                   unsigned const maxErrors, unsigned errorsLeft, TText const & text, unsigned const length,
                    uint64_t a, uint64_t b, // searched interval
                    uint64_t ab, uint64_t bb, // entire interval
                    bool const csvComputation)
@@ -174,7 +403,7 @@ inline void extend(TBiIter it, std::vector<TValue> & hits, std::vector<typename
 
     if (errorsLeft == 0)
     {
-        extendExact<reportExactMatch, maxErrors>(it, hits, itExact, itAll, text, length, a, b, ab, bb, csvComputation);
+        extendExact<reportExactMatch>(cursor, s, hits, itExact, itAll, maxErrors, text, length, a, b, ab, bb, csvComputation);
         return;
     }
     if (b - a + 1 == length)
@@ -182,13 +411,13 @@ inline void extend(TBiIter it, std::vector<TValue> & hits, std::vector<typename
         SEQAN_IF_CONSTEXPR (reportExactMatch)
         {
             if (maxErrors == errorsLeft)
-                itExact[a-ab] = it.fwdIter;
+                itExact[a-ab] = cursor.fwdIter(s);
         }
         if (csvComputation)
         {
-            itAll[a-ab].push_back(it.fwdIter);
+            itAll[a-ab].push_back(cursor.fwdIter(s));
         }
-        hits[a-ab] = std::min((uint64_t) countOccurrences(it) + hits[a-ab], max_val);
+        hits[a-ab] = std::min(cursor.count(s) + hits[a-ab], max_val);
         return;
     }
     //if (b + 1 <= bb)
@@ -197,7 +426,7 @@ inline void extend(TBiIter it, std::vector<TValue> & hits, std::vector<typename
         uint64_t b_new = b + (((brm - b) + 2 - 1) >> 1); // ceil((bb - b)/2)
         if (b_new <= bb)
         {
-            approxSearch<reportExactMatch, maxErrors>(it, hits, itExact, itAll, errorsLeft, text, length,
+            approxSearch<reportExactMatch>(cursor, s, hits, itExact, itAll, maxErrors, errorsLeft, text, length,
                          a, b, // searched interval
                          ab, bb, // entire interval
                          b_new,
@@ -209,7 +438,7 @@ inline void extend(TBiIter it, std::vector<TValue> & hits, std::vector<typename
     {
         int64_t alm = b + 1 - length;
         uint64_t a_new = alm + std::max<int64_t>(((a - alm) - 1) >> 1, 0);
-        approxSearch<reportExactMatch, maxErrors>(it, hits, itExact, itAll, errorsLeft, text, length,
+        approxSearch<reportExactMatch>(cursor, s, hits, itExact, itAll, maxErrors, errorsLeft, text, length,
                      a, b, // searched interval
                      ab, bb, // entire interval
                      a_new,
@@ -217,14 +446,102 @@ inline void extend(TBiIter it, std::vector<TValue> & hits, std::vector<typename
     }
 }
 
-// computes a block of adjacent k-mers at once
-template <unsigned errors, typename TIndex, typename TText, typename TContainer, typename TChromosomeLengths, typename TLocations, typename TMapping, typename TLimits>
-inline void computeMappabilitySingleBlock(TIndex & index, TText const & text, TContainer & c, SearchParams const & params,
+// Copies of search schemes with the block lengths set for each needle length, i.e., for each overlap of the blocks of
+// computeMappabilitySingleBlock() resp. the k-mer length in computeMappabilityEditBlock(). Schemes are identified by
+// their address, i.e., the cache must not outlive them.
+template <typename TSearchScheme>
+struct SearchSchemeCache
+{
+    struct Entry
+    {
+        TSearchScheme const * searchScheme;
+        std::vector<TSearchScheme> schemes; // schemes[needleLength]
+        std::vector<bool> computed;
+    };
+    std::vector<Entry> entries;
+
+    TSearchScheme const & get(TSearchScheme const & searchScheme, uint32_t const needleLength)
+    {
+        auto entry = std::find_if(entries.begin(), entries.end(), [&searchScheme](Entry const & e) {
+            return e.searchScheme == &searchScheme;
+        });
+        if (entry == entries.end())
+        {
+            entries.push_back({&searchScheme, {}, {}});
+            entry = entries.end() - 1;
+        }
+
+        if (needleLength >= entry->schemes.size())
+        {
+            entry->schemes.resize(needleLength + 1, searchScheme);
+            entry->computed.resize(needleLength + 1, false);
+        }
+        if (!entry->computed[needleLength])
+        {
+            _optimalSearchSchemeComputeFixedBlocklengthGM(entry->schemes[needleLength], needleLength);
+            entry->computed[needleLength] = true;
+        }
+        return entry->schemes[needleLength];
+    }
+};
+
+// Buffers of computeMappabilitySingleBlock() and computeMappabilityEditBlock() that are reused by all blocks a thread
+// computes, i.e., only the first blocks allocate memory. There is one per thread (indexed by omp_get_thread_num()), the
+// kernels do not contain any task scheduling points, i.e., a thread never computes two blocks at once.
+template <typename TFwdIter, typename TLocation>
+struct BlockBuffers
+{
+    std::vector<TFwdIter> itExact;
+    std::vector<uint32_t> hits; // saturated to the value type of c when stored
+    std::vector<std::vector<TFwdIter> > itAll;         // only used for the csv output
+    std::vector<std::vector<TFwdIter> > itAllrevCompl;
+
+    // computeMappabilityEditBlock(): alignments and distinct occurrences of the current k-mer on each strand
+    std::vector<TFwdIter> itEdit, itEditRevCompl;
+    std::vector<TLocation> occs, occsRevCompl;
+    std::set<std::pair<unsigned, uint64_t> > editIntervals; // (repLen, SA interval begin) of the alignments found so far
+    std::map<unsigned, uint64_t> editLengthCounts;          // number of occurrences of these intervals by repLen
+
+    std::tuple<SearchSchemeCache<std::remove_const_t<decltype(OptimalSearchSchemesGM<0>::VALUE)> >,
+               SearchSchemeCache<std::remove_const_t<decltype(OptimalSearchSchemesGM<1>::VALUE)> >,
+               SearchSchemeCache<std::remove_const_t<decltype(OptimalSearchSchemesGM<2>::VALUE)> >,
+               SearchSchemeCache<std::remove_const_t<decltype(OptimalSearchSchemesGM<3>::VALUE)> >,
+               SearchSchemeCache<std::remove_const_t<decltype(OptimalSearchSchemesGM<4>::VALUE)> >,
+               SearchSchemeCache<std::vector<OptimalSearchDynGM> > > searchSchemes;
+
+    template <typename TSearchScheme>
+    TSearchScheme const & searchScheme(TSearchScheme const & searchScheme, uint32_t const needleLength)
+    {
+        return std::get<SearchSchemeCache<TSearchScheme> >(searchSchemes).get(searchScheme, needleLength);
+    }
+
+    void reset(uint64_t const nbrKmers, bool const csvComputation)
+    {
+        itExact.assign(nbrKmers, TFwdIter());
+        hits.assign(nbrKmers, 0);
+        if (csvComputation)
+        {
+            // the inner vectors keep their memory as well
+            for (auto * its : {&itAll, &itAllrevCompl})
+            {
+                if (its->size() < nbrKmers)
+                    its->resize(nbrKmers);
+                for (uint64_t k = 0; k < nbrKmers; ++k)
+                    (*its)[k].clear();
+            }
+        }
+    }
+};
+
+// computes a block of adjacent k-mers at once. searchScheme is the search scheme for params.errors errors (block lengths
+// are set for each block, see BlockBuffers::searchScheme())
+template <typename TSearchScheme, typename TIndex, typename TText, typename TContainer, typename TChromosomeLengths, typename TLocations, typename TMapping, typename TLimits>
+inline void computeMappabilitySingleBlock(TIndex & index, TText const & text, TContainer & c, SearchParams const & params, TSearchScheme const & searchScheme,
                                           bool const directory, TChromosomeLengths const & chromLengths, TLocations & locations, TMapping const & mappingSeqIdFile,
                                           uint64_t const i, uint64_t const j, uint64_t const textLength, TChromosomeLengths const & chromCumLengths, TLimits const & limits,
-                                          std::vector<std::pair<uint64_t, uint64_t>> const & intervals, unsigned const overlap, bool const completeSameKmers, bool const csvComputation)
+                                          std::vector<std::pair<uint64_t, uint64_t>> const & intervals, unsigned const overlap, bool const completeSameKmers, bool const csvComputation,
+                                          BlockBuffers<typename Iter<TIndex, VSTree<TopDown<> > >::TFwdIndexIter, typename TLocations::key_type> & buffers)
 {
-    typedef typename TContainer::value_type TValue;
     typedef Iter<TIndex, VSTree<TopDown<> > > TBiIter;
 
     // overlap is the length of the infix!
@@ -234,24 +551,45 @@ inline void computeMappabilitySingleBlock(TIndex & index, TText const & text, TC
 
     // Skip leading and trailing precomputed k-mer frequencies
     uint64_t beginPos = i;
-    while (beginPos < maxPos && c[beginPos] != 0)
+    while (beginPos < maxPos && loadFrequency(c, beginPos) != 0)
         ++beginPos;
 
     uint64_t endPos = maxPos; // endPos is excluding, i.e. [beginPos, endPos)
-    while (i > 0 && endPos - 1 >= i && c[endPos - 1] != 0) // we do not check for i == 0 to avoid an underflow.
+    while (i > 0 && endPos - 1 >= i && loadFrequency(c, endPos - 1) != 0) // we do not check for i == 0 to avoid an underflow.
         --endPos;
 
     if (beginPos < endPos)
     {
         uint64_t overlap = params.length - (endPos - beginPos) + 1;
 
-        auto scheme = OptimalSearchSchemesGM<errors>::VALUE;
-        _optimalSearchSchemeComputeFixedBlocklengthGM(scheme, overlap);
+        unsigned const errors = params.errors;
+        TSearchScheme const & scheme = buffers.searchScheme(searchScheme, overlap);
 
-        std::vector<typename TBiIter::TFwdIndexIter> itExact(endPos - beginPos);
-        std::vector<TValue> hits(endPos - beginPos, 0);
-        std::vector<std::vector<typename TBiIter::TFwdIndexIter> > itAll(endPos - beginPos);
-        std::vector<std::vector<typename TBiIter::TFwdIndexIter> > itAllrevCompl(endPos - beginPos);
+        buffers.reset(endPos - beginPos, csvComputation);
+        auto & itExact = buffers.itExact;
+        auto & hits = buffers.hits;
+        auto & itAll = buffers.itAll;
+        auto & itAllrevCompl = buffers.itAllrevCompl;
+
+        // --max-frequency: k-mers with enough exact occurrences are capped before searching with errors and the search
+        // ends as soon as all k-mers of the block are capped (hits of the reverse complement are stored in reversed
+        // order, see below)
+        uint64_t const nbrKmers = endPos - beginPos;
+        if (params.maxFrequency != std::numeric_limits<uint32_t>::max() && errors > 0)
+        {
+            for (uint64_t k = 0; k < nbrKmers; ++k)
+            {
+                if (exactFrequency<TBiIter>(index, text, beginPos + k, params.length, params.revCompl, itExact[k]) >= params.maxFrequency)
+                    hits[params.revCompl ? nbrKmers - 1 - k : k] = params.maxFrequency;
+            }
+        }
+        uint64_t nbrCapped = 0; // hits[0, nbrCapped) are capped, hits only increase
+        auto allCapped = [&hits, &nbrCapped, &params]()
+        {
+            while (nbrCapped < hits.size() && hits[nbrCapped] >= params.maxFrequency)
+                ++nbrCapped;
+            return nbrCapped == hits.size();
+        };
 
         auto const & needles = infix(text, beginPos, beginPos + params.length + (endPos - beginPos) - 1);
         auto const & needlesOverlap = infix(text, beginPos + params.length - overlap, beginPos + params.length);
@@ -259,22 +597,23 @@ inline void computeMappabilitySingleBlock(TIndex & index, TText const & text, TC
 
         uint64_t const bb = std::min(textLength - 1, params.length - 1 + params.length - overlap);
 
-        auto delegate = [&hits, &itExact, &itAll, bb, overlap, &params, &needles, csvComputation](
+        auto delegate = [&hits, &itExact, &itAll, errors, bb, overlap, &params, &needles, csvComputation](
             TBiIter it, TNeedlesOverlap const & /*read*/, unsigned const errors_spent)
         {
             // TODO: we could turn reporting of exact iterators off at compile time by setting reportExactMatch = false if opt.directory is true. Evaluate binary size vs. performance.
             // WARNING: if it is computed on the directory, csvComputation currently still needs the exact matches (can be updated down below)
 
+            BiSearchCursor<TBiIter> cursor(it);
             if (errors_spent == 0)
             {
-                extend<true, errors>(it, hits, itExact, itAll, errors - errors_spent, needles, params.length,
+                extend<true>(cursor, cursor.state(), hits, itExact, itAll, errors, errors - errors_spent, needles, params.length,
                     params.length - overlap, params.length - 1, // searched interval
                     0, bb, // entire interval
                     csvComputation);
             }
             else
             {
-                extend<false, errors>(it, hits, itExact, itAll, errors - errors_spent, needles, params.length,
+                extend<false>(cursor, cursor.state(), hits, itExact, itAll, errors, errors - errors_spent, needles, params.length,
                     params.length - overlap, params.length - 1, // searched interval
                     0, bb, // entire interval
                     csvComputation);
@@ -288,24 +627,29 @@ inline void computeMappabilitySingleBlock(TIndex & index, TText const & text, TC
             using TNeedlesRevComplOverlap = decltype(needlesRevComplOverlap);
 
             // TODO: could store the exact hits as well and use these values!
-            auto delegateRevCompl = [&hits, &itExact, &itAllrevCompl, bb, overlap, &params, &needlesRevCompl, csvComputation](
+            auto delegateRevCompl = [&hits, &itExact, &itAllrevCompl, errors, bb, overlap, &params, &needlesRevCompl, csvComputation](
                 TBiIter it, TNeedlesRevComplOverlap const & /*read*/, unsigned const errors_spent)
             {
-                extend<false, errors>(it, hits, itExact, itAllrevCompl, errors - errors_spent, needlesRevCompl, params.length,
+                BiSearchCursor<TBiIter> cursor(it);
+                extend<false>(cursor, cursor.state(), hits, itExact, itAllrevCompl, errors, errors - errors_spent, needlesRevCompl, params.length,
                     params.length - overlap, params.length - 1, // searched interval
                     0, bb, // entire interval
                     csvComputation);
             };
 
             TBiIter it(index);
-            _optimalSearchSchemeGM(delegateRevCompl, it, needlesRevComplOverlap, scheme, HammingDistance());
+            StoppableDelegate<decltype(delegateRevCompl), decltype(allCapped)> stoppableRevCompl{delegateRevCompl, allCapped, allCapped()};
+            _optimalSearchSchemeGM(stoppableRevCompl, it, needlesRevComplOverlap, scheme, HammingDistance());
 
             // hits of the reverse-complement are stored in reversed order.
             std::reverse(hits.begin(), hits.end());
+            nbrCapped = 0;
         }
 
+        // without errors the exact iterators are only set by the search itself
         TBiIter it(index);
-        _optimalSearchSchemeGM(delegate, it, needlesOverlap, scheme, HammingDistance());
+        StoppableDelegate<decltype(delegate), decltype(allCapped)> stoppable{delegate, allCapped, errors > 0 && allCapped()};
+        _optimalSearchSchemeGM(stoppable, it, needlesOverlap, scheme, HammingDistance());
         for (uint64_t j = beginPos; j < endPos; ++j)
         {
             if (csvComputation)
@@ -329,7 +673,10 @@ inline void computeMappabilitySingleBlock(TIndex & index, TText const & text, TC
                 {
                     for (auto const & occ : getOccurrences(iterator))
                     {
-                        entry.second.first.push_back(occ);
+                        if (params.doubleStrand && isReverseStrand(occ, limits))
+                            entry.second.second.push_back(forwardStrandOccurrence(occ, limits, params.length));
+                        else
+                            entry.second.first.push_back(occ);
                     }
                 }
                 // sorting is needed for output when multiple fasta files are indexed and the locations need to be separated by filename.
@@ -363,14 +710,30 @@ inline void computeMappabilitySingleBlock(TIndex & index, TText const & text, TC
                     // (with respect to --exclude-pseudo) you can unset 'entry' here.
                 }
 
-                if (!directory && countOccurrences(itExact[j - beginPos]) > 1)
+                uint64_t const exactCount = countOccurrences(itExact[j - beginPos]);
+                // every k-mer of a double-strand index occurs on both strands, i.e., its reverse complement occurs too
+                typename TBiIter::TFwdIndexIter itExactRevCompl;
+                bool const canonicalClass = params.doubleStrand && exactCount > 0 &&
+                                            exactRevComplInterval<TBiIter>(index, text, j, params.length, itExactRevCompl);
+                uint64_t const kmerClass = canonicalClass ? repeatClass(itExact[j - beginPos], itExactRevCompl)
+                                                          : repeatClass(itExact[j - beginPos], exactCount > 0, j);
+                if (!directory && exactCount > 1)
                 {
+                    // the strands are swapped for the reverse complement
+                    decltype(entry.second) swappedEntry;
+                    if (params.doubleStrand)
+                        swappedEntry = std::make_pair(entry.second.second, entry.second.first);
+
                     for (auto const & exact_occ : getOccurrences(itExact[j - beginPos]))
                     {
-                        if (static_cast<int64_t>(exact_occ.i2) <= static_cast<int64_t>(chromLengths[exact_occ.i1]) - params.length)
+                        if (params.doubleStrand && isReverseStrand(exact_occ, limits))
+                        {
+                            insertLocation(locations, forwardStrandOccurrence(exact_occ, limits, params.length), swappedEntry,
+                                           repeatClass(itExactRevCompl, itExact[j - beginPos]));
+                        }
+                        else if (static_cast<int64_t>(exact_occ.i2) <= static_cast<int64_t>(chromLengths[exact_occ.i1]) - params.length)
                         {
-                            #pragma omp critical
-                            locations.emplace(exact_occ, entry.second);
+                            insertLocation(locations, exact_occ, entry.second, kmerClass);
                         }
                     }
                 }
@@ -380,8 +743,7 @@ inline void computeMappabilitySingleBlock(TIndex & index, TText const & text, TC
                     myPosLocalize(entry.first, j, chromCumLengths); // TODO: inefficient for read data sets
                     if (static_cast<int64_t>(entry.first.i2) <= static_cast<int64_t>(chromLengths[entry.first.i1]) - params.length)
                     {
-                        #pragma omp critical
-                        locations.emplace(entry);
+                        insertLocation(locations, entry.first, entry.second, kmerClass);
                     }
                 }
             }
@@ -390,94 +752,724 @@ inline void computeMappabilitySingleBlock(TIndex & index, TText const & text, TC
             {
                 for (auto const & occ : getOccurrences(itExact[j-beginPos]))
                 {
-                    auto const occ_pos = posGlobalize(occ, limits);
-                    c[occ_pos] = hits[j - beginPos];
+                    copyFrequency(c, text, forwardPosGlobalize(occ, limits, params), std::min(hits[j - beginPos], params.maxFrequency));
                 }
             }
             else
             {
-                c[j] = hits[j - beginPos];
+                storeFrequency(c, j, std::min(hits[j - beginPos], params.maxFrequency));
             }
         }
     }
 }
 
-template <unsigned errors, typename TIndex, typename TText, typename TContainer, typename TChromosomeLengths, typename TLocations, typename TMapping>
-inline void computeMappability(TIndex & index, TText const & text, TContainer & c, SearchParams const & params,
-                               bool const directory, TChromosomeLengths const & chromLengths, TChromosomeLengths const & chromCumLengths, TLocations & locations,
+// Computes the k-mers starting in [i, j) one after another with up to params.errors edits. Each k-mer is searched
+// entirely (the extension of overlapping k-mers in extend() only supports mismatches). The same occurrence can be found
+// by different alignments, hence occurrences are deduplicated by their begin position (separately for each strand).
+// Locating the occurrences takes time linear in their number for each k-mer, i.e., quadratic in the copy number of
+// approximate repeats. Hence, unless the locations are needed (csv output, --exclude-pseudo), the search of a k-mer ends
+// as soon as its frequency is known to reach --max-frequency or the largest value of c, and its occurrences are not
+// located at all (as --max-frequency in computeMappabilitySingleBlock()). K-mers with exact repeats are only computed
+// once if their frequency can be copied to all copies (see completeSameKmers), as in computeMappabilitySingleBlock().
+template <typename TSearchScheme, typename TIndex, typename TText, typename TContainer, typename TChromosomeLengths, typename TLocations, typename TMapping, typename TLimits>
+inline void computeMappabilityEditBlock(TIndex & index, TText const & text, TContainer & c, SearchParams const & params, TSearchScheme const & searchScheme,
+                                        bool const directory, TChromosomeLengths const & chromLengths, TLocations & locations, TMapping const & mappingSeqIdFile,
+                                        uint64_t const i, uint64_t const j, uint64_t const textLength, TChromosomeLengths const & chromCumLengths, TLimits const & limits,
+                                        bool const completeSameKmers, bool const csvComputation,
+                                        BlockBuffers<typename Iter<TIndex, VSTree<TopDown<> > >::TFwdIndexIter, typename TLocations::key_type> & buffers)
+{
+    typedef Iter<TIndex, VSTree<TopDown<> > > TBiIter;
+    typedef typename TBiIter::TFwdIndexIter TFwdIter;
+    typedef typename TLocations::key_type TLocation;
+
+    TSearchScheme const & scheme = buffers.searchScheme(searchScheme, params.length);
+
+    auto & itAll = buffers.itEdit;
+    auto & itAllRevCompl = buffers.itEditRevCompl;
+    auto & occs = buffers.occs;
+    auto & occsRevCompl = buffers.occsRevCompl;
+
+    auto collectOccurrences = [](std::vector<TLocation> & located, std::vector<TFwdIter> const & iterators)
+    {
+        located.clear();
+        for (auto const & iterator : iterators)
+        {
+            for (auto const & occ : getOccurrences(iterator))
+                located.push_back(occ);
+        }
+        std::sort(located.begin(), located.end());
+        located.erase(std::unique(located.begin(), located.end()), located.end());
+    };
+
+    // Alignments of the same length have disjoint SA intervals unless they are identical (the same occurrence found by
+    // different alignments). Hence the occurrences only have to be located and deduplicated by their begin positions if
+    // alignments of different lengths were found or the locations are needed anyway. Returns the number of distinct
+    // occurrences, located is only set if they were located.
+    auto countDistinctOccurrences = [&collectOccurrences](std::vector<TLocation> & located, std::vector<TFwdIter> & iterators, bool const locate)
+    {
+        auto key = [](TFwdIter const & it) { return std::make_tuple(value(it).repLen, value(it).range.i1, value(it).range.i2); };
+        std::sort(iterators.begin(), iterators.end(), [&key](TFwdIter const & a, TFwdIter const & b) { return key(a) < key(b); });
+        iterators.erase(std::unique(iterators.begin(), iterators.end(), [&key](TFwdIter const & a, TFwdIter const & b) {
+            return key(a) == key(b);
+        }), iterators.end());
+
+        if (!locate && (iterators.empty() || value(iterators.front()).repLen == value(iterators.back()).repLen))
+        {
+            located.clear();
+            uint64_t count = 0;
+            for (auto const & iterator : iterators)
+                count += countOccurrences(iterator);
+            return count;
+        }
+        collectOccurrences(located, iterators);
+        return static_cast<uint64_t>(located.size());
+    };
+
+    // The distinct alignments of the same length found so far on a strand are disjoint SA intervals, hence the largest
+    // number of their occurrences over all lengths is a lower bound of the distinct occurrences on this strand.
+    bool const locate = csvComputation || params.excludePseudo;
+    uint32_t const cap = std::min(params.maxFrequency, maxStoredFrequency(c));
+    bool const stoppable = !locate && cap != std::numeric_limits<uint32_t>::max();
+    uint64_t strandLowerBound = 0, lowerBound = 0; // lowerBound: of the strands searched before
+    auto addLowerBound = [&buffers, &strandLowerBound, stoppable](TFwdIter const & it)
+    {
+        if (stoppable && buffers.editIntervals.emplace(value(it).repLen, value(it).range.i1).second)
+        {
+            uint64_t & count = buffers.editLengthCounts[value(it).repLen];
+            count += countOccurrences(it);
+            strandLowerBound = std::max(strandLowerBound, count);
+        }
+    };
+    auto nextStrand = [&buffers, &strandLowerBound, &lowerBound]()
+    {
+        lowerBound += strandLowerBound;
+        strandLowerBound = 0;
+        buffers.editIntervals.clear();
+        buffers.editLengthCounts.clear();
+    };
+    auto capped = [&strandLowerBound, &lowerBound, cap, stoppable]()
+    {
+        return stoppable && lowerBound + strandLowerBound >= cap;
+    };
+
+    for (uint64_t pos = i; pos < j && pos + params.length <= textLength; ++pos)
+    {
+        if (loadFrequency(c, pos) != 0) // already computed by an exact occurrence of the same k-mer
+            continue;
+
+        auto const & needle = infix(text, pos, pos + params.length);
+        using TNeedle = decltype(needle);
+
+        TFwdIter itExact;
+        bool exactMatch = false;
+        itAll.clear();
+        itAllRevCompl.clear();
+        lowerBound = 0;
+
+        // --max-frequency: k-mers with enough exact occurrences are not searched with errors
+        if (params.maxFrequency != std::numeric_limits<uint32_t>::max() &&
+            exactFrequency<TBiIter>(index, text, pos, params.length, params.revCompl, itExact) >= params.maxFrequency)
+        {
+            if (!directory && countOccurrences(itExact) > 1 && completeSameKmers)
+            {
+                for (auto const & occ : getOccurrences(itExact))
+                    copyFrequency(c, text, posGlobalize(occ, limits), params.maxFrequency);
+            }
+            else
+            {
+                storeFrequency(c, pos, params.maxFrequency);
+            }
+            continue;
+        }
+
+        auto delegate = [&itAll, &itExact, &exactMatch, &addLowerBound](TBiIter it, TNeedle const & /*read*/, unsigned const errors_spent)
+        {
+            if (errors_spent == 0)
+            {
+                itExact = it.fwdIter;
+                exactMatch = true;
+            }
+            itAll.push_back(it.fwdIter);
+            addLowerBound(it.fwdIter);
+        };
+
+        TBiIter it(index);
+        StoppableDelegate<decltype(delegate), decltype(capped)> stoppableDelegate{delegate, capped, false};
+        _optimalSearchSchemeGM(stoppableDelegate, it, needle, scheme, EditDistance());
+        nextStrand();
+
+        if (params.revCompl && !capped())
+        {
+            ModRevCompl<typename std::remove_reference<TNeedle>::type> needleRevCompl(needle);
+            using TNeedleRevCompl = decltype(needleRevCompl);
+
+            auto delegateRevCompl = [&itAllRevCompl, &addLowerBound](TBiIter it, TNeedleRevCompl const & /*read*/, unsigned const /*errors_spent*/)
+            {
+                itAllRevCompl.push_back(it.fwdIter);
+                addLowerBound(it.fwdIter);
+            };
+
+            TBiIter itRevCompl(index);
+            StoppableDelegate<decltype(delegateRevCompl), decltype(capped)> stoppableRevCompl{delegateRevCompl, capped, false};
+            _optimalSearchSchemeGM(stoppableRevCompl, itRevCompl, needleRevCompl, scheme, EditDistance());
+            nextStrand();
+        }
+
+        // the search might have ended before all alignments (e.g., the exact one) were found
+        uint64_t hits = capped() ? cap : countDistinctOccurrences(occs, itAll, locate) + countDistinctOccurrences(occsRevCompl, itAllRevCompl, locate);
+        if (params.excludePseudo)
+        {
+            std::set<typename Value<TLocation, 1>::Type> distinct_sequences;
+            for (auto const & location : occs) // forward strand
+                distinct_sequences.emplace(mappingSeqIdFile[location.i1]);
+            for (auto const & location : occsRevCompl) // reverse strand
+                distinct_sequences.emplace(mappingSeqIdFile[location.i1]);
+            hits = distinct_sequences.size();
+        }
+
+        bool const copyToExactOccurrences = !directory && exactMatch && countOccurrences(itExact) > 1;
+
+        if (csvComputation)
+        {
+            std::pair<std::vector<TLocation>, std::vector<TLocation> > const entry(occs, occsRevCompl);
+            uint64_t const kmerClass = repeatClass(itExact, exactMatch, pos);
+
+            if (copyToExactOccurrences)
+            {
+                for (auto const & exact_occ : getOccurrences(itExact))
+                {
+                    if (static_cast<int64_t>(exact_occ.i2) <= static_cast<int64_t>(chromLengths[exact_occ.i1]) - params.length)
+                    {
+                        insertLocation(locations, exact_occ, entry, kmerClass);
+                    }
+                }
+            }
+            else if (entry.first.size() + entry.second.size() > 0)
+            {
+                TLocation location;
+                myPosLocalize(location, pos, chromCumLengths);
+                if (static_cast<int64_t>(location.i2) <= static_cast<int64_t>(chromLengths[location.i1]) - params.length)
+                {
+                    insertLocation(locations, location, entry, kmerClass);
+                }
+            }
+        }
+
+        uint32_t const value = std::min<uint64_t>(hits, params.maxFrequency);
+        if (completeSameKmers && copyToExactOccurrences)
+        {
+            for (auto const & occ : getOccurrences(itExact))
+                copyFrequency(c, text, posGlobalize(occ, limits), value);
+        }
+        else
+        {
+            storeFrequency(c, pos, value);
+        }
+    }
+}
+
+// Computes the frequencies of the k-mers starting in [i, j) for all combinations `ids` without errors at once (sorted
+// by K). The SA interval of a k-mer is an ancestor of the SA interval of every longer k-mer starting at the same
+// position, i.e., the frequencies of all k-mer lengths are obtained by a single descent per position and strand.
+template <typename TIndex, typename TText, typename TCombinations, typename TLimits>
+inline void computeMappabilityMultiKBlock(TIndex & index, TText const & text, TCombinations & combinations,
+                                          std::vector<uint64_t> const & ids, bool const directory,
+                                          uint64_t const i, uint64_t const j, uint64_t const textLength,
+                                          TLimits const & limits, bool const completeSameKmers, bool const revCompl)
+{
+    typedef typename Value<TText>::Type TChar;
+    typedef Iter<TIndex, VSTree<TopDown<> > > TBiIter;
+
+    constexpr bool isDna5 = std::is_same<TChar, Dna5>::value;
+
+    FunctorComplement<TChar> complement;
+    std::vector<typename TBiIter::TFwdIndexIter> itExact(ids.size());
+    std::vector<uint64_t> hits(ids.size()), hitsFwd(ids.size());
+
+    for (uint64_t pos = i; pos < j; ++pos)
+    {
+        // length of the longest k-mer at this position whose frequency has not been computed yet (e.g., by an
+        // earlier occurrence of the same k-mer)
+        uint64_t depth = 0;
+        for (uint64_t const id : ids)
+        {
+            if (pos + combinations[id].params.length <= textLength && loadFrequency(combinations[id].c, pos) == 0)
+                depth = combinations[id].params.length;
+        }
+        if (depth == 0)
+            continue;
+
+        std::fill(hitsFwd.begin(), hitsFwd.end(), 0);
+
+        TBiIter it(index);
+        for (uint64_t d = 1, k = 0; d <= depth; ++d)
+        {
+            if ((isDna5 && text[pos + d - 1] == Dna5('N')) || !goDown(it, text[pos + d - 1], Rev()))
+                break;
+            for (; k < ids.size() && combinations[ids[k]].params.length == d; ++k)
+            {
+                itExact[k] = it.fwdIter;
+                hitsFwd[k] = countOccurrences(it);
+            }
+        }
+        hits = hitsFwd;
+
+        // the reverse complement of text[pos..pos+d) is extended to the left by the complement of text[pos+d-1]
+        if (revCompl)
+        {
+            TBiIter itRevCompl(index);
+            for (uint64_t d = 1, k = 0; d <= depth; ++d)
+            {
+                if ((isDna5 && text[pos + d - 1] == Dna5('N')) || !goDown(itRevCompl, complement(text[pos + d - 1]), Fwd()))
+                    break;
+                for (; k < ids.size() && combinations[ids[k]].params.length == d; ++k)
+                    hits[k] += countOccurrences(itRevCompl);
+            }
+        }
+
+        for (uint64_t k = 0; k < ids.size(); ++k)
+        {
+            auto & c = combinations[ids[k]].c;
+            if (pos + combinations[ids[k]].params.length > textLength || loadFrequency(c, pos) != 0)
+                continue;
+
+            uint32_t const value = std::min<uint64_t>(hits[k], combinations[ids[k]].params.maxFrequency);
+            if (!directory && completeSameKmers && hitsFwd[k] > 1)
+            {
+                for (auto const & occ : getOccurrences(itExact[k]))
+                    copyFrequency(c, text, forwardPosGlobalize(occ, limits, combinations[ids[k]].params), value);
+            }
+            else
+            {
+                storeFrequency(c, pos, value);
+            }
+        }
+    }
+}
+
+// Returns the length of the common overlap (params.overlap) for which computeMappabilitySingleBlock() is the fastest on
+// randomly sampled regions of the text. The frequencies of the sampled regions are reset afterwards.
+template <typename TIndex, typename TText, typename TCombination, typename TSearchScheme, typename TChromosomeLengths, typename TMapping, typename TLimits>
+inline unsigned tuneOverlap(TIndex & index, TText const & text, TCombination & combination, TSearchScheme const & searchScheme,
+                            TChromosomeLengths const & chromLengths, TChromosomeLengths const & chromCumLengths,
+                            TMapping const & mappingSeqIdFile, TLimits const & limits)
+{
+    uint64_t const textLength = length(text);
+    SearchParams params = combination.params;
+    auto & c = combination.c;
+
+    uint64_t const regionLength = params.pilotRegionLength;
+    uint64_t const regions = std::max<uint64_t>(16, params.threads * 4);
+
+    // too small to gain anything from sampling
+    if (textLength < params.length + 100 * regions * regionLength)
+        return params.overlap;
+
+    // candidates for the common overlap: K - E - 2 >= O >= 0 (O = number of overlapping k-mers)
+    std::set<unsigned> candidates{params.overlap};
+    for (unsigned percent = 0; percent < 100; percent += 10)
+    {
+        unsigned const o = std::min<unsigned>(params.length * percent / 100, params.length - params.errors - 2);
+        candidates.insert(params.length - o);
+    }
+
+    std::mt19937_64 rng(textLength); // the choice only affects the running time
+    std::uniform_int_distribution<uint64_t> distr(0, textLength - params.length - regionLength);
+    std::vector<uint64_t> regionBegins(regions);
+    for (uint64_t & regionBegin : regionBegins)
+        regionBegin = distr(rng);
+
+    std::vector<std::pair<uint64_t, uint64_t> > const noIntervals;
+    std::vector<BlockBuffers<typename Iter<TIndex, VSTree<TopDown<> > >::TFwdIndexIter, typename TCombination::TLocation> > blockBuffers(params.threads);
+    unsigned bestOverlap = params.overlap;
+    double bestTime = std::numeric_limits<double>::max();
+    for (unsigned const overlap : candidates)
+    {
+        params.overlap = overlap;
+        uint64_t const stepSize = params.length - overlap + 1;
+
+        double const start = get_wall_time();
+        #pragma omp parallel for schedule(dynamic, 1) num_threads(params.threads)
+        for (uint64_t r = 0; r < regions; ++r)
+        {
+            // directory = true: frequencies are not copied to other occurrences outside of the sampled regions
+            for (uint64_t i = regionBegins[r]; i < regionBegins[r] + regionLength; i += stepSize)
+            {
+                computeMappabilitySingleBlock(index, text, c, params, searchScheme, true /*directory*/, chromLengths,
+                                              combination.locations, mappingSeqIdFile, i, i + stepSize, textLength,
+                                              chromCumLengths, limits, noIntervals, overlap, false, false /*csvComputation*/,
+                                              blockBuffers[omp_get_thread_num()]);
+            }
+        }
+        double const time = get_wall_time() - start;
+
+        if (time < bestTime)
+        {
+            bestTime = time;
+            bestOverlap = overlap;
+        }
+
+        for (uint64_t const regionBegin : regionBegins)
+        {
+            for (uint64_t pos = regionBegin; pos < regionBegin + regionLength + stepSize; ++pos)
+                storeFrequency(c, pos, 0);
+        }
+    }
+
+    return bestOverlap;
+}
+
+// Distributes the blocks of computeMappability() among the threads. Chunks of consecutive blocks are handed out in the
+// order of their estimated cost (expensive repeats first). Whenever threads are idle, a thread splits the remaining
+// blocks of its chunk, or the k-mers of its last block, in half and passes one half on as an OpenMP task (which is
+// picked up by an idle thread). Hence, at the end of a run no thread remains stuck in a repeat on its own.
+template <typename TBlockRange, typename TComputeKmers, typename TProgress>
+struct MappabilityScheduler
+{
+    TBlockRange const & blockRange;     // (block) -> combination id and k-mer positions [i, j)
+    TComputeKmers const & computeKmers; // (id, i, j) computes the k-mers [i, j) of combination id
+    TProgress const & progress;
+
+    int64_t teamSize = 0;
+    std::atomic<int64_t> busyThreads{0};
+    std::atomic<int64_t> queuedTasks{0};
+
+    MappabilityScheduler(TBlockRange const & blockRange_, TComputeKmers const & computeKmers_, TProgress const & progress_) :
+        blockRange(blockRange_), computeKmers(computeKmers_), progress(progress_)
+    {}
+
+    bool hasIdleThreads() const
+    {
+        return teamSize - busyThreads.load(std::memory_order_relaxed) > queuedTasks.load(std::memory_order_relaxed);
+    }
+
+    template <typename TTask>
+    void spawn(TTask task)
+    {
+        ++queuedTasks;
+        #pragma omp task firstprivate(task)
+        {
+            --queuedTasks;
+            ++busyThreads;
+            task();
+            --busyThreads;
+        }
+    }
+
+    // splitting the k-mers of a block results in fewer k-mers being searched at once (i.e., a longer common overlap)
+    void runKmers(uint64_t const id, uint64_t const i, uint64_t j)
+    {
+        while (j - i > 1 && hasIdleThreads())
+        {
+            uint64_t const mid = i + (j - i) / 2;
+            spawn([this, id, mid, j]() { runKmers(id, mid, j); });
+            j = mid;
+        }
+        computeKmers(id, i, j);
+    }
+
+    void runBlocks(uint64_t block, uint64_t blockEnd)
+    {
+        for (; block < blockEnd; ++block)
+        {
+            while (blockEnd - block > 1 && hasIdleThreads())
+            {
+                uint64_t const mid = block + (blockEnd - block) / 2;
+                spawn([this, mid, blockEnd]() { runBlocks(mid, blockEnd); });
+                blockEnd = mid;
+            }
+
+            uint64_t id, i, j;
+            blockRange(block, id, i, j);
+            if (blockEnd - block == 1)
+                runKmers(id, i, j);
+            else
+                computeKmers(id, i, j);
+            progress();
+        }
+    }
+};
+
+// A single (K, E) combination and the vectors its results are written to. Several combinations (e.g., a parameter
+// sweep) are computed in one parallel loop such that the blocks of all combinations are balanced across the threads.
+template <typename TContainer, typename TLocations>
+struct MappabilityCombination
+{
+    typedef typename TLocations::key_type TLocation;
+
+    SearchParams params;
+    TContainer & c;
+    TLocations & locations;
+    bool completeSameKmers;
+};
+
+template <typename TDistance = HammingDistance, typename TIndex, typename TText, typename TCombinations, typename TChromosomeLengths, typename TMapping>
+inline void computeMappability(TIndex & index, TText const & text, TCombinations & combinations,
+                               bool const directory, TChromosomeLengths const & chromLengths, TChromosomeLengths const & chromCumLengths,
                                TMapping const & mappingSeqIdFile, std::vector<std::pair<uint64_t, uint64_t>> const & intervals,
-                               bool & completeSameKmers,
                                uint64_t const currentFileNo, uint64_t const totalFileNo, bool const csvComputation)
 {
     auto const & limits = stringSetLimits(indexText(index));
     uint64_t const textLength = length(text);
-    uint64_t const numberOfKmers = textLength - params.length + 1;
-    uint64_t const overlap = params.overlap;
-    uint64_t const stepSize = params.length - overlap + 1; // Number of overlapping k-mers searched at once
+    unsigned const threads = combinations[0].params.threads;
 
-    completeSameKmers = false;
+    // when bed with subset for mappability is provided with at least 50% of the genome selected
+    // use optimization in algorithm (copy mappability of same k-mers)
+    bool selectionCompleteSameKmers = false;
+    if (!intervals.empty())
+    {
+        uint64_t interval_sum = 0;
+        for (auto const & interval : intervals)
+            interval_sum += interval.second - interval.first;
+        selectionCompleteSameKmers = static_cast<float>(interval_sum) / textLength > 0.5f;
+    }
 
-    if (intervals.empty())
+    // Combinations without errors are computed together by a single descent per k-mer position
+    // (see computeMappabilityMultiKBlock). Locations for csv files are only collected by the block-wise search.
+    std::vector<uint64_t> multiK;
+    if (!csvComputation && std::is_same<TDistance, HammingDistance>::value)
     {
-        // Number of loop iterations assigned to a thread at once
-        // It should be significantly smaller than the number of loop iterations (numberOfKmers/stepSize), since
-        // the running time of different loop iterations can vary vastly (e.g., repeats are slower than unique regions).
-        // This leads to an unused variable warning in Clang
-        #pragma clang diagnostic push
-        #pragma clang diagnostic ignored "-Wunused"
-        uint64_t const chunkSize = std::max<uint64_t>(1, numberOfKmers / (stepSize * params.threads * 50));
-        #pragma clang diagnostic pop
+        for (uint64_t id = 0; id < combinations.size(); ++id)
+        {
+            if (combinations[id].params.errors == 0)
+                multiK.push_back(id);
+        }
+        std::sort(multiK.begin(), multiK.end(), [&combinations](uint64_t const a, uint64_t const b) {
+            return combinations[a].params.length < combinations[b].params.length;
+        });
+    }
+    if (multiK.size() < 2)
+        multiK.clear();
 
-        uint64_t progressCount, progressMax, progressStep;
-        initProgress<outputProgress>(progressCount, progressStep, progressMax, stepSize, numberOfKmers);
+    // search schemes for E > 4 are not precomputed
+    std::vector<std::vector<OptimalSearchDynGM> > dynSearchSchemes(combinations.size());
+    for (uint64_t id = 0; id < combinations.size(); ++id)
+    {
+        if (combinations[id].params.errors > 4)
+            _optimalSearchSchemeGenerateGM(dynSearchSchemes[id], combinations[id].params.errors);
+    }
 
-        #pragma omp parallel for schedule(dynamic, chunkSize) num_threads(params.threads)
-        for (uint64_t i = 0; i < numberOfKmers; i += stepSize)
+    // --overlap auto (only relevant for the block-wise search with Hamming distance)
+    for (uint64_t id = 0; id < combinations.size(); ++id)
+    {
+        auto & combination = combinations[id];
+        if (!combination.params.autoOverlap || !std::is_same<TDistance, HammingDistance>::value ||
+            std::find(multiK.begin(), multiK.end(), id) != multiK.end())
         {
-            computeMappabilitySingleBlock<errors>(index, text, c, params, directory, chromLengths, locations, mappingSeqIdFile, i, i + stepSize, textLength, chromCumLengths, limits, intervals, overlap, true, csvComputation);
-            printProgress<outputProgress>(progressCount, progressStep, progressMax, currentFileNo, totalFileNo);
+            continue;
+        }
+
+        auto tune = [&](auto const & searchScheme)
+        {
+            combination.params.overlap = tuneOverlap(index, text, combination, searchScheme, chromLengths,
+                                                     chromCumLengths, mappingSeqIdFile, limits);
+        };
+
+        switch (combination.params.errors)
+        {
+            case 0:  tune(OptimalSearchSchemesGM<0>::VALUE); break;
+            case 1:  tune(OptimalSearchSchemesGM<1>::VALUE); break;
+            case 2:  tune(OptimalSearchSchemesGM<2>::VALUE); break;
+            case 3:  tune(OptimalSearchSchemesGM<3>::VALUE); break;
+            case 4:  tune(OptimalSearchSchemesGM<4>::VALUE); break;
+            default: tune(dynSearchSchemes[id]);
         }
     }
-    else
+
+    // The blocks of all combinations are enumerated consecutively, i.e., the blocks of combination `i` are
+    // [blockOffsets[i], blockOffsets[i + 1]). The blocks of the combinations in `multiK` are enumerated once after
+    // the last combination. Blocks are only stored explicitly for selections (intervalsDetails).
+    std::vector<uint64_t> blockOffsets(1, 0);
+    std::vector<std::vector<std::pair<uint64_t, uint64_t> > > intervalsDetails(combinations.size() + 1);
+    uint64_t const multiKStepSize = 64; // Number of k-mer positions per block for multiK
+
+    auto addBlocks = [&](uint64_t const id, uint64_t const kmerLength, uint64_t const stepSize)
     {
-        uint64_t interval_sum = 0;
-        std::vector<std::pair<uint64_t, uint64_t>> intervals_details;
-        for (auto interval = intervals.begin(); interval < intervals.end(); ++interval)
+        if (intervals.empty())
+        {
+            uint64_t const numberOfKmers = (textLength >= kmerLength) ? textLength - kmerLength + 1 : 0;
+            blockOffsets.push_back(blockOffsets.back() + (numberOfKmers + stepSize - 1) / stepSize);
+        }
+        else
         {
-            interval_sum += (*interval).second - (*interval).first;
-            for (uint64_t i = (*interval).first; i < (*interval).second; i += stepSize)
+            for (auto interval = intervals.begin(); interval < intervals.end(); ++interval)
             {
-                intervals_details.emplace_back(std::make_pair(i, std::min(i + stepSize, (*interval).second)));
+                for (uint64_t i = (*interval).first; i < (*interval).second; i += stepSize)
+                {
+                    intervalsDetails[id].emplace_back(std::make_pair(i, std::min(i + stepSize, (*interval).second)));
+                }
             }
+            blockOffsets.push_back(blockOffsets.back() + intervalsDetails[id].size());
         }
+    };
 
-        // when bed with subset for mappability is provided with at least 50% of the genome selected
-        // use optimization in algorithm (copy mappability of same k-mers)
-        float const fraction = static_cast<float>(interval_sum) / textLength;
-        completeSameKmers = fraction > 0.5f;
+    for (uint64_t id = 0; id < combinations.size(); ++id)
+    {
+        auto & combination = combinations[id];
+        combination.completeSameKmers = selectionCompleteSameKmers;
+
+        if (std::find(multiK.begin(), multiK.end(), id) != multiK.end())
+            blockOffsets.push_back(blockOffsets.back()); // no blocks of its own
+        else
+            addBlocks(id, combination.params.length, combination.params.length - combination.params.overlap + 1); // Number of overlapping k-mers searched at once
+    }
+    if (!multiK.empty())
+        addBlocks(combinations.size(), combinations[multiK[0]].params.length, multiKStepSize);
 
-        // This leads to an unused variable warning in Clang
-        #pragma clang diagnostic push
-        #pragma clang diagnostic ignored "-Wunused"
-        uint64_t const chunkSize = std::max<uint64_t>(1, intervals_details.size() / (params.threads * 50));
-        #pragma clang diagnostic pop
+    uint64_t const numberOfBlocks = blockOffsets.back();
 
-        uint64_t progressCount, progressMax, progressStep;
-        initProgress<outputProgress>(progressCount, progressStep, progressMax, 1, intervals_details.size());
+    // without a selection the frequencies of same k-mers are always copied
+    bool const completeSameKmers = intervals.empty() || selectionCompleteSameKmers;
 
-        // NOTE: chunksize for scheduling would depend on number of intervals, size of intervals, deviation of interval sizes, etc.
-        // Hence, for simplicity we do not suggest a chunk size
-        #pragma omp parallel for schedule(dynamic, chunkSize) num_threads(params.threads)
-        for (auto interval = intervals_details.begin(); interval < intervals_details.end(); ++interval)
+    std::vector<BlockBuffers<typename Iter<TIndex, VSTree<TopDown<> > >::TFwdIndexIter, typename TCombinations::value_type::TLocation> > blockBuffers(threads);
+
+    auto blockRange = [&](uint64_t const block, uint64_t & id, uint64_t & i, uint64_t & j)
+    {
+        id = std::upper_bound(blockOffsets.begin(), blockOffsets.end(), block) - blockOffsets.begin() - 1;
+        if (!intervals.empty())
         {
-            computeMappabilitySingleBlock<errors>(index, text, c, params, directory, chromLengths, locations, mappingSeqIdFile, (*interval).first, (*interval).second, textLength, chromCumLengths, limits, intervals, overlap, completeSameKmers, csvComputation);
-            printProgress<outputProgress>(progressCount, progressStep, progressMax, currentFileNo, totalFileNo);
+            std::tie(i, j) = intervalsDetails[id][block - blockOffsets[id]];
         }
+        else if (id == combinations.size())
+        {
+            i = (block - blockOffsets[id]) * multiKStepSize;
+            j = std::min(i + multiKStepSize, textLength);
+        }
+        else
+        {
+            uint64_t const stepSize = combinations[id].params.length - combinations[id].params.overlap + 1;
+            i = (block - blockOffsets[id]) * stepSize;
+            j = i + stepSize;
+        }
+    };
+
+    auto computeKmers = [&](uint64_t const id, uint64_t const i, uint64_t const j)
+    {
+        if (id == combinations.size())
+        {
+            computeMappabilityMultiKBlock(index, text, combinations, multiK, directory, i, j, textLength, limits,
+                                          completeSameKmers, combinations[0].params.revCompl);
+            return;
+        }
+
+        auto & combination = combinations[id];
+        SearchParams const & params = combination.params;
+
+        auto computeBlock = [&](auto const & searchScheme)
+        {
+            SEQAN_IF_CONSTEXPR (std::is_same<TDistance, EditDistance>::value)
+            {
+                computeMappabilityEditBlock(index, text, combination.c, params, searchScheme, directory, chromLengths, combination.locations, mappingSeqIdFile, i, j, textLength, chromCumLengths, limits, completeSameKmers, csvComputation,
+                                            blockBuffers[omp_get_thread_num()]);
+            }
+            else
+            {
+                computeMappabilitySingleBlock(index, text, combination.c, params, searchScheme, directory, chromLengths, combination.locations, mappingSeqIdFile, i, j, textLength, chromCumLengths, limits, intervals, params.overlap, completeSameKmers, csvComputation,
+                                              blockBuffers[omp_get_thread_num()]);
+            }
+        };
+
+        switch (params.errors)
+        {
+            case 0:  computeBlock(OptimalSearchSchemesGM<0>::VALUE); break;
+            case 1:  computeBlock(OptimalSearchSchemesGM<1>::VALUE); break;
+            case 2:  computeBlock(OptimalSearchSchemesGM<2>::VALUE); break;
+            case 3:  computeBlock(OptimalSearchSchemesGM<3>::VALUE); break;
+            case 4:  computeBlock(OptimalSearchSchemesGM<4>::VALUE); break;
+            default: computeBlock(dynSearchSchemes[id]);
+        }
+    };
+
+    // Rough cost of a block: number of occurrences of the first (up to) 16 characters of its first k-mer, weighted by
+    // the number of errors. Blocks in repeats are much more expensive than blocks in unique regions.
+    auto estimateCost = [&](uint64_t const block)
+    {
+        uint64_t id, i, j;
+        blockRange(block, id, i, j);
+        SearchParams const & params = combinations[(id == combinations.size()) ? multiK.back() : id].params;
+
+        typedef Iter<TIndex, VSTree<TopDown<> > > TBiIter;
+        TBiIter it(index);
+        uint64_t count = 0;
+        for (uint64_t pos = i; pos < std::min<uint64_t>(i + std::min(params.length, 16u), textLength); ++pos)
+        {
+            if ((std::is_same<typename Value<TText>::Type, Dna5>::value && text[pos] == Dna5('N')) || !goDown(it, text[pos], Rev()))
+                break;
+            count = countOccurrences(it);
+        }
+        return count * (params.errors + 1);
+    };
+
+    // Chunks of consecutive blocks. Their number should be significantly larger than the number of threads, since the
+    // running time of different blocks can vary vastly (e.g., repeats are slower than unique regions).
+    uint64_t const chunkSize = std::max<uint64_t>(1, numberOfBlocks / (threads * 50));
+    uint64_t const numberOfChunks = (numberOfBlocks + chunkSize - 1) / chunkSize;
+
+    std::vector<std::pair<uint64_t, uint64_t> > chunkOrder(numberOfChunks); // (estimated cost, chunk)
+    #pragma omp parallel for schedule(static) num_threads(threads)
+    for (uint64_t chunk = 0; chunk < numberOfChunks; ++chunk)
+    {
+        uint64_t const chunkBegin = chunk * chunkSize;
+        uint64_t const chunkEnd = std::min(chunkBegin + chunkSize, numberOfBlocks);
+        uint64_t cost = 0;
+        for (uint64_t sample = 0; sample < 4; ++sample)
+            cost += estimateCost(chunkBegin + sample * (chunkEnd - chunkBegin) / 4);
+        chunkOrder[chunk] = {cost, chunk};
     }
+    std::sort(chunkOrder.begin(), chunkOrder.end(), [](auto const & a, auto const & b) {
+        return a.first > b.first || (a.first == b.first && a.second < b.second);
+    });
+
+    uint64_t progressCount, progressMax, progressStep;
+    initProgress<outputProgress>(progressCount, progressStep, progressMax, 1, numberOfBlocks);
+    auto progress = [&]()
+    {
+        printProgress<outputProgress>(progressCount, progressStep, progressMax, currentFileNo, totalFileNo);
+    };
+
+    MappabilityScheduler<decltype(blockRange), decltype(computeKmers), decltype(progress)> scheduler(blockRange, computeKmers, progress);
+    std::atomic<uint64_t> nextChunk{0};
+
+    #pragma omp parallel num_threads(threads)
+    {
+        #pragma omp single
+        scheduler.teamSize = omp_get_num_threads();
+
+        ++scheduler.busyThreads;
+        #pragma omp barrier
+
+        for (uint64_t k = nextChunk++; k < numberOfChunks; k = nextChunk++)
+        {
+            uint64_t const chunkBegin = chunkOrder[k].second * chunkSize;
+            scheduler.runBlocks(chunkBegin, std::min(chunkBegin + chunkSize, numberOfBlocks));
+        }
+
+        --scheduler.busyThreads;
+    } // remaining tasks are executed by the idle threads at the implicit barrier
 
     // The algorithm searches k-mers in the concatenation of all strings in the fasta file (e.g. chromosomes).
     // Hence, it also searches k-mers that overlap two strings that actually do not exist.
     // At the end we overwrite the frequency of those k-mers with 0.
     // TODO: k-mers spanning two strings should not be searched if there are many short strings (i.e., fasta of reads).
-    resetLimits(c, params.length, chromCumLengths);
+    for (auto & combination : combinations)
+        resetLimits(combination.c, combination.params.length, chromCumLengths);
+}
+
+template <unsigned errors, typename TDistance = HammingDistance, typename TIndex, typename TText, typename TContainer, typename TChromosomeLengths, typename TLocations, typename TMapping>
+inline void computeMappability(TIndex & index, TText const & text, TContainer & c, SearchParams const & params,
+                               bool const directory, TChromosomeLengths const & chromLengths, TChromosomeLengths const & chromCumLengths, TLocations & locations,
+                               TMapping const & mappingSeqIdFile, std::vector<std::pair<uint64_t, uint64_t>> const & intervals,
+                               bool & completeSameKmers,
+                               uint64_t const currentFileNo, uint64_t const totalFileNo, bool const csvComputation)
+{
+    SearchParams combinationParams = params;
+    combinationParams.errors = errors;
+
+    std::vector<MappabilityCombination<TContainer, TLocations> > combinations;
+    combinations.push_back({combinationParams, c, locations, false});
+
+    computeMappability<TDistance>(index, text, combinations, directory, chromLengths, chromCumLengths, mappingSeqIdFile, intervals,
+                                  currentFileNo, totalFileNo, csvComputation);
+
+    completeSameKmers = combinations[0].completeSameKmers;
 }
@@ -0,0 +1,521 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#if SEQAN_HAS_ZLIB
+#include <zlib.h>
+#endif
+
+// Writes bigWig files (see https://genome.ucsc.edu/goldenPath/help/bigWig.html and Kent et al., 2010) directly from the
+// frequency vector: runs of equal values are stored as bedGraph items in (zlib compressed) blocks that are indexed by
+// an R-tree, followed by zoom levels with summaries of larger and larger bins, each with its own R-tree.
+// Without zlib the blocks are stored uncompressed (uncompressBufSize = 0), which is permitted by the format.
+
+static constexpr uint32_t bigWigMagic = 0x888FFC26;
+static constexpr uint32_t bigWigChromTreeMagic = 0x78CA8C91;
+static constexpr uint32_t bigWigIndexMagic = 0x2468ACE0;
+static constexpr uint32_t bigWigItemsPerBlock = 1024; // bedGraph items resp. zoom records per block
+static constexpr uint32_t bigWigIndexBlockSize = 256; // children of an R-tree node
+static constexpr uint32_t bigWigMaxZoomLevels = 10;
+
+// all numbers are stored in little-endian
+template <typename TValue>
+inline void bigWigAppend(std::string & buffer, TValue const value)
+{
+    uint64_t bits = 0;
+    std::memcpy(&bits, &value, sizeof(TValue));
+    for (unsigned i = 0; i < sizeof(TValue); ++i)
+        buffer.push_back(static_cast<char>((bits >> (8 * i)) & 0xFF));
+}
+
+template <typename TValue>
+inline void bigWigWrite(std::ofstream & file, TValue const value)
+{
+    std::string buffer;
+    bigWigAppend(buffer, value);
+    file.write(buffer.data(), buffer.size());
+}
+
+// Summary of the values of a range (a zoom record or the entire file).
+struct BigWigSummary
+{
+    uint64_t validCount = 0; // number of bases with a value
+    double minVal = std::numeric_limits<double>::max();
+    double maxVal = std::numeric_limits<double>::lowest();
+    double sumData = 0;
+    double sumSquares = 0;
+
+    void add(double const value, uint64_t const bases)
+    {
+        validCount += bases;
+        minVal = std::min(minVal, value);
+        maxVal = std::max(maxVal, value);
+        sumData += value * bases;
+        sumSquares += value * value * bases;
+    }
+};
+
+// Compresses blocks in parallel and writes them in the order they were added. Remembers the leaf entries of the R-tree.
+class BigWigBlockWriter
+{
+public:
+    struct Entry
+    {
+        uint32_t chromId;
+        uint32_t start;
+        uint32_t end;
+        uint64_t offset;
+        uint64_t size;
+    };
+
+    BigWigBlockWriter(std::ofstream & file, unsigned const threads) :
+        file(file), threads(threads)
+    {}
+
+    void add(uint32_t const chromId, uint32_t const start, uint32_t const end, std::string && block)
+    {
+        uncompressBufSize = std::max<uint64_t>(uncompressBufSize, block.size());
+        entries.push_back({chromId, start, end, 0, 0});
+        blocks.push_back(std::move(block));
+        if (blocks.size() >= 4 * threads)
+            flush();
+    }
+
+    void flush()
+    {
+#if SEQAN_HAS_ZLIB
+        std::vector<std::string> compressed(blocks.size());
+        bool failed = false;
+        #pragma omp parallel for schedule(dynamic, 1) num_threads(threads) reduction(||:failed)
+        for (uint64_t i = 0; i < blocks.size(); ++i)
+        {
+            uLongf size = compressBound(blocks[i].size());
+            compressed[i].resize(size);
+            if (compress2(reinterpret_cast<Bytef *>(&compressed[i][0]), &size,
+                          reinterpret_cast<Bytef const *>(blocks[i].data()), blocks[i].size(), Z_DEFAULT_COMPRESSION) != Z_OK)
+            {
+                failed = true;
+            }
+            compressed[i].resize(size);
+        }
+        if (failed)
+            throw std::runtime_error("Could not compress the blocks of the bigWig file.");
+        blocks.swap(compressed);
+#endif
+
+        uint64_t const firstEntry = entries.size() - blocks.size();
+        for (uint64_t i = 0; i < blocks.size(); ++i)
+        {
+            entries[firstEntry + i].offset = file.tellp();
+            entries[firstEntry + i].size = blocks[i].size();
+            file.write(blocks[i].data(), blocks[i].size());
+        }
+        blocks.clear();
+    }
+
+    std::vector<Entry> entries;
+    uint64_t uncompressBufSize = 0;
+
+private:
+    std::ofstream & file;
+    unsigned const threads;
+    std::vector<std::string> blocks;
+};
+
+// Writes the R-tree over the blocks (one leaf entry per block) at the current position of the file. As by the UCSC
+// tools, the levels are written from the root to the leaves and each node is padded to bigWigIndexBlockSize entries.
+inline void writeBigWigIndex(std::ofstream & file, std::vector<BigWigBlockWriter::Entry> const & entries, uint64_t const endFileOffset)
+{
+    uint64_t const leafNodeSize = 4 + bigWigIndexBlockSize * 32;
+    uint64_t const innerNodeSize = 4 + bigWigIndexBlockSize * 24;
+
+    // number of nodes per level, from the leaves to the root (there is always at least one leaf)
+    std::vector<uint64_t> levelNodes(1, std::max<uint64_t>(1, (entries.size() + bigWigIndexBlockSize - 1) / bigWigIndexBlockSize));
+    while (levelNodes.back() > 1)
+        levelNodes.push_back((levelNodes.back() + bigWigIndexBlockSize - 1) / bigWigIndexBlockSize);
+
+    std::string buffer;
+    bigWigAppend<uint32_t>(buffer, bigWigIndexMagic);
+    bigWigAppend<uint32_t>(buffer, bigWigIndexBlockSize);
+    bigWigAppend<uint64_t>(buffer, entries.size());
+    bigWigAppend<uint32_t>(buffer, entries.empty() ? 0 : entries.front().chromId);
+    bigWigAppend<uint32_t>(buffer, entries.empty() ? 0 : entries.front().start);
+    bigWigAppend<uint32_t>(buffer, entries.empty() ? 0 : entries.back().chromId);
+    bigWigAppend<uint32_t>(buffer, entries.empty() ? 0 : entries.back().end);
+    bigWigAppend<uint64_t>(buffer, endFileOffset);
+    bigWigAppend<uint32_t>(buffer, bigWigItemsPerBlock);
+    bigWigAppend<uint32_t>(buffer, 0); // reserved
+    file.write(buffer.data(), buffer.size());
+
+    // offset of the first node of each level
+    std::vector<uint64_t> levelOffsets(levelNodes.size());
+    uint64_t offset = file.tellp();
+    for (uint64_t level = levelNodes.size(); level-- > 0;)
+    {
+        levelOffsets[level] = offset;
+        offset += levelNodes[level] * ((level == 0) ? leafNodeSize : innerNodeSize);
+    }
+
+    // entries covered by a node of a level
+    std::vector<uint64_t> entriesPerNode(levelNodes.size(), bigWigIndexBlockSize);
+    for (uint64_t level = 1; level < levelNodes.size(); ++level)
+        entriesPerNode[level] = entriesPerNode[level - 1] * bigWigIndexBlockSize;
+
+    for (uint64_t level = levelNodes.size(); level-- > 0;)
+    {
+        for (uint64_t node = 0; node < levelNodes[level]; ++node)
+        {
+            buffer.clear();
+            uint64_t const first = node * entriesPerNode[level];
+            uint64_t const last = std::min<uint64_t>(first + entriesPerNode[level], entries.size());
+            uint64_t const childEntries = (level == 0) ? 1 : entriesPerNode[level - 1];
+            uint64_t const count = (last > first) ? (last - first + childEntries - 1) / childEntries : 0;
+
+            bigWigAppend<uint8_t>(buffer, level == 0); // isLeaf
+            bigWigAppend<uint8_t>(buffer, 0);          // reserved
+            bigWigAppend<uint16_t>(buffer, count);
+            for (uint64_t child = 0; child < count; ++child)
+            {
+                auto const & front = entries[first + child * childEntries];
+                auto const & back = entries[std::min<uint64_t>(first + (child + 1) * childEntries, last) - 1];
+                bigWigAppend<uint32_t>(buffer, front.chromId);
+                bigWigAppend<uint32_t>(buffer, front.start);
+                bigWigAppend<uint32_t>(buffer, back.chromId);
+                bigWigAppend<uint32_t>(buffer, back.end);
+                if (level == 0)
+                {
+                    bigWigAppend<uint64_t>(buffer, front.offset);
+                    bigWigAppend<uint64_t>(buffer, front.size);
+                }
+                else
+                {
+                    bigWigAppend<uint64_t>(buffer, levelOffsets[level - 1] + (node * bigWigIndexBlockSize + child) *
+                                                   ((level == 1) ? leafNodeSize : innerNodeSize));
+                }
+            }
+            buffer.resize((level == 0) ? leafNodeSize : innerNodeSize, 0);
+            file.write(buffer.data(), buffer.size());
+        }
+    }
+}
+
+// Writes the B+ tree that maps the chromosome names (sorted, the id of a chromosome is its rank) to their ids and
+// lengths at the current position of the file. As by the UCSC tools, a node has at most bigWigIndexBlockSize children,
+// the levels are written from the root to the leaves and each node is padded to the block size. Inner nodes store the
+// name of the first chromosome of each child.
+inline void writeBigWigChromTree(std::ofstream & file, std::vector<std::string> const & names,
+                                 std::vector<uint32_t> const & lengths)
+{
+    uint64_t const nbrChromosomes = names.size();
+    uint64_t const blockSize = std::max<uint64_t>(1, std::min<uint64_t>(bigWigIndexBlockSize, nbrChromosomes));
+    uint64_t keySize = 1;
+    for (std::string const & name : names)
+        keySize = std::max<uint64_t>(keySize, name.size());
+    // a key is followed by the offset of the child resp. the id and length of the chromosome (8 bytes each)
+    uint64_t const nodeSize = 4 + blockSize * (keySize + 8);
+
+    std::string buffer;
+    bigWigAppend<uint32_t>(buffer, bigWigChromTreeMagic);
+    bigWigAppend<uint32_t>(buffer, blockSize);
+    bigWigAppend<uint32_t>(buffer, keySize);
+    bigWigAppend<uint32_t>(buffer, 8);  // value size
+    bigWigAppend<uint64_t>(buffer, nbrChromosomes);
+    bigWigAppend<uint64_t>(buffer, 0);  // reserved
+    file.write(buffer.data(), buffer.size());
+
+    // chromosomes covered by a child of a node of a level, from the leaves to the root (there is always one leaf)
+    std::vector<uint64_t> childChromosomes(1, 1);
+    while (childChromosomes.back() * blockSize < nbrChromosomes)
+        childChromosomes.push_back(childChromosomes.back() * blockSize);
+
+    uint64_t levelOffset = file.tellp();
+    for (uint64_t level = childChromosomes.size(); level-- > 0;)
+    {
+        uint64_t const nodeChromosomes = childChromosomes[level] * blockSize;
+        uint64_t const nodes = std::max<uint64_t>(1, (nbrChromosomes + nodeChromosomes - 1) / nodeChromosomes);
+        uint64_t nextChild = levelOffset + nodes * nodeSize; // the children are the nodes of the next level
+        for (uint64_t node = 0; node < nodes; ++node)
+        {
+            uint64_t const first = node * nodeChromosomes;
+            uint64_t const count = std::min<uint64_t>(blockSize, (nbrChromosomes - first + childChromosomes[level] - 1) /
+                                                                 childChromosomes[level]);
+            buffer.clear();
+            bigWigAppend<uint8_t>(buffer, level == 0); // isLeaf
+            bigWigAppend<uint8_t>(buffer, 0);          // reserved
+            bigWigAppend<uint16_t>(buffer, count);
+            for (uint64_t child = 0; child < count; ++child)
+            {
+                uint64_t const chromId = first + child * childChromosomes[level];
+                buffer += names[chromId];
+                buffer.append(keySize - names[chromId].size(), '\0');
+                if (level == 0)
+                {
+                    bigWigAppend<uint32_t>(buffer, chromId);
+                    bigWigAppend<uint32_t>(buffer, lengths[chromId]);
+                }
+                else
+                {
+                    bigWigAppend<uint64_t>(buffer, nextChild);
+                    nextChild += nodeSize;
+                }
+            }
+            buffer.resize(nodeSize, 0);
+            file.write(buffer.data(), buffer.size());
+        }
+        levelOffset += nodes * nodeSize;
+    }
+}
+
+template <typename TContainer, typename TChromosomeNames, typename TChromosomeLengths>
+void saveBigWig(TContainer const & c, std::string const & output_path, TChromosomeNames const & chromNames,
+                TChromosomeLengths const & chromLengths, OutputType const outputType, unsigned const threads)
+{
+    typedef typename TContainer::value_type T;
+
+    uint64_t const nbrChromosomes = length(chromLengths);
+    std::vector<std::string> const names = chromosomeNameStrings(chromNames);
+
+    // the chromosome B+ tree requires the names to be sorted, the chromosome ids are assigned in this order
+    std::vector<uint64_t> order(nbrChromosomes), chromBegin(nbrChromosomes + 1, 0);
+    for (uint64_t i = 0; i < nbrChromosomes; ++i)
+    {
+        if (chromLengths[i] > std::numeric_limits<uint32_t>::max())
+            throw std::runtime_error("bigWig files do not support sequences longer than 2^32 - 1 (" + names[i] + ").");
+        order[i] = i;
+        chromBegin[i + 1] = chromBegin[i] + chromLengths[i];
+    }
+    std::sort(order.begin(), order.end(), [&names](uint64_t const a, uint64_t const b) { return names[a] < names[b]; });
+
+    // the values of exact 32 bit frequencies (--compact-frequencies) are not tabulated
+    std::vector<float> values((sizeof(T) <= 2) ? static_cast<uint64_t>(std::numeric_limits<T>::max()) + 1 : 0);
+    for (uint64_t v = 0; v < values.size(); ++v)
+        values[v] = outputValue(outputType, v);
+    auto value = [&values, outputType](T const v) { return values.empty() ? outputValue(outputType, v) : values[v]; };
+
+    std::ofstream file(output_path + ".bw", std::ios::out | std::ios::binary);
+
+    // header, zoom headers and total summary are written at the end
+    uint64_t const totalSummaryOffset = 64 + bigWigMaxZoomLevels * 24;
+    file.write(std::string(totalSummaryOffset + 40, 0).data(), totalSummaryOffset + 40);
+
+    // chromosome B+ tree
+    uint64_t const chromTreeOffset = file.tellp();
+    {
+        std::vector<std::string> sortedNames(nbrChromosomes);
+        std::vector<uint32_t> sortedLengths(nbrChromosomes);
+        for (uint64_t chromId = 0; chromId < nbrChromosomes; ++chromId)
+        {
+            sortedNames[chromId] = names[order[chromId]];
+            sortedLengths[chromId] = chromLengths[order[chromId]];
+        }
+        writeBigWigChromTree(file, sortedNames, sortedLengths);
+    }
+
+    // Calls f(chromId, start, end, v) for each run of equal values v != 0 in the order of the chromosome ids.
+    auto forEachRun = [&](auto && f)
+    {
+        for (uint64_t chromId = 0; chromId < nbrChromosomes; ++chromId)
+        {
+            uint64_t const offset = chromBegin[order[chromId]];
+            uint64_t const chromEnd = chromBegin[order[chromId] + 1];
+            for (uint64_t pos = offset, runEnd; pos < chromEnd; pos = runEnd)
+            {
+                // frequencies of the same bin (--mappability-quantized) form a single run
+                for (runEnd = pos + 1; runEnd < chromEnd && value(c[runEnd]) == value(c[pos]); ++runEnd)
+                    ;
+                if (c[pos] != 0)
+                    f(chromId, pos - offset, runEnd - offset, c[pos]);
+            }
+        }
+    };
+
+    // full data: bedGraph items
+    uint64_t const fullDataOffset = file.tellp();
+    uint64_t uncompressBufSize = 0;
+    BigWigSummary totalSummary;
+    uint64_t nbrItems = 0;
+    std::vector<BigWigBlockWriter::Entry> fullIndex;
+    {
+        bigWigWrite<uint64_t>(file, 0); // number of blocks, updated below
+        BigWigBlockWriter blocks(file, threads);
+
+        std::string block;
+        uint32_t blockChromId = 0, blockStart = 0, blockEnd = 0;
+        uint16_t blockItems = 0;
+        auto flushBlock = [&]()
+        {
+            if (blockItems == 0)
+                return;
+            std::string header;
+            bigWigAppend<uint32_t>(header, blockChromId);
+            bigWigAppend<uint32_t>(header, blockStart);
+            bigWigAppend<uint32_t>(header, blockEnd);
+            bigWigAppend<uint32_t>(header, 0); // itemStep
+            bigWigAppend<uint32_t>(header, 0); // itemSpan
+            bigWigAppend<uint8_t>(header, 1);  // type: bedGraph
+            bigWigAppend<uint8_t>(header, 0);  // reserved
+            bigWigAppend<uint16_t>(header, blockItems);
+            blocks.add(blockChromId, blockStart, blockEnd, header + block);
+            block.clear();
+            blockItems = 0;
+        };
+
+        forEachRun([&](uint32_t const chromId, uint32_t const start, uint32_t const end, T const v)
+        {
+            if (blockItems == bigWigItemsPerBlock || (blockItems > 0 && chromId != blockChromId))
+                flushBlock();
+            if (blockItems == 0)
+            {
+                blockChromId = chromId;
+                blockStart = start;
+            }
+            blockEnd = end;
+            bigWigAppend<uint32_t>(block, start);
+            bigWigAppend<uint32_t>(block, end);
+            bigWigAppend<float>(block, value(v));
+            ++blockItems;
+
+            totalSummary.add(value(v), end - start);
+            ++nbrItems;
+        });
+        flushBlock();
+        blocks.flush();
+
+        fullIndex.swap(blocks.entries);
+        uncompressBufSize = blocks.uncompressBufSize;
+    }
+    uint64_t const fullIndexOffset = file.tellp();
+    writeBigWigIndex(file, fullIndex, fullIndexOffset);
+
+    // Zoom levels: the first one summarizes bins of 4 times the average run length, each further one 4 times larger
+    // bins. Zoom levels are only added as long as they reduce the number of records considerably.
+    std::vector<std::pair<uint32_t, std::pair<uint64_t, uint64_t> > > zoomLevels; // reduction level, data and index offset
+    uint64_t reduction = (nbrItems > 0) ? std::max<uint64_t>(1, 4 * totalSummary.validCount / nbrItems) : 0;
+    uint64_t previousRecords = nbrItems;
+    while (nbrItems > 0 && zoomLevels.size() < bigWigMaxZoomLevels && reduction <= std::numeric_limits<uint32_t>::max())
+    {
+        uint64_t const dataOffset = file.tellp();
+        bigWigWrite<uint32_t>(file, 0); // number of records, updated below
+        BigWigBlockWriter blocks(file, threads);
+
+        std::string block;
+        uint32_t blockChromId = 0, blockStart = 0, blockEnd = 0, blockRecords = 0;
+        uint64_t nbrRecords = 0;
+        auto flushBlock = [&]()
+        {
+            if (blockRecords == 0)
+                return;
+            blocks.add(blockChromId, blockStart, blockEnd, std::move(block));
+            block.clear();
+            blockRecords = 0;
+        };
+
+        BigWigSummary bin;
+        uint32_t binChromId = 0;
+        uint64_t binStart = 0;
+        auto flushBin = [&]()
+        {
+            if (bin.validCount == 0)
+                return;
+            uint64_t const binEnd = std::min<uint64_t>(binStart + reduction, chromLengths[order[binChromId]]);
+            if (blockRecords == bigWigItemsPerBlock || (blockRecords > 0 && binChromId != blockChromId))
+                flushBlock();
+            if (blockRecords == 0)
+            {
+                blockChromId = binChromId;
+                blockStart = binStart;
+            }
+            blockEnd = binEnd;
+            bigWigAppend<uint32_t>(block, binChromId);
+            bigWigAppend<uint32_t>(block, binStart);
+            bigWigAppend<uint32_t>(block, binEnd);
+            bigWigAppend<uint32_t>(block, bin.validCount);
+            bigWigAppend<float>(block, bin.minVal);
+            bigWigAppend<float>(block, bin.maxVal);
+            bigWigAppend<float>(block, bin.sumData);
+            bigWigAppend<float>(block, bin.sumSquares);
+            ++blockRecords;
+            ++nbrRecords;
+            bin = BigWigSummary();
+        };
+
+        forEachRun([&](uint32_t const chromId, uint64_t start, uint64_t const end, T const v)
+        {
+            while (start < end) // a run can span multiple bins
+            {
+                if (chromId != binChromId || start >= binStart + reduction)
+                {
+                    flushBin();
+                    binChromId = chromId;
+                    binStart = start - start % reduction;
+                }
+                uint64_t const overlapEnd = std::min<uint64_t>(end, binStart + reduction);
+                bin.add(value(v), overlapEnd - start);
+                start = overlapEnd;
+            }
+        });
+        flushBin();
+        flushBlock();
+        blocks.flush();
+        uncompressBufSize = std::max(uncompressBufSize, blocks.uncompressBufSize);
+
+        uint64_t const indexOffset = file.tellp();
+        writeBigWigIndex(file, blocks.entries, indexOffset);
+
+        file.seekp(dataOffset);
+        bigWigWrite<uint32_t>(file, nbrRecords);
+        file.seekp(0, std::ios::end);
+
+        zoomLevels.push_back({static_cast<uint32_t>(reduction), {dataOffset, indexOffset}});
+        if (2 * nbrRecords > previousRecords || nbrRecords <= nbrChromosomes)
+            break;
+        previousRecords = nbrRecords;
+        reduction *= 4;
+    }
+
+    bigWigWrite<uint32_t>(file, bigWigMagic); // the file ends with the magic number
+
+    file.seekp(fullDataOffset);
+    bigWigWrite<uint64_t>(file, fullIndex.size());
+
+    std::string buffer;
+    bigWigAppend<uint32_t>(buffer, bigWigMagic);
+    bigWigAppend<uint16_t>(buffer, 4); // version
+    bigWigAppend<uint16_t>(buffer, zoomLevels.size());
+    bigWigAppend<uint64_t>(buffer, chromTreeOffset);
+    bigWigAppend<uint64_t>(buffer, fullDataOffset);
+    bigWigAppend<uint64_t>(buffer, fullIndexOffset);
+    bigWigAppend<uint16_t>(buffer, 0); // field count
+    bigWigAppend<uint16_t>(buffer, 0); // defined field count
+    bigWigAppend<uint64_t>(buffer, 0); // autoSql offset
+    bigWigAppend<uint64_t>(buffer, totalSummaryOffset);
+#if SEQAN_HAS_ZLIB
+    bigWigAppend<uint32_t>(buffer, uncompressBufSize);
+#else
+    bigWigAppend<uint32_t>(buffer, 0); // blocks are not compressed
+#endif
+    bigWigAppend<uint64_t>(buffer, 0); // extension offset
+    for (auto const & zoomLevel : zoomLevels)
+    {
+        bigWigAppend<uint32_t>(buffer, zoomLevel.first);
+        bigWigAppend<uint32_t>(buffer, 0); // reserved
+        bigWigAppend<uint64_t>(buffer, zoomLevel.second.first);
+        bigWigAppend<uint64_t>(buffer, zoomLevel.second.second);
+    }
+    buffer.resize(totalSummaryOffset, 0);
+    bigWigAppend<uint64_t>(buffer, totalSummary.validCount);
+    bigWigAppend<double>(buffer, (nbrItems > 0) ? totalSummary.minVal : 0);
+    bigWigAppend<double>(buffer, (nbrItems > 0) ? totalSummary.maxVal : 0);
+    bigWigAppend<double>(buffer, totalSummary.sumData);
+    bigWigAppend<double>(buffer, totalSummary.sumSquares);
+    file.seekp(0);
+    file.write(buffer.data(), buffer.size());
+    file.close();
+}
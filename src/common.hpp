@@ -1,5 +1,6 @@
 #pragma once
 
+#include <limits>
 #include <time.h>
 #include <sys/time.h>
 
@@ -13,7 +14,7 @@ inline auto retrieveDirectoryInformationLine(CharString const & info)
     auto const firstSeparator = row.find(';', 0);
     auto const secondSeparator = row.find(';', firstSeparator + 1);
     std::string const fastaFile = row.substr(0, firstSeparator);
-    uint64_t const length = std::stoi(row.substr(firstSeparator + 1, secondSeparator - firstSeparator - 1));
+    uint64_t const length = std::stoull(row.substr(firstSeparator + 1, secondSeparator - firstSeparator - 1));
     std::string const chromName = row.substr(secondSeparator + 1);
     return std::make_tuple(fastaFile, length, chromName);
 }
@@ -67,10 +68,15 @@ struct SAValue<StringSet<TString, Owner<ConcatDirect<SizeSpec_<TSeqNo, TSeqPos>
 struct SearchParams
 {
     unsigned length;
+    unsigned errors;
     unsigned overlap;
     unsigned threads;
     bool revCompl;
     bool excludePseudo;
+    bool autoOverlap = false; // overlap is picked by a pilot run on sampled regions (see tuneOverlap)
+    uint64_t pilotRegionLength = 4096; // number of k-mers per sampled region of the pilot run (smaller in tests)
+    bool doubleStrand = false; // index contains the reverse complement of each sequence (see forwardStrandOccurrence)
+    uint32_t maxFrequency = std::numeric_limits<uint32_t>::max(); // frequencies are capped and searches end early (--max-frequency)
 };
 
 std::string mytime()
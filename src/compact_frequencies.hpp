@@ -0,0 +1,141 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include "frequency_allocator.hpp"
+
+// Frequency vector with a single byte per position (see --compact-frequencies). Frequencies below escapeValue are
+// stored in the byte itself, larger ones are marked with escapeValue and stored exactly (up to 32 bits) in a sparse
+// overflow table, which is split into shards with a lock each. Since most k-mers have small frequencies, the table only
+// holds few entries. Frequencies are written and read concurrently by multiple threads (see storeFrequency()): the
+// escape value is published with release semantics after the frequency has been inserted into the overflow table.
+//
+// Reading a position with [] returns the frequency saturated to TValue, i.e., the value type of the outputs, get()
+// returns the exact frequency. Frequencies are written exactly with TValue = uint32_t (see run()), the mappability is
+// computed from the frequencies saturated to uint16_t.
+template <typename TValue>
+class CompactFrequencies
+{
+public:
+    typedef TValue value_type;
+
+    static constexpr uint8_t escapeValue = std::numeric_limits<uint8_t>::max();
+
+    CompactFrequencies() :
+        shards(new Shard[nbrShards])
+    {}
+
+    template <typename T>
+    explicit CompactFrequencies(FrequencyAllocator<T> const & allocator) :
+        primary(FrequencyAllocator<uint8_t>(allocator)), shards(new Shard[nbrShards])
+    {}
+
+    // all positions are set to 0
+    void resize(uint64_t const size)
+    {
+        primary.resize(size);
+    }
+
+    uint64_t size() const
+    {
+        return primary.size();
+    }
+
+    bool empty() const
+    {
+        return primary.empty();
+    }
+
+    FrequencyAllocator<uint8_t> get_allocator() const
+    {
+        return primary.get_allocator();
+    }
+
+    void swap(CompactFrequencies & other)
+    {
+        primary.swap(other.primary);
+        shards.swap(other.shards);
+    }
+
+    TValue operator[](uint64_t const pos) const
+    {
+        return std::min<uint32_t>(get(pos), std::numeric_limits<TValue>::max());
+    }
+
+    uint32_t get(uint64_t const pos) const
+    {
+        uint8_t const value = __atomic_load_n(&primary[pos], __ATOMIC_ACQUIRE);
+        if (value != escapeValue)
+            return value;
+
+        Shard & shard = shards[shardOf(pos)];
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        return shard.values.at(pos);
+    }
+
+    void set(uint64_t const pos, uint32_t const value)
+    {
+        if (value < escapeValue)
+        {
+            __atomic_store_n(&primary[pos], static_cast<uint8_t>(value), __ATOMIC_RELAXED);
+            return;
+        }
+
+        {
+            Shard & shard = shards[shardOf(pos)];
+            std::lock_guard<std::mutex> lock(shard.mutex);
+            shard.values[pos] = value;
+        }
+        __atomic_store_n(&primary[pos], escapeValue, __ATOMIC_RELEASE);
+    }
+
+    // number of positions with a frequency of at least escapeValue
+    uint64_t overflowSize() const
+    {
+        uint64_t size = 0;
+        for (uint64_t i = 0; i < nbrShards; ++i)
+            size += shards[i].values.size();
+        return size;
+    }
+
+private:
+    struct Shard
+    {
+        std::mutex mutex;
+        std::unordered_map<uint64_t, uint32_t> values;
+    };
+
+    static constexpr uint64_t nbrShards = 1 << 12;
+
+    static uint64_t shardOf(uint64_t const pos)
+    {
+        return (pos * 0x9E3779B97F4A7C15ULL) >> 52; // Fibonacci hashing, log2(nbrShards) bits
+    }
+
+    std::vector<uint8_t, FrequencyAllocator<uint8_t> > primary;
+    std::unique_ptr<Shard[]> shards;
+};
+
+template <typename TValue>
+inline uint32_t loadFrequency(CompactFrequencies<TValue> const & c, uint64_t const pos)
+{
+    return c.get(pos);
+}
+
+template <typename TValue>
+inline void storeFrequency(CompactFrequencies<TValue> & c, uint64_t const pos, uint32_t const value)
+{
+    c.set(pos, value);
+}
+
+template <typename TValue>
+inline uint32_t maxStoredFrequency(CompactFrequencies<TValue> const & /*c*/)
+{
+    return std::numeric_limits<uint32_t>::max();
+}
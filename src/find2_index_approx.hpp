@@ -48,7 +48,8 @@ struct OptimalSearchDynGM
     uint32_t startPos;
 };
 
-// std::vector<OptimalSearchDynGM<1> > VALUE { {{ {{1}}, {{0}}, {{10}}, {{0}}, 0 }} };
+// Search schemes for more than 4 errors are generated at runtime (see _optimalSearchSchemeGenerateGM) and are executed
+// by the same (generic) search functions as the precomputed schemes, i.e., without instantiating them for each E.
 
 template <size_t N>
 struct OptimalSearchGM
@@ -133,26 +134,58 @@ struct OptimalSearchSchemesGM<4, TVoidType>
 template <typename TVoidType>
 constexpr std::array<OptimalSearchGM<6>, 7> OptimalSearchSchemesGM<4, TVoidType>::VALUE;
 
+// Generates a search scheme with E + 1 blocks for an arbitrary number of errors E. With e_i being the number of errors
+// in block i and P_j = e_1 + ... + e_j, search j covers all error distributions where j is the smallest block index
+// with P_j < j, i.e., block j has no errors and P_m >= m for all m < j (hence P_(j-1) = j - 1). It searches block j
+// first, then the blocks j - 1, ..., 1 and then j + 1, ..., E + 1. Since j is unique for each error distribution, no
+// distribution is enumerated twice (which is required for counting).
+// The block indices and error bounds are stored as uint8_t, i.e., errors has to be small (see --errors).
+inline void _optimalSearchSchemeGenerateGM(std::vector<OptimalSearchDynGM> & ss, unsigned const errors)
+{
+    SEQAN_ASSERT_LT(errors, 255u);
+    unsigned const blocks = errors + 1;
+
+    ss.clear();
+    for (unsigned j = 1; j <= blocks; ++j)
+    {
+        OptimalSearchDynGM s;
+        for (unsigned t = 0; t < j; ++t) // block j, j - 1, ..., 1
+        {
+            s.pi.push_back(j - t);
+            s.l.push_back((t + 1 == j) ? j - 1 : 0);
+            s.u.push_back(t);
+        }
+        for (unsigned i = j + 1; i <= blocks; ++i)
+        {
+            s.pi.push_back(i);
+            s.l.push_back(j - 1);
+            s.u.push_back(errors);
+        }
+        s.blocklength.resize(blocks, 0);
+        s.startPos = 0;
+        ss.push_back(s);
+    }
+}
+
 // Given the blocklengths (absolute, not cumulative values), assign it to all
 // OptimalSearches in a OptimalSearchScheme. The order of blocklength has to be from left to
 // right (regarding blocks)
-template <size_t nbrBlocks, size_t N>
-inline void _optimalSearchSchemeSetBlockLengthGM(std::array<OptimalSearchGM<nbrBlocks>, N> & ss,
-                                                 std::vector<uint32_t> const & blocklength)
+template <typename TSearchScheme>
+inline void _optimalSearchSchemeSetBlockLengthGM(TSearchScheme & ss, std::vector<uint32_t> const & blocklength)
 {
-    for (OptimalSearchGM<nbrBlocks> & s : ss)
+    for (auto & s : ss)
         for (uint8_t i = 0; i < s.blocklength.size(); ++i)
             s.blocklength[i] = blocklength[s.pi[i]-1] + ((i > 0) ? s.blocklength[i-1] : 0);
 }
 
 // requires blocklength to be already set!
-template <size_t nbrBlocks, size_t N>
-inline void _optimalSearchSchemeInitGM(std::array<OptimalSearchGM<nbrBlocks>, N> & ss)
+template <typename TSearchScheme>
+inline void _optimalSearchSchemeInitGM(TSearchScheme & ss)
 {
     // check whether 2nd block is on the left or right and choose initialDirection accordingly
     // (more efficient since we do not have to switch directions and thus have better caching performance)
     // for that we need to slightly modify search()
-    for (OptimalSearchGM<nbrBlocks> & s : ss)
+    for (auto & s : ss)
     {
         s.startPos = 0;
         for (uint8_t i = 0; i < s.pi.size(); ++i)
@@ -161,8 +194,8 @@ inline void _optimalSearchSchemeInitGM(std::array<OptimalSearchGM<nbrBlocks>, N>
     }
 }
 
-template <size_t nbrBlocks, size_t N>
-inline void _optimalSearchSchemeComputeFixedBlocklengthGM(std::array<OptimalSearchGM<nbrBlocks>, N> & ss, uint32_t const needleLength)
+template <typename TSearchScheme>
+inline void _optimalSearchSchemeComputeFixedBlocklengthGM(TSearchScheme & ss, uint32_t const needleLength)
 {
     uint8_t blocks = ss[0].pi.size();
     uint32_t blocklength = needleLength / blocks;
@@ -175,10 +208,42 @@ inline void _optimalSearchSchemeComputeFixedBlocklengthGM(std::array<OptimalSear
     _optimalSearchSchemeInitGM(ss);
 }
 
+// Whether the delegate has all results it needs, i.e., the remaining search tree is skipped (see StoppableDelegate in
+// algo.hpp).
+template <typename TDelegate>
+inline bool _optimalSearchSchemeStopGM(TDelegate const & /**/)
+{
+    return false;
+}
+
+// GenMap does not report alignments that begin or end with an indel (EditDistance). These would only report the same
+// occurrence with a shifted begin or end position. Returns whether a deletion, i.e., a text character without a needle
+// character, is allowed next to the current needle infix in the given direction.
+template <typename TNeedle>
+inline bool _optimalSearchSchemeDeletionAllowedGM(TNeedle const & needle, uint32_t const needleLeftPos,
+                                                  uint32_t const needleRightPos, bool const goToRight)
+{
+    bool const emptyInfix = needleRightPos - needleLeftPos == 1;
+    if (goToRight)
+        return needleRightPos != length(needle) + 1 && !(emptyInfix && needleLeftPos == 0);
+    else
+        return needleLeftPos != 0 && !(emptyInfix && needleRightPos == length(needle) + 1);
+}
+
+// Returns whether an insertion, i.e., a needle character without a text character, is allowed for the next needle
+// character in the given direction (the first and last character of the needle always have to be aligned).
+template <typename TNeedle>
+inline bool _optimalSearchSchemeInsertionAllowedGM(TNeedle const & needle, uint32_t const needleLeftPos,
+                                                   uint32_t const needleRightPos, bool const goToRight)
+{
+    uint32_t const needlePos = goToRight ? needleRightPos - 1 : needleLeftPos - 1;
+    return needlePos != 0 && needlePos + 1 != length(needle);
+}
+
 template <typename TDelegate,
           typename TText, typename TIndex, typename TIndexSpec,
           typename TNeedle,
-          size_t nbrBlocks,
+          typename TSearch,
           typename TDir>
 inline void _optimalSearchSchemeDeletionGM(TDelegate & delegate,
                                            Iter<Index<TText, BidirectionalIndex<TIndex> >,   VSTree<TopDown<TIndexSpec> > > iter,
@@ -186,7 +251,7 @@ inline void _optimalSearchSchemeDeletionGM(TDelegate & delegate,
                                            uint32_t const needleLeftPos,
                                            uint32_t const needleRightPos,
                                            uint8_t const errors,
-                                           OptimalSearchGM<nbrBlocks> const & s,
+                                           TSearch const & s,
                                            uint8_t const blockIndex,
                                            TDir const & /**/)
 {
@@ -210,20 +275,22 @@ inline void _optimalSearchSchemeDeletionGM(TDelegate & delegate,
         }
     }
 
-    if (maxErrorsLeftInBlock > 0 && goDown(iter, TDir()))
+    if (maxErrorsLeftInBlock > 0 &&
+        _optimalSearchSchemeDeletionAllowedGM(needle, needleLeftPos, needleRightPos, std::is_same<TDir, Rev>::value) &&
+        goDown(iter, TDir()))
     {
         do
         {
             _optimalSearchSchemeDeletionGM(delegate, iter, needle, needleLeftPos, needleRightPos, errors + 1, s,
                                            blockIndex, TDir());
-        } while (goRight(iter, TDir()));
+        } while (!_optimalSearchSchemeStopGM(delegate) && goRight(iter, TDir()));
     }
 }
 
 template <typename TDelegate,
           typename TText, typename TIndex, typename TIndexSpec,
           typename TNeedle,
-          size_t nbrBlocks,
+          typename TSearch,
           typename TDir,
           typename TDistanceTag>
 inline void _optimalSearchSchemeChildrenGM(TDelegate & delegate,
@@ -232,7 +299,7 @@ inline void _optimalSearchSchemeChildrenGM(TDelegate & delegate,
                                            uint32_t const needleLeftPos,
                                            uint32_t const needleRightPos,
                                            uint8_t const errors,
-                                           OptimalSearchGM<nbrBlocks> const & s,
+                                           TSearch const & s,
                                            uint8_t const blockIndex,
                                            uint8_t const minErrorsLeftInBlock,
                                            TDir const & /**/,
@@ -241,6 +308,8 @@ inline void _optimalSearchSchemeChildrenGM(TDelegate & delegate,
     constexpr bool goToRight = std::is_same<TDir, Rev>::value;
     if (goDown(iter, TDir()))
     {
+        bool const deletionAllowed = std::is_same<TDistanceTag, EditDistance>::value &&
+                                     _optimalSearchSchemeDeletionAllowedGM(needle, needleLeftPos, needleRightPos, goToRight);
         constexpr bool isDna5 = std::is_same<typename Value<TNeedle>::Type, Dna5>::value;
         auto const & needleChar = needle[goToRight ? needleRightPos - 1 : needleLeftPos - 1];
 
@@ -291,19 +360,19 @@ inline void _optimalSearchSchemeChildrenGM(TDelegate & delegate,
             }
 
             // Deletion
-            SEQAN_IF_CONSTEXPR (std::is_same<TDistanceTag, EditDistance>::value)
+            if (deletionAllowed)
             {
                 _optimalSearchSchemeGM(delegate, iter, needle, needleLeftPos, needleRightPos, errors + 1, s, blockIndex,
                                        TDir(), TDistanceTag());
             }
-        } while (goRight(iter, TDir()));
+        } while (!_optimalSearchSchemeStopGM(delegate) && goRight(iter, TDir()));
     }
 }
 
 template <typename TDelegate,
           typename TText, typename TIndex, typename TIndexSpec,
           typename TNeedle,
-          size_t nbrBlocks,
+          typename TSearch,
           typename TDir,
           typename TDistanceTag>
 inline void _optimalSearchSchemeExactGM(TDelegate & delegate,
@@ -312,7 +381,7 @@ inline void _optimalSearchSchemeExactGM(TDelegate & delegate,
                                         uint32_t const needleLeftPos,
                                         uint32_t const needleRightPos,
                                         uint8_t const errors,
-                                        OptimalSearchGM<nbrBlocks> const & s,
+                                        TSearch const & s,
                                         uint8_t const blockIndex,
                                         TDir const & /**/,
                                         TDistanceTag const & /**/)
@@ -371,7 +440,7 @@ inline void _optimalSearchSchemeExactGM(TDelegate & delegate,
 template <typename TDelegate,
           typename TText, typename TIndex, typename TIndexSpec,
           typename TNeedle,
-          size_t nbrBlocks,
+          typename TSearch,
           typename TDir,
           typename TDistanceTag>
 inline void _optimalSearchSchemeGM(TDelegate & delegate,
@@ -380,11 +449,14 @@ inline void _optimalSearchSchemeGM(TDelegate & delegate,
                                    uint32_t const needleLeftPos,
                                    uint32_t const needleRightPos,
                                    uint8_t const errors,
-                                   OptimalSearchGM<nbrBlocks> const & s,
+                                   TSearch const & s,
                                    uint8_t const blockIndex,
                                    TDir const & /**/,
                                    TDistanceTag const & /**/)
 {
+    if (_optimalSearchSchemeStopGM(delegate))
+        return;
+
     uint8_t const maxErrorsLeftInBlock = s.u[blockIndex] - errors;
     uint8_t const minErrorsLeftInBlock = (s.l[blockIndex] > errors) ? (s.l[blockIndex] - errors) : 0;
 
@@ -404,9 +476,10 @@ inline void _optimalSearchSchemeGM(TDelegate & delegate,
     else
     {
         // Insertion
-        SEQAN_IF_CONSTEXPR (std::is_same<TDistanceTag, EditDistance>::value)
+        constexpr bool goToRight = std::is_same<TDir, Rev>::value;
+        if (std::is_same<TDistanceTag, EditDistance>::value &&
+            _optimalSearchSchemeInsertionAllowedGM(needle, needleLeftPos, needleRightPos, goToRight))
         {
-            constexpr bool goToRight = std::is_same<TDir, Rev>::value;
             int32_t const needleLeftPos2 = needleLeftPos - !goToRight;
             uint32_t const needleRightPos2 = needleRightPos + goToRight;
 
@@ -441,6 +514,33 @@ inline void _optimalSearchSchemeGM(TDelegate & delegate,
     _optimalSearchSchemeGM(delegate, it, needle, s.startPos, s.startPos + 1, 0, s, 0, Rev(), TDistanceTag());
 }
 
+template <typename TDelegate,
+          typename TText, typename TIndex, typename TIndexSpec,
+          typename TNeedle,
+          typename TDistanceTag>
+inline void _optimalSearchSchemeGM(TDelegate & delegate,
+                                   Iter<Index<TText, BidirectionalIndex<TIndex> >, VSTree<TopDown<TIndexSpec> > > it,
+                                   TNeedle const & needle,
+                                   OptimalSearchDynGM const & s,
+                                   TDistanceTag const & /**/)
+{
+    _optimalSearchSchemeGM(delegate, it, needle, s.startPos, s.startPos + 1, 0, s, 0, Rev(), TDistanceTag());
+}
+
+template <typename TDelegate,
+          typename TText, typename TIndex, typename TIndexSpec,
+          typename TNeedle,
+          typename TDistanceTag>
+inline void _optimalSearchSchemeGM(TDelegate & delegate,
+                                   Iter<Index<TText, BidirectionalIndex<TIndex> >, VSTree<TopDown<TIndexSpec> > > it,
+                                   TNeedle const & needle,
+                                   std::vector<OptimalSearchDynGM> const & ss,
+                                   TDistanceTag const & /**/)
+{
+    for (auto & s : ss)
+        _optimalSearchSchemeGM(delegate, it, needle, s, TDistanceTag());
+}
+
 template <typename TDelegate,
           typename TText, typename TIndex, typename TIndexSpec,
           typename TNeedle,
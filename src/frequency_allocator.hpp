@@ -0,0 +1,118 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdlib>
+#include <memory>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+// Allocator of the frequency vectors. Either allocates main memory (default) or memory maps a file (see
+// --mmap-frequencies) such that the operating system can page out the frequencies. The file is either a temporary file
+// (in TMPDIR, deleted once it is unmapped) or the raw output file itself, i.e., the plain raw output does not need to be
+// written separately. Mapped files are sparse and elements are not initialized, i.e., they are zero without touching
+// any page. A vector has to be allocated at once with the final size (e.g., resize() of an empty vector).
+template <typename T>
+class FrequencyAllocator
+{
+public:
+    typedef T value_type;
+    typedef std::true_type propagate_on_container_copy_assignment;
+    typedef std::true_type propagate_on_container_move_assignment;
+    typedef std::true_type propagate_on_container_swap;
+
+    template <typename U>
+    struct rebind
+    {
+        typedef FrequencyAllocator<U> other;
+    };
+
+    FrequencyAllocator() = default;
+
+    // an empty path maps a temporary file
+    FrequencyAllocator(bool const mapped, std::string const & path) :
+        mapped(mapped), path(std::make_shared<std::string>(path))
+    {}
+
+    template <typename U>
+    FrequencyAllocator(FrequencyAllocator<U> const & other) :
+        mapped(other.mapped), path(other.path)
+    {}
+
+    T * allocate(std::size_t const n)
+    {
+        if (!mapped)
+            return std::allocator<T>().allocate(n);
+        if (n == 0)
+            return nullptr;
+
+        int fd;
+        std::string filePath = *path;
+        if (filePath.empty())
+        {
+            char const * tmpDir = std::getenv("TMPDIR");
+            filePath = std::string(tmpDir != nullptr ? tmpDir : "/tmp") + "/genmap_frequencies.XXXXXX";
+            fd = mkstemp(&filePath[0]);
+            if (fd != -1)
+                unlink(filePath.c_str()); // the file is deleted as soon as it is unmapped
+        }
+        else
+        {
+            fd = open(filePath.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+        }
+
+        void * data = MAP_FAILED;
+        if (fd != -1 && ftruncate(fd, n * sizeof(T)) == 0)
+            data = mmap(nullptr, n * sizeof(T), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        if (fd != -1)
+            close(fd); // the mapping keeps the file open
+        if (data == MAP_FAILED)
+        {
+            throw std::runtime_error("Could not memory map the frequencies to " + filePath + ".\n"
+                                     "       Make sure that TMPDIR points to a writable directory with enough space.");
+        }
+        return static_cast<T *>(data);
+    }
+
+    void deallocate(T * const p, std::size_t const n)
+    {
+        if (!mapped)
+            std::allocator<T>().deallocate(p, n);
+        else if (p != nullptr)
+            munmap(p, n * sizeof(T));
+    }
+
+    // mapped files are zero already
+    template <typename U>
+    void construct(U * const p)
+    {
+        if (!mapped)
+            ::new (static_cast<void *>(p)) U();
+    }
+
+    template <typename U, typename... TArgs>
+    void construct(U * const p, TArgs &&... args)
+    {
+        ::new (static_cast<void *>(p)) U(std::forward<TArgs>(args)...);
+    }
+
+    template <typename U>
+    bool operator==(FrequencyAllocator<U> const & other) const
+    {
+        return mapped == other.mapped && path == other.path;
+    }
+
+    template <typename U>
+    bool operator!=(FrequencyAllocator<U> const & other) const
+    {
+        return !(*this == other);
+    }
+
+    bool mapped = false;
+    std::shared_ptr<std::string> path = std::make_shared<std::string>();
+};
@@ -5,6 +5,8 @@
 #include "genmap_helper.hpp"
 #include "indexing.hpp"
 #include "mappability.hpp"
+#include "query.hpp"
+#include "serve.hpp"
 
 template <typename TSpec, typename TLengthSum, unsigned LEVELS, unsigned WORDS_PER_BLOCK>
 unsigned GemMapFastFMIndexConfig<TSpec, TLengthSum, LEVELS, WORDS_PER_BLOCK>::SAMPLING = 10;
@@ -62,6 +64,22 @@ int main(int const argc, char const ** argv)
     {
         return indexMain(argc - until, argv + until);
     }
+    else if (std::string(argv[until]) == "serve")
+    {
+        return serveMain(argc - until, argv + until);
+    }
+    else if (std::string(argv[until]) == "client")
+    {
+        return clientMain(argc - until, argv + until);
+    }
+    else if (std::string(argv[until]) == "locations")
+    {
+        return locationsMain(argc - until, argv + until);
+    }
+    else if (std::string(argv[until]) == "query")
+    {
+        return queryMain(argc - until, argv + until);
+    }
     else
     {
         // should not be reached
@@ -83,11 +101,15 @@ ArgumentParser::ParseResult parseCommandLineMain(int const argc, char const ** a
 
     addArgument(parser, ArgParseArgument(ArgParseArgument::STRING, "COMMAND"));
     setHelpText(parser, 0, "The sub-program to execute. See below.");
-    setValidValues(parser, 0, "index map");
+    setValidValues(parser, 0, "index map serve client locations query");
 
     addTextSection(parser, "Available commands");
     addText(parser, "\\fBindex  \\fP– Creates an index for mappability computation.");
     addText(parser, "\\fBmap  \\fP– Computes the mappability (requires a pre-built index).");
+    addText(parser, "\\fBserve  \\fP– Keeps an index in memory and computes the mappability for requests sent by the client.");
+    addText(parser, "\\fBclient  \\fP– Sends a mappability computation to a running server.");
+    addText(parser, "\\fBlocations  \\fP– Converts the binary locations output to csv or looks up single k-mers.");
+    addText(parser, "\\fBquery  \\fP– Computes statistics of bed intervals on raw files with a header (min, max, mean, count).");
     addText(parser, "To view the help page for a specific command, simply run 'genmap command --help'.");
 
     return parse(parser, argc, argv);
@@ -29,6 +29,7 @@ struct IndexOptions
     uint64_t totalLength;
     unsigned sampling;
     bool directory;
+    bool doubleStrand;
     bool useSkew;
     bool verbose;
 };
@@ -102,6 +103,7 @@ void buildIndex(TChromosomes & chromosomes, IndexOptions const & options)
         StringSet<CharString, Owner<ConcatDirect<> > > info;
         uint32_t const alphabetSize = 4 + isDna5;
         std::string const directoryFlag = options.directory ? "true" : "false";
+        std::string const doubleStrandFlag = options.doubleStrand ? "true" : "false";
         appendValue(info, "alphabet_size:" + std::to_string(alphabetSize));
         appendValue(info, "sa_dimensions_i1:" + std::to_string(seqNoDigits));
         appendValue(info, "sa_dimensions_i2:" + std::to_string(seqPosDigits));
@@ -109,6 +111,7 @@ void buildIndex(TChromosomes & chromosomes, IndexOptions const & options)
         appendValue(info, "sampling_rate:" + std::to_string(options.sampling));
         appendValue(info, "fasta_directory:" + directoryFlag);
         appendValue(info, "packed_text:true");
+        appendValue(info, "double_strand:" + doubleStrandFlag);
         save(info, toCString(std::string(toCString(options.indexPath)) + ".info"));
     }
 
@@ -314,6 +317,10 @@ int indexMain(int const argc, char const ** argv)
     setMaxValue(parser, "sampling", "64");
     setMinValue(parser, "sampling", "1");
 
+    addOption(parser, ArgParseOption("ds", "double-strand", "Indexes the reverse complement of each sequence as well. "
+        "The mappability of both strands is then computed with a single search per k-mer and the results are shared "
+        "between a k-mer and its reverse complement. Doubles the size of the index. Not supported by `genmap map --edit-distance`."));
+
     addOption(parser, ArgParseOption("v", "verbose", "Outputs some additional information on the constructed index."));
 
     addOption(parser, ArgParseOption("xa", "seqno", "Number of sequences.", ArgParseArgument::INTEGER, "INT"));
@@ -373,6 +380,7 @@ int indexMain(int const argc, char const ** argv)
     }
 
     options.useSkew = algorithm == "skew";
+    options.doubleStrand = isSet(parser, "double-strand");
     options.verbose = isSet(parser, "verbose");
 
     // Check whether the index path exists and is writeable!
@@ -472,6 +480,21 @@ int indexMain(int const argc, char const ** argv)
         }
     }
 
+    // Sequence n + i is the reverse complement of sequence i (n = number of sequences in the fasta file(s)).
+    // The .ids file only lists the forward sequences.
+    if (options.doubleStrand)
+    {
+        uint64_t const nbrSequences = length(chromosomes);
+        for (uint64_t i = 0; i < nbrSequences; ++i)
+        {
+            String<Dna5, Packed<> > revCompl(chromosomes[i]);
+            reverseComplement(revCompl);
+            appendValue(chromosomes, revCompl);
+        }
+        options.seqNumber *= 2;
+        options.totalLength *= 2;
+    }
+
     // overwrite index dimensions
     if (isSet(parser, "seqno"))
     {
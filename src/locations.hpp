@@ -0,0 +1,423 @@
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <limits>
+#include <map>
+#include <queue>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <unistd.h>
+
+// Key-value pairs inserted concurrently by multiple threads. Each thread appends to a buffer of its own, i.e., without
+// any synchronization. If a buffer exceeds its share of the memory budget, it is sorted and spilled as a run to a
+// temporary file (in TMPDIR). Once a buffer has too many runs, they are merged into a single one. forEach() merges all
+// runs and the remaining buffers and visits the keys in sorted order. Each key is visited once, even if it has been
+// inserted more than once (with the smallest value, see valueLess()). insert() is called in parallel regions and thus
+// cannot throw: if a run cannot be written, the buffer drops its entries and forEach() throws the error.
+template <typename TKey, typename TValue>
+class SortedRuns
+{
+public:
+    typedef std::pair<TKey, TValue> TEntry;
+
+    SortedRuns() = default;
+    SortedRuns(SortedRuns const &) = delete;
+    SortedRuns & operator=(SortedRuns const &) = delete;
+
+    ~SortedRuns()
+    {
+        clear();
+    }
+
+    // threads has to be at least the number of threads calling insert() concurrently, memoryBudget is given in bytes.
+    void init(unsigned const threads, uint64_t const memoryBudget)
+    {
+        clear();
+        buffers = std::vector<Buffer>(threads);
+        bufferBudget = memoryBudget / std::max(threads, 1u);
+    }
+
+    template <typename TKey2>
+    void insert(TKey2 const & key, TValue const & value)
+    {
+        unsigned const thread = omp_get_thread_num();
+        SEQAN_ASSERT_LT(thread, buffers.size());
+        Buffer & buffer = buffers[thread];
+        buffer.entries.emplace_back(key, value);
+        buffer.bytes += sizeof(TEntry) + extraBytes(value);
+        if (buffer.bytes > bufferBudget)
+            spill(buffer);
+    }
+
+    // Calls f(key, value) for each key in sorted order. Call clear() afterwards, the entries are consumed.
+    template <typename TFunctor>
+    void forEach(TFunctor && f)
+    {
+        for (Buffer const & buffer : buffers)
+        {
+            if (!buffer.error.empty())
+                throw std::runtime_error(buffer.error);
+        }
+
+        std::vector<Run> runs;
+        for (Buffer & buffer : buffers)
+        {
+            sortUnique(buffer.entries);
+            runs.push_back({nullptr, &buffer.entries, 0, TEntry()});
+            for (FILE * file : buffer.files)
+            {
+                rewind(file);
+                runs.push_back({file, nullptr, 0, TEntry()});
+            }
+        }
+
+        merge(runs, [&f](TEntry const & entry) { f(entry.first, entry.second); });
+    }
+
+    void clear()
+    {
+        for (Buffer & buffer : buffers)
+        {
+            for (FILE * file : buffer.files)
+                fclose(file);
+        }
+        buffers.clear();
+    }
+
+private:
+    struct Buffer
+    {
+        std::vector<TEntry> entries;
+        uint64_t bytes = 0;
+        std::vector<FILE *> files; // one sorted run per file
+        std::string error; // the first error while spilling, no further entries are kept
+    };
+
+    // Reads the entries of a sorted run either from a buffer or a file.
+    struct Run
+    {
+        FILE * file;
+        std::vector<TEntry> * entries;
+        uint64_t pos;
+        TEntry current;
+
+        bool next()
+        {
+            if (file == nullptr)
+            {
+                if (pos == entries->size())
+                    return false;
+                current = std::move((*entries)[pos++]); // buffers are not needed after merging
+                return true;
+            }
+            return fread(&current.first, sizeof(TKey), 1, file) == 1 && readValue(file, current.second);
+        }
+    };
+
+    static constexpr uint64_t maxRunsPerBuffer = 8;
+
+    uint64_t bufferBudget = 0;
+    std::vector<Buffer> buffers;
+
+    // serialization of the values (PODs and pairs of vectors of PODs)
+
+    template <typename T>
+    static uint64_t extraBytes(T const &)
+    {
+        return 0;
+    }
+
+    template <typename T>
+    static uint64_t extraBytes(std::pair<std::vector<T>, std::vector<T> > const & value)
+    {
+        return (value.first.size() + value.second.size()) * sizeof(T);
+    }
+
+    template <typename T>
+    static void writeValue(FILE * file, T const & value)
+    {
+        fwrite(&value, sizeof(T), 1, file);
+    }
+
+    template <typename T>
+    static void writeValue(FILE * file, std::vector<T> const & values)
+    {
+        uint64_t const size = values.size();
+        fwrite(&size, sizeof(size), 1, file);
+        fwrite(values.data(), sizeof(T), size, file);
+    }
+
+    template <typename T>
+    static void writeValue(FILE * file, std::pair<std::vector<T>, std::vector<T> > const & value)
+    {
+        writeValue(file, value.first);
+        writeValue(file, value.second);
+    }
+
+    template <typename T>
+    static bool readValue(FILE * file, T & value)
+    {
+        return fread(&value, sizeof(T), 1, file) == 1;
+    }
+
+    template <typename T>
+    static bool readValue(FILE * file, std::vector<T> & values)
+    {
+        uint64_t size;
+        if (fread(&size, sizeof(size), 1, file) != 1)
+            return false;
+        values.resize(size);
+        return fread(values.data(), sizeof(T), size, file) == size;
+    }
+
+    template <typename T>
+    static bool readValue(FILE * file, std::pair<std::vector<T>, std::vector<T> > & value)
+    {
+        return readValue(file, value.first) && readValue(file, value.second);
+    }
+
+    static void writeEntry(FILE * file, TEntry const & entry)
+    {
+        fwrite(&entry.first, sizeof(TKey), 1, file);
+        writeValue(file, entry.second);
+    }
+
+    // Values of the same key are identical (a k-mer and its reverse complement share a repeat class, see repeatClass()).
+    // Ties are broken by the value anyway to keep the output deterministic.
+    template <typename T>
+    static bool valueLess(T const & a, T const & b)
+    {
+        return a < b;
+    }
+
+    template <typename T>
+    static bool valueLess(std::pair<std::vector<T>, std::vector<T> > const &, std::pair<std::vector<T>, std::vector<T> > const &)
+    {
+        return false;
+    }
+
+    static bool entryLess(TEntry const & a, TEntry const & b)
+    {
+        return a.first < b.first || (!(b.first < a.first) && valueLess(a.second, b.second));
+    }
+
+    static void sortUnique(std::vector<TEntry> & entries)
+    {
+        std::sort(entries.begin(), entries.end(), entryLess);
+        entries.erase(std::unique(entries.begin(), entries.end(), [](TEntry const & a, TEntry const & b) {
+            return !(a.first < b.first) && !(b.first < a.first);
+        }), entries.end());
+    }
+
+    // Returns nullptr on failure.
+    static FILE * createTemporaryFile()
+    {
+        char const * tmpDir = std::getenv("TMPDIR");
+        std::string path = std::string(tmpDir != nullptr ? tmpDir : "/tmp") + "/genmap_csv.XXXXXX";
+        int const fd = mkstemp(&path[0]);
+        if (fd == -1)
+            return nullptr;
+        unlink(path.c_str()); // the file is deleted as soon as it is closed
+        return fdopen(fd, "w+b");
+    }
+
+    static bool checkWrite(FILE * file)
+    {
+        return fflush(file) == 0 && !ferror(file);
+    }
+
+    static void fail(Buffer & buffer, std::string const & error)
+    {
+        buffer.error = error + "\n       Make sure that TMPDIR points to a writable directory with enough space.";
+        buffer.entries.clear();
+        buffer.bytes = 0;
+    }
+
+    // k-way merge of sorted runs, f is called once per key
+    template <typename TFunctor>
+    static void merge(std::vector<Run> & runs, TFunctor && f)
+    {
+        // min-heap of the runs ordered by their current entry
+        auto greater = [&runs](uint64_t const a, uint64_t const b) { return entryLess(runs[b].current, runs[a].current); };
+        std::priority_queue<uint64_t, std::vector<uint64_t>, decltype(greater)> heap(greater);
+        for (uint64_t i = 0; i < runs.size(); ++i)
+        {
+            if (runs[i].next())
+                heap.push(i);
+        }
+
+        bool first = true;
+        TKey last;
+        while (!heap.empty())
+        {
+            uint64_t const i = heap.top();
+            heap.pop();
+            if (first || last < runs[i].current.first)
+            {
+                f(runs[i].current);
+                last = runs[i].current.first;
+                first = false;
+            }
+            if (runs[i].next())
+                heap.push(i);
+        }
+    }
+
+    void spill(Buffer & buffer)
+    {
+        if (!buffer.error.empty())
+        {
+            buffer.entries.clear();
+            buffer.bytes = 0;
+            return;
+        }
+
+        sortUnique(buffer.entries);
+        FILE * file = createTemporaryFile();
+        if (file == nullptr)
+            return fail(buffer, "Could not create a temporary file for the csv output.");
+        buffer.files.push_back(file);
+        for (TEntry const & entry : buffer.entries)
+            writeEntry(file, entry);
+        if (!checkWrite(file))
+            return fail(buffer, "Could not write the locations for the csv output to a temporary file.");
+        buffer.entries.clear();
+        buffer.bytes = 0;
+
+        // bound the number of open files by merging the runs of a buffer into a single one
+        if (buffer.files.size() == maxRunsPerBuffer)
+        {
+            std::vector<Run> runs;
+            for (FILE * file : buffer.files)
+            {
+                rewind(file);
+                runs.push_back({file, nullptr, 0, TEntry()});
+            }
+
+            FILE * mergedFile = createTemporaryFile();
+            if (mergedFile == nullptr)
+                return fail(buffer, "Could not create a temporary file for the csv output.");
+            merge(runs, [mergedFile](TEntry const & entry) { writeEntry(mergedFile, entry); });
+            bool const written = checkWrite(mergedFile);
+
+            for (FILE * file : buffer.files)
+                fclose(file);
+            buffer.files = {mergedFile};
+            if (!written)
+                return fail(buffer, "Could not write the locations for the csv output to a temporary file.");
+        }
+    }
+};
+
+// Locations of the k-mers for the csv output, i.e., the forward and reverse strand locations of each k-mer position.
+// With deduplication (--csv-classes) the locations are stored once per repeat class (see repeatClass()) and each
+// k-mer position only refers to its class. Otherwise they are stored for each k-mer position.
+template <typename TLocation>
+class CsvLocations
+{
+public:
+    typedef TLocation key_type;
+    typedef std::pair<std::vector<TLocation>, std::vector<TLocation> > mapped_type; // forward, reverse strand
+
+    // Locations are only stored if enabled, e.g., --exclude-pseudo computes the locations without writing a csv file.
+    // threads has to be at least the number of threads calling insert() concurrently, memoryBudget is given in bytes.
+    void init(bool const enabled, bool const deduplicate, unsigned const threads, uint64_t const memoryBudget)
+    {
+        clear();
+        this->enabled = enabled;
+        this->deduplicate = deduplicate;
+        if (!enabled)
+            return;
+
+        if (deduplicate)
+        {
+            classOfPosition.init(threads, memoryBudget / 2);
+            classes.init(threads, memoryBudget / 2);
+            lastClass = std::vector<uint64_t>(threads, noClass);
+        }
+        else
+        {
+            locations.init(threads, memoryBudget);
+        }
+    }
+
+    template <typename TKey>
+    void insert(TKey const & location, mapped_type const & entry, uint64_t const repeatClass)
+    {
+        if (!enabled)
+            return;
+
+        if (deduplicate)
+        {
+            classOfPosition.insert(location, repeatClass);
+            // all exact occurrences of a k-mer are inserted right after another by the same thread
+            uint64_t & last = lastClass[omp_get_thread_num()];
+            if (last != repeatClass)
+            {
+                classes.insert(repeatClass, entry);
+                last = repeatClass;
+            }
+        }
+        else
+        {
+            locations.insert(location, entry);
+        }
+    }
+
+    // Calls f(location, forwardStrandLocations, reverseStrandLocations) for each k-mer in sorted order.
+    template <typename TFunctor>
+    void forEach(TFunctor && f)
+    {
+        locations.forEach([&f](TLocation const & location, mapped_type const & entry) { f(location, entry.first, entry.second); });
+    }
+
+    // Calls f(repeatClass, forwardStrandLocations, reverseStrandLocations) for each repeat class in sorted order.
+    template <typename TFunctor>
+    void forEachClass(TFunctor && f)
+    {
+        classes.forEach([&f](uint64_t const repeatClass, mapped_type const & entry) { f(repeatClass, entry.first, entry.second); });
+    }
+
+    // Calls f(location, repeatClass) for each k-mer in sorted order.
+    template <typename TFunctor>
+    void forEachPosition(TFunctor && f)
+    {
+        classOfPosition.forEach(f);
+    }
+
+    void clear()
+    {
+        locations.clear();
+        classOfPosition.clear();
+        classes.clear();
+        lastClass.clear();
+    }
+
+private:
+    static constexpr uint64_t noClass = std::numeric_limits<uint64_t>::max();
+
+    bool enabled = false;
+    bool deduplicate = false;
+    SortedRuns<TLocation, mapped_type> locations;
+    SortedRuns<TLocation, uint64_t> classOfPosition;
+    SortedRuns<uint64_t, mapped_type> classes;
+    std::vector<uint64_t> lastClass; // per thread
+};
+
+// Inserts the locations of a k-mer (kernels are called concurrently). std::map is only used by the tests.
+template <typename TKey, typename TValue, typename TLocation>
+inline void insertLocation(std::map<TKey, TValue> & locations, TLocation const & location, TValue const & entry,
+                           uint64_t const /*repeatClass*/)
+{
+    #pragma omp critical
+    locations.emplace(location, entry);
+}
+
+template <typename TKey, typename TLocation>
+inline void insertLocation(CsvLocations<TKey> & locations, TLocation const & location,
+                           typename CsvLocations<TKey>::mapped_type const & entry, uint64_t const repeatClass)
+{
+    locations.insert(location, entry, repeatClass);
+}
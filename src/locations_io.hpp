@@ -0,0 +1,430 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <seqan/arg_parse.h>
+
+#include "genmap_helper.hpp"
+
+using namespace seqan;
+
+// Binary locations format (.loc), a compact alternative to the csv output. The k-mers are stored in sorted order, the
+// columns of the csv file (locations on the forward and reverse strand, separately for each fasta file) are stored as
+// sections of each k-mer. All integers are LEB128 varints unless stated otherwise.
+//
+// magic "GMLOC01\0" (8 bytes)
+// header:  K, E, flags (bit 0: reverse strand sections), block size, number of fasta files,
+//          for each fasta file: length and characters of its name, number of sequences in all previous fasta files
+// records: for each k-mer
+//          position: sequence id (delta to the previous k-mer), position (delta if the sequence id is the same)
+//          for each strand (forward [, reverse]) and fasta file: number of locations, followed by each location, i.e.,
+//          sequence id within the fasta file (delta), position (delta if the sequence id is the same)
+//          The first record of each block (of block size k-mers) and the first location of each section are stored
+//          without deltas.
+// index:   for each block: byte offset of its first record, sequence id and position of its first k-mer (uint64_t)
+// trailer: number of k-mers, number of blocks, byte offset of the index (uint64_t), magic "GMLOCEND" (8 bytes)
+
+constexpr char locationsMagic[] = "GMLOC01";
+constexpr char locationsEndMagic[] = "GMLOCEND";
+constexpr uint64_t locationsBlockSize = 4096; // k-mers per block of the index
+
+inline void writeVarint(std::ostream & out, uint64_t value)
+{
+    while (value >= 0x80)
+    {
+        out.put(static_cast<char>((value & 0x7F) | 0x80));
+        value >>= 7;
+    }
+    out.put(static_cast<char>(value));
+}
+
+inline bool readVarint(std::istream & in, uint64_t & value)
+{
+    value = 0;
+    for (unsigned shift = 0; shift < 64; shift += 7)
+    {
+        int const c = in.get();
+        if (c == EOF)
+            return false;
+        value |= static_cast<uint64_t>(c & 0x7F) << shift;
+        if ((c & 0x80) == 0)
+            return true;
+    }
+    return false;
+}
+
+inline void writeUint64(std::ostream & out, uint64_t const value)
+{
+    out.write(reinterpret_cast<char const *>(&value), sizeof(value));
+}
+
+inline bool readUint64(std::istream & in, uint64_t & value)
+{
+    return static_cast<bool>(in.read(reinterpret_cast<char *>(&value), sizeof(value)));
+}
+
+// A location (sequence id, position), the sequence id is either global or local to a fasta file.
+typedef std::pair<uint64_t, uint64_t> TLocationPair;
+
+// Delta encoding of a sorted sequence of locations.
+struct LocationDeltaCoder
+{
+    TLocationPair last{0, 0};
+
+    void encode(std::ostream & out, TLocationPair const & location)
+    {
+        writeVarint(out, location.first - last.first);
+        writeVarint(out, location.first == last.first ? location.second - last.second : location.second);
+        last = location;
+    }
+
+    bool decode(std::istream & in, TLocationPair & location)
+    {
+        uint64_t seqDelta, pos;
+        if (!readVarint(in, seqDelta) || !readVarint(in, pos))
+            return false;
+        location.first = last.first + seqDelta;
+        location.second = seqDelta == 0 ? last.second + pos : pos;
+        last = location;
+        return true;
+    }
+};
+
+// Writes the locations of the k-mers (see CsvLocations) in the binary format, the equivalent of saveCsv().
+template <typename TLocations, typename TDirectoryInformation, typename TCSVIntervals>
+void saveLocationsBinary(std::string const & output_path, TLocations & locations,
+                         SearchParams const & searchParams, TDirectoryInformation const & directoryInformation,
+                         TCSVIntervals const & csvIntervals, bool const outputSelection)
+{
+    char buffer[BUFFER_SIZE];
+
+    std::ofstream file(output_path + ".loc", std::ios::out | std::ios::binary);
+    file.rdbuf()->pubsetbuf(buffer, BUFFER_SIZE);
+
+    auto const fastaFiles = csvFastaFiles(directoryInformation);
+    unsigned const nbrStrands = searchParams.revCompl ? 2 : 1;
+
+    file.write(locationsMagic, 8);
+    writeVarint(file, searchParams.length);
+    writeVarint(file, searchParams.errors);
+    writeVarint(file, searchParams.revCompl ? 1 : 0);
+    writeVarint(file, locationsBlockSize);
+    writeVarint(file, fastaFiles.size());
+    uint64_t nbrChromosomesInPreviousFastas = 0;
+    for (auto const & fastaFile : fastaFiles)
+    {
+        writeVarint(file, fastaFile.first.size());
+        file.write(fastaFile.first.data(), fastaFile.first.size());
+        writeVarint(file, nbrChromosomesInPreviousFastas);
+        nbrChromosomesInPreviousFastas = fastaFile.second + 1;
+    }
+
+    std::vector<uint64_t> index; // offset, sequence id and position of the first k-mer of each block
+    uint64_t nbrKmers = 0;
+    LocationDeltaCoder kmerCoder;
+    auto interval = csvIntervals.begin();
+
+    locations.forEach([&](auto const & kmerPos, auto const & plusStrandLoc, auto const & minusStrandLoc)
+    {
+        if (!csvSelected(interval, csvIntervals, kmerPos, outputSelection))
+            return;
+
+        if (nbrKmers % locationsBlockSize == 0)
+        {
+            index.insert(index.end(), {static_cast<uint64_t>(file.tellp()), static_cast<uint64_t>(kmerPos.i1), static_cast<uint64_t>(kmerPos.i2)});
+            kmerCoder = LocationDeltaCoder();
+        }
+        ++nbrKmers;
+
+        kmerCoder.encode(file, {kmerPos.i1, kmerPos.i2});
+
+        for (unsigned strand = 0; strand < nbrStrands; ++strand)
+        {
+            auto const & strandLoc = (strand == 0) ? plusStrandLoc : minusStrandLoc;
+            uint64_t i = 0;
+            uint64_t nbrChromosomesInPreviousFastas = 0;
+            for (auto const & fastaFile : fastaFiles)
+            {
+                uint64_t end = i;
+                while (end < strandLoc.size() && strandLoc[end].i1 <= fastaFile.second)
+                    ++end;
+
+                writeVarint(file, end - i);
+                LocationDeltaCoder locationCoder;
+                for (; i < end; ++i)
+                    locationCoder.encode(file, {strandLoc[i].i1 - nbrChromosomesInPreviousFastas, strandLoc[i].i2});
+
+                nbrChromosomesInPreviousFastas = fastaFile.second + 1;
+            }
+        }
+    });
+
+    uint64_t const indexOffset = file.tellp();
+    for (uint64_t const value : index)
+        writeUint64(file, value);
+    writeUint64(file, nbrKmers);
+    writeUint64(file, index.size() / 3);
+    writeUint64(file, indexOffset);
+    file.write(locationsEndMagic, 8);
+
+    file.close();
+}
+
+// Sequential and random access to a file in the binary locations format.
+class LocationsReader
+{
+public:
+    struct Record
+    {
+        TLocationPair kmer; // global sequence id, position
+        std::vector<std::vector<TLocationPair> > locations; // [strand * nbrFastaFiles + fasta file], local sequence ids
+    };
+
+    unsigned length = 0;
+    unsigned errors = 0;
+    bool revCompl = false;
+    std::vector<std::string> fastaFiles;
+    uint64_t nbrKmers = 0;
+
+    bool open(std::string const & path)
+    {
+        file.open(path, std::ios::in | std::ios::binary);
+        char magic[8];
+        if (!file.read(magic, 8) || memcmp(magic, locationsMagic, 8) != 0)
+            return false;
+
+        uint64_t value, nbrFastaFiles;
+        if (!readVarint(file, value))
+            return false;
+        length = value;
+        if (!readVarint(file, value))
+            return false;
+        errors = value;
+        if (!readVarint(file, value))
+            return false;
+        revCompl = value & 1;
+        if (!readVarint(file, blockSize) || !readVarint(file, nbrFastaFiles))
+            return false;
+        for (uint64_t i = 0; i < nbrFastaFiles; ++i)
+        {
+            uint64_t nameLength, nbrChromosomesInPreviousFastas;
+            if (!readVarint(file, nameLength))
+                return false;
+            std::string name(nameLength, ' ');
+            if (!file.read(&name[0], nameLength) || !readVarint(file, nbrChromosomesInPreviousFastas))
+                return false;
+            fastaFiles.push_back(name);
+        }
+        recordsOffset = file.tellg();
+
+        // trailer and index
+        uint64_t nbrBlocks, indexOffset;
+        file.seekg(-32, std::ios::end);
+        if (!readUint64(file, nbrKmers) || !readUint64(file, nbrBlocks) || !readUint64(file, indexOffset) ||
+            !file.read(magic, 8) || memcmp(magic, locationsEndMagic, 8) != 0)
+        {
+            return false;
+        }
+        file.seekg(indexOffset);
+        blocks.resize(nbrBlocks);
+        for (Block & block : blocks)
+        {
+            if (!readUint64(file, block.offset) || !readUint64(file, block.firstKmer.first) ||
+                !readUint64(file, block.firstKmer.second))
+            {
+                return false;
+            }
+        }
+
+        file.seekg(recordsOffset);
+        kmerNo = 0;
+        return true;
+    }
+
+    // Reads the next k-mer, returns false if all k-mers have been read.
+    bool next(Record & record)
+    {
+        if (kmerNo == nbrKmers)
+            return false;
+        if (kmerNo % blockSize == 0)
+            kmerCoder = LocationDeltaCoder();
+        ++kmerNo;
+
+        if (!kmerCoder.decode(file, record.kmer))
+            return false;
+
+        unsigned const nbrStrands = revCompl ? 2 : 1;
+        record.locations.resize(nbrStrands * fastaFiles.size());
+        for (auto & section : record.locations)
+        {
+            uint64_t count;
+            if (!readVarint(file, count))
+                return false;
+            section.resize(count);
+            LocationDeltaCoder locationCoder;
+            for (auto & location : section)
+            {
+                if (!locationCoder.decode(file, location))
+                    return false;
+            }
+        }
+        return true;
+    }
+
+    // Moves to the block containing the given k-mer position, i.e., the following calls of next() reach it after at
+    // most block size k-mers.
+    void seek(TLocationPair const & kmer)
+    {
+        // the last block whose first k-mer is not larger than the given one (or the first block)
+        auto block = std::upper_bound(blocks.begin(), blocks.end(), kmer, [](TLocationPair const & k, Block const & b) {
+            return k < b.firstKmer;
+        });
+        if (block != blocks.begin())
+            --block;
+        file.clear();
+        file.seekg(blocks.empty() ? recordsOffset : block->offset);
+        kmerNo = (block - blocks.begin()) * blockSize;
+    }
+
+private:
+    struct Block
+    {
+        uint64_t offset; // of its first record
+        TLocationPair firstKmer;
+    };
+
+    std::ifstream file;
+    uint64_t blockSize = locationsBlockSize;
+    uint64_t recordsOffset = 0;
+    std::vector<Block> blocks; // index
+    uint64_t kmerNo = 0;
+    LocationDeltaCoder kmerCoder;
+};
+
+// Writes a k-mer of the binary locations format as a line of the csv output (see saveCsv()).
+inline void writeCsvRecord(std::ostream & csvFile, LocationsReader::Record const & record)
+{
+    csvFile << record.kmer.first << ',' << record.kmer.second;
+    for (auto const & section : record.locations)
+    {
+        csvFile << ';';
+        for (uint64_t i = 0; i < section.size(); ++i)
+        {
+            if (i > 0)
+                csvFile << '|'; // separator for multiple locations in one column
+            csvFile << section[i].first << ',' << section[i].second;
+        }
+    }
+    csvFile << '\n';
+}
+
+inline void writeCsvHeader(std::ostream & csvFile, LocationsReader const & reader)
+{
+    csvFile << "\"k-mer\"";
+    for (auto const & fastaFile : reader.fastaFiles)
+        csvFile << ";\"+ strand " << fastaFile << "\"";
+    if (reader.revCompl)
+    {
+        for (auto const & fastaFile : reader.fastaFiles)
+            csvFile << ";\"- strand " << fastaFile << "\"";
+    }
+    csvFile << '\n';
+}
+
+int locationsMain(int const argc, char const ** argv)
+{
+    ArgumentParser parser("GenMap locations");
+    sharedSetup(parser);
+    addDescription(parser, "Reads the binary locations output of `genmap map --locations-binary` (.loc). "
+                           "Converts it to the csv output of `genmap map --csv`, or prints the locations of a single k-mer.");
+
+    addOption(parser, ArgParseOption("I", "input", "Path to the .loc file.", ArgParseArgument::INPUT_FILE, "IN"));
+    setRequired(parser, "input");
+
+    addOption(parser, ArgParseOption("O", "output", "Path to the csv file (the entire file is converted).", ArgParseArgument::OUTPUT_FILE, "OUT"));
+
+    addOption(parser, ArgParseOption("k", "kmer", "Prints the locations of the k-mer at a position given by the sequence id and the position, "
+        "e.g., 0,1234 (same numbering as in the csv file). Uses the index of the file instead of reading it entirely.", ArgParseArgument::STRING, "SEQ,POS"));
+
+    ArgumentParser::ParseResult res = parse(parser, argc, argv);
+    if (res != ArgumentParser::PARSE_OK)
+        return res == ArgumentParser::PARSE_ERROR;
+
+    if (isSet(parser, "output") == isSet(parser, "kmer"))
+    {
+        std::cerr << "ERROR: Please choose either --output or --kmer.\n";
+        return ArgumentParser::PARSE_ERROR;
+    }
+
+    CharString inputPath;
+    getOptionValue(inputPath, parser, "input");
+
+    LocationsReader reader;
+    if (!reader.open(toCString(inputPath)))
+    {
+        std::cerr << "ERROR: " << inputPath << " is not a valid binary locations file.\n";
+        return ArgumentParser::PARSE_ERROR;
+    }
+
+    LocationsReader::Record record;
+
+    if (isSet(parser, "output"))
+    {
+        CharString outputPath;
+        getOptionValue(outputPath, parser, "output");
+
+        char buffer[BUFFER_SIZE];
+        std::ofstream csvFile(toCString(outputPath));
+        csvFile.rdbuf()->pubsetbuf(buffer, BUFFER_SIZE);
+
+        writeCsvHeader(csvFile, reader);
+        while (reader.next(record))
+            writeCsvRecord(csvFile, record);
+        csvFile.close();
+        return 0;
+    }
+
+    std::string kmer;
+    getOptionValue(kmer, parser, "kmer");
+    auto const separator = kmer.find(',');
+    // both fields have to be non-empty and fit into 64 bits
+    bool valid = separator != std::string::npos && separator != 0 && separator + 1 != kmer.size() &&
+                 kmer.find_first_not_of("0123456789,") == std::string::npos && kmer.find(',', separator + 1) == std::string::npos;
+    TLocationPair kmerPos;
+    if (valid)
+    {
+        try
+        {
+            kmerPos = {std::stoull(kmer.substr(0, separator)), std::stoull(kmer.substr(separator + 1))};
+        }
+        catch (std::out_of_range const &)
+        {
+            valid = false;
+        }
+    }
+    if (!valid)
+    {
+        std::cerr << "ERROR: --kmer has to be given as SEQ,POS (e.g., 0,1234).\n";
+        return ArgumentParser::PARSE_ERROR;
+    }
+
+    reader.seek(kmerPos);
+    while (reader.next(record) && record.kmer <= kmerPos)
+    {
+        if (record.kmer == kmerPos)
+        {
+            writeCsvHeader(std::cout, reader);
+            writeCsvRecord(std::cout, record);
+            return 0;
+        }
+    }
+
+    std::cerr << "ERROR: The k-mer " << kmer << " is not contained in " << inputPath << ".\n";
+    return 1;
+}
@@ -1,6 +1,8 @@
 #include <vector>
 #include <cstdint>
 #include <limits>
+#include <set>
+#include <stdexcept>
 #include <sys/stat.h>
 
 #include <seqan/arg_parse.h>
@@ -10,11 +12,16 @@
 
 static constexpr bool outputProgress = true; // TODO: remove global variable
 
-enum OutputType
+#include "common.hpp"
+#include "algo.hpp"
+#include "output.hpp"
+#include "bigwig.hpp"
+
+enum RawFormat
 {
-    mappability,     // float (32 bit)
-    frequency_large, // uint16_t (16 bit)
-    frequency_small  // uint8_t (8 bit)
+    plain,  // std::vector<T> without a header
+    rle,    // run-length encoded blocks with a header (see raw.hpp)
+    aligned // std::vector<T> of each chromosome with a header, aligned for memory mapping (see raw.hpp)
 };
 
 struct Options
@@ -23,14 +30,25 @@ struct Options
     bool wigFile; // group files into mergable flags, i.e., BED | WIG, etc.
     bool bedFile;
     bool bedgraphFile;
+    bool bigwigFile;
     bool rawFile;
     bool txtFile;
     bool csvFile;
+    bool csvClasses; // csv output deduplicated by repeat class (implies csvFile)
+    bool locationsBinary; // binary instead of csv output of the locations (implies csvFile)
+    bool uniqueMask; // bit mask and bed file of the unique k-mers
     bool outputPathIncludesFilename;
     OutputType outputType;
+    RawFormat rawFormat;
+    bool editDistance;
+    uint64_t csvMemory; // in MB
+    uint64_t windowSize; // in bases, 0 if the chromosomes of a fasta file are not split into windows
+    bool mmapFrequencies; // frequencies are stored in memory mapped files instead of main memory
+    bool compactFrequencies; // frequencies are stored in CompactFrequencies instead of std::vector
     bool directory;
     bool verbose;
     bool packed_text;
+    bool doubleStrand; // index contains the reverse complement of each sequence (genmap index --double-strand)
     CharString indexPath;
     CharString outputPath;
     CharString selectionPath;
@@ -38,13 +56,15 @@ struct Options
     uint32_t seqNoWidth;
     uint32_t maxSeqLengthWidth;
     uint32_t totalLengthWidth;
-    unsigned errors;
     unsigned sampling;
+    int serverSocket; // listening socket of `genmap serve`, -1 otherwise
+    std::ostream * errors = &std::cerr; // error messages of a request are forwarded to the client by `genmap serve`
 };
 
-#include "common.hpp"
-#include "algo.hpp"
-#include "output.hpp"
+#include "raw.hpp"
+#include "frequency_allocator.hpp"
+#include "compact_frequencies.hpp"
+#include "locations_io.hpp"
 
 using namespace seqan;
 
@@ -60,55 +80,96 @@ inline std::string retrieve(StringSet<CharString, TSpec> const & info, std::stri
 
     if (key == "packed_text") // this key was introduced later and might be missing in older indices
         return "false"; // older indices have unpacked/uncompressed texts
+    if (key == "double_strand") // this key was introduced later and might be missing in older indices
+        return "false";
 
     // This should never happen unless the index file is corrupted or manipulated.
     std::cout << "ERROR: Malformed index.info file! Could not find key '" << key << "'.\n";
     exit(1);
 }
 
+// Path of the output files of a fasta file without the file extension.
+inline std::string outputFilePrefix(Options const & opt, std::string const & fastaFile, std::string const & suffix)
+{
+    std::string output_path = std::string(toCString(opt.outputPath));
+    if (!opt.outputPathIncludesFilename)
+        output_path += fastaFile.substr(0, fastaFile.find_last_of('.')) + ".genmap";
+    return output_path + suffix;
+}
+
+// Path of the plain raw output file of a fasta file.
+inline std::string rawFilePath(Options const & opt, std::string const & fastaFile, std::string const & suffix)
+{
+    std::string const output_path = outputFilePrefix(opt, fastaFile, suffix);
+    if (opt.outputType == OutputType::mappability)
+        return output_path + ".map";
+    else if (opt.outputType == OutputType::mappability_half)
+        return output_path + ".map16";
+    else if (opt.outputType == OutputType::mappability_quantized)
+        return output_path + ".map8";
+    else if (opt.outputType == OutputType::frequency_small)
+        return output_path + ".freq8";
+    else if (opt.compactFrequencies) // exact frequencies (see run())
+        return output_path + ".freq32";
+    else // if (opt.outputType == OutputType::frequency_large)
+        return output_path + ".freq16";
+}
+
 template <typename TVector, typename TChromosomeNames, typename TChromosomeLengths, typename TLocations, typename TDirectoryInformation, typename TIntervals, typename TCSVIntervals>
 inline void outputMappability(TVector & c, Options const & opt, SearchParams const & searchParams,
-                              std::string const & fastaFile, TChromosomeNames const & chromNames,
+                              std::string const & fastaFile, std::string const & suffix, TChromosomeNames const & chromNames,
                               TChromosomeLengths const & chromLengths, TLocations & locations,
                               TDirectoryInformation const & directoryInformation,
-                              TIntervals const & intervals, TCSVIntervals const & csvIntervals, bool const completeSameKmers)
+                              TIntervals const & intervals, TCSVIntervals const & csvIntervals, bool const completeSameKmers,
+                              bool const append)
 {
-    std::string output_path = std::string(toCString(opt.outputPath));
-    if (!opt.outputPathIncludesFilename)
-        output_path += fastaFile.substr(0, fastaFile.find_last_of('.')) + ".genmap";
+    std::string const output_path = outputFilePrefix(opt, fastaFile, suffix);
 
     bool const outputSelection = opt.selectionPath != "";
 
     // reset mappability values that have been computed by accident using optimizations (copying values from same k-mers)
-    if (outputSelection && completeSameKmers && (opt.rawFile || opt.txtFile || opt.wigFile || opt.bedgraphFile || opt.bedFile))
+    if (outputSelection && completeSameKmers && (opt.rawFile || opt.txtFile || opt.wigFile || opt.bedgraphFile || opt.bedFile || opt.bigwigFile || opt.uniqueMask))
     {
         uint64_t last_interval_end = 0;
         for (auto const & interval : intervals) // triplets: chromosomeNamesId, interval.first, interval.second
         {
             for (uint64_t i = last_interval_end; i < std::get<0>(interval); ++i)
             {
-                c[i] = 0;
+                storeFrequency(c, i, 0);
             }
             last_interval_end = std::get<1>(interval);
         }
 
         for (uint64_t i = last_interval_end; i < c.size(); ++i)
         {
-            c[i] = 0;
+            storeFrequency(c, i, 0);
         }
     }
 
     if (opt.rawFile)
     {
         double start = get_wall_time();
-        std::string output_path2 = output_path;
-        if (opt.outputType == OutputType::mappability)
-            output_path2 += ".map";
-        else if (opt.outputType == OutputType::frequency_small)
-            output_path2 += ".freq8";
-        else // if (opt.outputType == OutputType::frequency_large)
-            output_path2 += ".freq16";
-        saveRaw(c, output_path2, (opt.outputType == OutputType::mappability));
+        std::string const output_path2 = rawFilePath(opt, fastaFile, suffix);
+
+        if (opt.rawFormat != RawFormat::plain)
+        {
+            RawInfo info;
+            info.length = searchParams.length;
+            info.errors = searchParams.errors;
+            info.flags = searchParams.revCompl | (searchParams.excludePseudo << 1) | (opt.editDistance << 2);
+            if (opt.rawFormat == RawFormat::rle)
+                saveRawRle(c, output_path2 + ".rle", chromNames, chromLengths, opt.outputType, info, searchParams.threads);
+            else
+                saveRawAligned(c, output_path2 + ".raw", chromNames, chromLengths, opt.outputType, info, searchParams.threads);
+        }
+        else if (!c.empty() && c.get_allocator().mapped && *c.get_allocator().path == output_path2)
+        {
+            // the frequencies are mapped to the raw file already (--mmap-frequencies), it is written when unmapped
+        }
+        else
+        {
+            saveRaw(c, output_path2, opt.outputType, searchParams.threads, append);
+        }
         if (opt.verbose)
             std::cout << "- RAW file written in " << (round((get_wall_time() - start) * 100.0) / 100.0) << " seconds\n";
     }
@@ -116,7 +177,7 @@ inline void outputMappability(TVector & c, Options const & opt, SearchParams con
     if (opt.txtFile)
     {
         double start = get_wall_time();
-        saveTxt(c, output_path, chromNames, chromLengths, (opt.outputType == OutputType::mappability));
+        saveTxt(c, output_path, chromNames, chromLengths, opt.outputType, searchParams.threads, append);
         if (opt.verbose)
             std::cout << "- TXT file written in " << (round((get_wall_time() - start) * 100.0) / 100.0) << " seconds\n";
     }
@@ -124,7 +185,7 @@ inline void outputMappability(TVector & c, Options const & opt, SearchParams con
     if (opt.wigFile)
     {
         double start = get_wall_time();
-        saveWig(c, output_path, chromNames, chromLengths, (opt.outputType == OutputType::mappability));
+        saveWig(c, output_path, chromNames, chromLengths, opt.outputType, searchParams.threads, append);
         if (opt.verbose)
             std::cout << "- WIG file written in " << (round((get_wall_time() - start) * 100.0) / 100.0) << " seconds\n";
     }
@@ -132,68 +193,119 @@ inline void outputMappability(TVector & c, Options const & opt, SearchParams con
     if (opt.bedgraphFile)
     {
         double start = get_wall_time();
-        saveBedGraph(c, output_path, chromNames, chromLengths, true /* bedgraph-file */, (opt.outputType == OutputType::mappability));
+        saveBedGraph(c, output_path, chromNames, chromLengths, true /* bedgraph-file */, opt.outputType, searchParams.threads, append);
         if (opt.verbose)
             std::cout << "- bedgraph file written in " << (round((get_wall_time() - start) * 100.0) / 100.0) << " seconds\n";
     }
 
+    if (opt.bigwigFile)
+    {
+        double start = get_wall_time();
+        saveBigWig(c, output_path, chromNames, chromLengths, opt.outputType, searchParams.threads);
+        if (opt.verbose)
+            std::cout << "- bigWig file written in " << (round((get_wall_time() - start) * 100.0) / 100.0) << " seconds\n";
+    }
+
     if (opt.bedFile)
     {
         double start = get_wall_time();
-        saveBedGraph(c, output_path, chromNames, chromLengths, false /* bed-file */, (opt.outputType == OutputType::mappability));
+        saveBedGraph(c, output_path, chromNames, chromLengths, false /* bed-file */, opt.outputType, searchParams.threads, append);
         if (opt.verbose)
             std::cout << "- BED file written in " << (round((get_wall_time() - start) * 100.0) / 100.0) << " seconds\n";
     }
 
+    if (opt.uniqueMask)
+    {
+        double start = get_wall_time();
+        saveUniqueMask(c, output_path, chromNames, chromLengths, searchParams.threads, append);
+        if (opt.verbose)
+            std::cout << "- Unique mask written in " << (round((get_wall_time() - start) * 100.0) / 100.0) << " seconds\n";
+    }
+
     if (opt.csvFile)
     {
         double start = get_wall_time();
-        saveCsv(output_path, locations, searchParams, directoryInformation, csvIntervals, outputSelection);
+        if (opt.csvClasses)
+            saveCsvClasses(output_path, locations, searchParams, directoryInformation, csvIntervals, outputSelection);
+        else if (opt.locationsBinary)
+            saveLocationsBinary(output_path, locations, searchParams, directoryInformation, csvIntervals, outputSelection);
+        else
+            saveCsv(output_path, locations, searchParams, directoryInformation, csvIntervals, outputSelection);
         if (opt.verbose)
             std::cout << "- CSV file written in " << (round((get_wall_time() - start) * 100.0) / 100.0) << " seconds\n";
     }
 }
 
-template <typename TDistance, typename value_type, typename TSeqNo, typename TSeqPos,
+inline std::string combinationSuffix(SearchParams const & params)
+{
+    return ".K" + std::to_string(params.length) + ".E" + std::to_string(params.errors);
+}
+
+// Computes and outputs the mappability of text, i.e., of all chromosomes of a fasta file or of a window of them (see
+// --window-size). The output files of the preceding windows of the fasta file are extended if append is set.
+// TFrequencies is the type of the frequency vectors (a std::vector with a FrequencyAllocator or CompactFrequencies).
+template <typename TDistance, typename TFrequencies, typename TSeqNo, typename TSeqPos,
           typename TIndex, typename TText, typename TChromosomeNames, typename TChromosomeLengths, typename TDirectoryInformation,
           typename TIntervals, typename TCSVIntervals>
-inline void run(TIndex & index, TText const & text, Options const & opt, SearchParams const & searchParams,
-                std::string const & fastaFile, TChromosomeNames const & chromNames, TChromosomeLengths const & chromLengths, TChromosomeLengths const & chromCumLengths,
-                TDirectoryInformation const & directoryInformation, std::vector<TSeqNo> const & mappingSeqIdFile,
-                TIntervals const & intervals, TCSVIntervals const & csvIntervals,
-                uint64_t const currentFileNo, uint64_t const totalFileNo)
+inline void runWindow(TIndex & index, TText const & text, Options const & opt, std::vector<SearchParams> const & combinations,
+                      std::string const & fastaFile, TChromosomeNames const & chromNames, TChromosomeLengths const & chromLengths, TChromosomeLengths const & chromCumLengths,
+                      TDirectoryInformation const & directoryInformation, std::vector<TSeqNo> const & mappingSeqIdFile,
+                      TIntervals const & intervals, TCSVIntervals const & csvIntervals,
+                      uint64_t const currentFileNo, uint64_t const totalFileNo, bool const append, bool const lastWindow)
 {
-    std::vector<value_type> c(length(text), 0);
-
-    std::map<Pair<TSeqNo, TSeqPos>,
-             std::pair<std::vector<Pair<TSeqNo, TSeqPos> >,
-                       std::vector<Pair<TSeqNo, TSeqPos> > > > locations;
-
-    bool const csvComputation = opt.csvFile || searchParams.excludePseudo;
-    bool completeSameKmers = true;
-
-    switch (opt.errors)
-    {
-        case 0:  computeMappability<0>(index, text, c, searchParams, opt.directory, chromLengths, chromCumLengths, locations, mappingSeqIdFile, intervals, completeSameKmers, currentFileNo, totalFileNo, csvComputation);
-                 break;
-        case 1:  computeMappability<1>(index, text, c, searchParams, opt.directory, chromLengths, chromCumLengths, locations, mappingSeqIdFile, intervals, completeSameKmers, currentFileNo, totalFileNo, csvComputation);
-                 break;
-        case 2:  computeMappability<2>(index, text, c, searchParams, opt.directory, chromLengths, chromCumLengths, locations, mappingSeqIdFile, intervals, completeSameKmers, currentFileNo, totalFileNo, csvComputation);
-                 break;
-        case 3:  computeMappability<3>(index, text, c, searchParams, opt.directory, chromLengths, chromCumLengths, locations, mappingSeqIdFile, intervals, completeSameKmers, currentFileNo, totalFileNo, csvComputation);
-                 break;
-        case 4:  computeMappability<4>(index, text, c, searchParams, opt.directory, chromLengths, chromCumLengths, locations, mappingSeqIdFile, intervals, completeSameKmers, currentFileNo, totalFileNo, csvComputation);
-                 break;
-        default: std::cerr << "E > 4 not yet supported.\n";
-                 exit(1);
+    typedef CsvLocations<Pair<TSeqNo, TSeqPos> > TLocations;
+    typedef typename TFrequencies::value_type value_type;
+
+    // The plain raw output of the frequencies of an entire fasta file is identical to the frequency vector, i.e., with
+    // --mmap-frequencies the raw file itself is mapped. Otherwise temporary files are mapped.
+    bool const mapRawFile = opt.mmapFrequencies && opt.rawFile && opt.rawFormat == RawFormat::plain &&
+                            !isMappability(opt.outputType) && opt.windowSize == 0 && !opt.compactFrequencies;
+
+    // the results of all (K, E) combinations are kept in memory until all of them have been computed
+    std::vector<TFrequencies> c;
+    std::vector<TLocations> locations(combinations.size());
+    std::vector<MappabilityCombination<TFrequencies, TLocations> > mappabilityCombinations;
+    c.reserve(combinations.size()); // mappabilityCombinations keeps references to the elements of c
+    for (uint64_t i = 0; i < combinations.size(); ++i)
+    {
+        std::string mappedPath;
+        if (mapRawFile)
+            mappedPath = rawFilePath(opt, fastaFile, (combinations.size() > 1) ? combinationSuffix(combinations[i]) : "");
+        c.emplace_back(FrequencyAllocator<value_type>(opt.mmapFrequencies, mappedPath));
+        c[i].resize(length(text)); // zero
+        // --exclude-pseudo computes the locations as well, but they only need to be stored for the csv output
+        locations[i].init(opt.csvFile, opt.csvClasses, combinations[i].threads, (opt.csvMemory << 20) / combinations.size());
+        mappabilityCombinations.push_back({combinations[i], c[i], locations[i], true});
+
+        // a single search counts the occurrences on both strands
+        if (opt.doubleStrand)
+        {
+            mappabilityCombinations.back().params.revCompl = false;
+            mappabilityCombinations.back().params.doubleStrand = true;
+        }
+    }
+
+    bool const csvComputation = opt.csvFile || combinations[0].excludePseudo;
+
+    // The locations of exact repeats refer to the chromosomes of the entire fasta file, not to the ones of the window.
+    // Hence, windows do not copy frequencies to the other occurrences of an exact repeat if the locations are needed.
+    bool const directory = opt.directory || (opt.windowSize > 0 && csvComputation);
+
+    // windows without any selected intervals are written with a frequency of 0
+    if (opt.selectionPath == "" || !intervals.empty())
+    {
+        computeMappability<TDistance>(index, text, mappabilityCombinations, directory, chromLengths, chromCumLengths, mappingSeqIdFile,
+                           intervals, currentFileNo, totalFileNo, csvComputation);
     }
+
+    // the progress of a window that is not the last one of the fasta file is overwritten by the next window
     SEQAN_IF_CONSTEXPR (outputProgress)
     {
-        if (totalFileNo == 1)
+        if (lastWindow && totalFileNo == 1)
         {
             std::cout << "\rProgress: 100.00%\x1b[K\n" << std::flush; // \e[K - clr_eol (remove anything after the cursor)
         }
-        else
+        else if (lastWindow)
         {
             std::cout << "\r" // go up one line
                       << "File " << currentFileNo << " / " << totalFileNo << ". Progress: 100.00 %\x1b[K" << std::flush;
@@ -205,28 +317,130 @@ inline void run(TIndex & index, TText const & text, Options const & opt, SearchP
         }
     }
 
-    outputMappability(c, opt, searchParams, fastaFile, chromNames, chromLengths, locations, directoryInformation, intervals, csvIntervals, completeSameKmers);
+    if (opt.verbose)
+    {
+        for (auto const & combination : mappabilityCombinations)
+        {
+            if (combination.params.autoOverlap)
+            {
+                std::cout << "Overlap (auto) for K = " << combination.params.length << ", E = " << combination.params.errors
+                          << ": " << (combination.params.length - combination.params.overlap) << '\n';
+            }
+        }
+    }
+
+    for (uint64_t i = 0; i < combinations.size(); ++i)
+    {
+        // output files of a parameter sweep are distinguished by K and E, e.g., genome.genmap.K36.E2.wig
+        std::string suffix;
+        if (combinations.size() > 1)
+            suffix = combinationSuffix(combinations[i]);
+
+        outputMappability(c[i], opt, combinations[i], fastaFile, suffix, chromNames, chromLengths, locations[i], directoryInformation, intervals, csvIntervals, mappabilityCombinations[i].completeSameKmers, append);
+
+        // free memory as early as possible
+        TFrequencies(c[i].get_allocator()).swap(c[i]);
+        locations[i].clear();
+    }
 }
 
-template <typename TChar, typename TAllocConfig, typename TDistance, typename value_type,
-          typename TSeqNo, typename TSeqPos, typename TBWTLen>
-inline void run(Options const & opt, SearchParams const & searchParams)
+template <typename TDistance, typename TFrequencies, typename TSeqNo, typename TSeqPos,
+          typename TIndex, typename TText, typename TChromosomeNames, typename TChromosomeLengths, typename TDirectoryInformation,
+          typename TIntervals, typename TCSVIntervals>
+inline void runWindows(TIndex & index, TText const & text, Options const & opt, std::vector<SearchParams> const & combinations,
+                       std::string const & fastaFile, TChromosomeNames const & chromNames, TChromosomeLengths const & chromLengths, TChromosomeLengths const & chromCumLengths,
+                       TDirectoryInformation const & directoryInformation, std::vector<TSeqNo> const & mappingSeqIdFile,
+                       TIntervals const & intervals, TCSVIntervals const & csvIntervals,
+                       uint64_t const currentFileNo, uint64_t const totalFileNo)
 {
-    typedef String<TChar, TAllocConfig> TString;
-    typedef StringSet<TString, Owner<ConcatDirect<SizeSpec_<TSeqNo, TSeqPos> > > > TStringSet;
+    if (opt.windowSize == 0)
+    {
+        runWindow<TDistance, TFrequencies, TSeqNo, TSeqPos>(index, text, opt, combinations, fastaFile, chromNames, chromLengths, chromCumLengths,
+                                                           directoryInformation, mappingSeqIdFile, intervals, csvIntervals, currentFileNo, totalFileNo,
+                                                           false /*append*/, true /*lastWindow*/);
+        return;
+    }
 
-    using TFMIndexConfig = TGemMapFastFMIndexConfig<TBWTLen>;
-    TFMIndexConfig::SAMPLING = opt.sampling;
+    // Windows of consecutive chromosomes with a total length of at most opt.windowSize (but at least one chromosome) are
+    // computed and written one after another, i.e., only the frequencies of a single window are kept in main memory.
+    uint64_t const nbrChromosomes = length(chromLengths);
+    for (uint64_t first = 0, last = 0; first < nbrChromosomes; first = last)
+    {
+        last = first + 1;
+        while (last < nbrChromosomes && chromCumLengths[last + 1] - chromCumLengths[first] <= opt.windowSize)
+            ++last;
 
-    using TIndex = Index<TStringSet, TBiIndexConfig<TFMIndexConfig> >;
-    TIndex index;
-    open(index, toCString(opt.indexPath), OPEN_RDONLY);
+        uint64_t const windowBegin = chromCumLengths[first];
+        uint64_t const windowEnd = chromCumLengths[last];
 
-    StringSet<CharString, Owner<ConcatDirect<> > > directoryInformation;
-    open(directoryInformation, toCString(std::string(toCString(opt.indexPath)) + ".ids"), OPEN_RDONLY);
-    appendValue(directoryInformation, "dummy.entry;0;chromosomename"); // dummy entry enforces that the mappability is
-                                                                       // computed for the last file in the while loop.
+        StringSet<CharString> windowChromNames;
+        std::vector<uint64_t> windowChromLengths, windowChromCumLengths(1, 0);
+        for (uint64_t i = first; i < last; ++i)
+        {
+            appendValue(windowChromNames, chromNames[i]);
+            windowChromLengths.push_back(chromLengths[i]);
+            windowChromCumLengths.push_back(chromCumLengths[i + 1] - windowBegin);
+        }
+
+        // intervals do not span multiple chromosomes, i.e., each one is contained in a single window
+        std::vector<std::pair<uint64_t, uint64_t> > windowIntervals;
+        for (auto const & interval : intervals)
+        {
+            if (windowBegin <= interval.first && interval.second <= windowEnd)
+                windowIntervals.emplace_back(interval.first - windowBegin, interval.second - windowBegin);
+        }
+
+        auto const & windowText = infix(text, windowBegin, windowEnd);
+        runWindow<TDistance, TFrequencies, TSeqNo, TSeqPos>(index, windowText, opt, combinations, fastaFile, windowChromNames, windowChromLengths,
+                                                           windowChromCumLengths, directoryInformation, mappingSeqIdFile, windowIntervals,
+                                                           csvIntervals, currentFileNo, totalFileNo, first > 0 /*append*/,
+                                                           last == nbrChromosomes /*lastWindow*/);
+    }
+}
+
+template <typename TDistance, typename value_type, typename TSeqNo, typename TSeqPos,
+          typename TIndex, typename TText, typename TChromosomeNames, typename TChromosomeLengths, typename TDirectoryInformation,
+          typename TIntervals, typename TCSVIntervals>
+inline void run(TIndex & index, TText const & text, Options const & opt, std::vector<SearchParams> const & combinations,
+                std::string const & fastaFile, TChromosomeNames const & chromNames, TChromosomeLengths const & chromLengths, TChromosomeLengths const & chromCumLengths,
+                TDirectoryInformation const & directoryInformation, std::vector<TSeqNo> const & mappingSeqIdFile,
+                TIntervals const & intervals, TCSVIntervals const & csvIntervals,
+                uint64_t const currentFileNo, uint64_t const totalFileNo)
+{
+    // Compact frequencies store the frequencies exactly, i.e., frequencies (-fl) are written with 32 bits. The
+    // mappability is computed from the frequencies saturated to value_type (a code is stored for each value).
+    if (opt.compactFrequencies && opt.outputType == OutputType::frequency_large)
+    {
+        runWindows<TDistance, CompactFrequencies<uint32_t>, TSeqNo, TSeqPos>(index, text, opt, combinations, fastaFile, chromNames, chromLengths,
+                                                                            chromCumLengths, directoryInformation, mappingSeqIdFile, intervals,
+                                                                            csvIntervals, currentFileNo, totalFileNo);
+    }
+    else if (opt.compactFrequencies)
+    {
+        runWindows<TDistance, CompactFrequencies<value_type>, TSeqNo, TSeqPos>(index, text, opt, combinations, fastaFile, chromNames, chromLengths,
+                                                                              chromCumLengths, directoryInformation, mappingSeqIdFile, intervals,
+                                                                              csvIntervals, currentFileNo, totalFileNo);
+    }
+    else
+    {
+        runWindows<TDistance, std::vector<value_type, FrequencyAllocator<value_type> >, TSeqNo, TSeqPos>(index, text, opt, combinations, fastaFile,
+                                                                                                     chromNames, chromLengths, chromCumLengths,
+                                                                                                     directoryInformation, mappingSeqIdFile, intervals,
+                                                                                                     csvIntervals, currentFileNo, totalFileNo);
+    }
+}
+
+// Defined in serve.hpp. Keeps the index resident and computes the mappability for requests sent by `genmap client`.
+template <typename TSeqNo, typename TSeqPos, typename TIndex, typename TDirectoryInformation>
+inline void serveRequests(TIndex & index, TDirectoryInformation const & directoryInformation,
+                          Options const & opt, std::vector<SearchParams> const & combinations);
 
+// Computes the mappability for all fasta files of an index that has already been loaded.
+// Returns false if the input (e.g., the BED file) is invalid.
+template <typename TDistance, typename value_type, typename TSeqNo, typename TSeqPos, typename TIndex, typename TDirectoryInformation>
+inline bool runOnIndex(TIndex & index, TDirectoryInformation const & directoryInformation,
+                       Options const & opt, std::vector<SearchParams> const & combinations)
+{
     std::vector<TSeqNo> mappingSeqIdFile(length(directoryInformation) - 1);
 
     uint64_t totalFileNo;
@@ -241,7 +455,7 @@ inline void run(Options const & opt, SearchParams const & searchParams)
                 fastaFile = std::get<0>(row);
                 ++fastaId;
             }
-            if (searchParams.excludePseudo)
+            if (combinations[0].excludePseudo)
             {
                 mappingSeqIdFile[i] = fastaId;
             }
@@ -310,7 +524,7 @@ inline void run(Options const & opt, SearchParams const & searchParams)
             {
                 // compute mappability for each fasta file
                 auto const & fastaInfix = infixWithLength(text.concat, startPos, fastaFileLength);
-                run<TDistance, value_type, TSeqNo, TSeqPos>(index, fastaInfix, opt, searchParams, fastaFile, chromosomeNames, chromosomeLengths, chromCumLengths, directoryInformation, mappingSeqIdFile, intervalsForSingleFasta, csvIntervalsForSingleFasta, currentFileNo, totalFileNo);
+                run<TDistance, value_type, TSeqNo, TSeqPos>(index, fastaInfix, opt, combinations, fastaFile, chromosomeNames, chromosomeLengths, chromCumLengths, directoryInformation, mappingSeqIdFile, intervalsForSingleFasta, csvIntervalsForSingleFasta, currentFileNo, totalFileNo);
             }
 
             startPos += fastaFileLength;
@@ -342,10 +556,10 @@ inline void run(Options const & opt, SearchParams const & searchParams)
                 // check whether range is correct!
                 if (interval.first >= std::get<1>(row) || interval.second > std::get<1>(row))
                 {
-                    std::cerr << "Error in BED file! Coordinates exceed sequence length: "
+                    *opt.errors << "Error in BED file! Coordinates exceed sequence length: "
                               << "Seq. \"" << std::get<2>(row) << "\" has a length of " << std::get<1>(row) << ", "
                               << "but half-closed interval [" << interval.first << ", " << interval.second << ") given.\n";
-                    exit(1);
+                    return false;
                 }
 
                 intervalsForSingleFasta.emplace_back(std::make_pair(begin, end));
@@ -366,65 +580,141 @@ inline void run(Options const & opt, SearchParams const & searchParams)
 
     if (opt.verbose)
         std::cout << "Mappability computed in " << (round((get_wall_time() - start) * 100.0) / 100.0) << " seconds\n";
+
+    return true;
+}
+
+template <typename TSeqNo, typename TSeqPos, typename TIndex, typename TDirectoryInformation>
+inline bool runOnIndex(TIndex & index, TDirectoryInformation const & directoryInformation,
+                       Options const & opt, std::vector<SearchParams> const & combinations)
+{
+    if (opt.doubleStrand)
+    {
+        // Occurrences on the reverse strand cannot be excluded from the SA intervals without locating them.
+        if (!combinations[0].revCompl)
+        {
+            *opt.errors << "ERROR: --no-reverse-complement is not supported by indices built with --double-strand.\n";
+            return false;
+        }
+        // Occurrences with indels cannot be mapped from the reverse complement to the forward strand without knowing
+        // the length of the alignment, i.e., they would not be deduplicated in the same way as with a regular index.
+        if (opt.editDistance)
+        {
+            *opt.errors << "ERROR: --edit-distance is not supported by indices built with --double-strand.\n";
+            return false;
+        }
+    }
+
+    // checked before any computation, the bigWig file of a fasta file is only written after its mappability
+    if (opt.bigwigFile)
+    {
+        for (uint64_t i = 0; i < length(directoryInformation) - 1; ++i)
+        {
+            auto const row = retrieveDirectoryInformationLine(directoryInformation[i]);
+            if (std::get<1>(row) > std::numeric_limits<uint32_t>::max())
+            {
+                *opt.errors << "ERROR: bigWig files do not support sequences longer than 2^32 - 1 (" << std::get<2>(row) << ").\n";
+                return false;
+            }
+        }
+    }
+
+    if (opt.editDistance)
+    {
+        if (opt.outputType != OutputType::frequency_small) // TODO: document precision for mappability
+            return runOnIndex<EditDistance, uint16_t, TSeqNo, TSeqPos>(index, directoryInformation, opt, combinations);
+        else // if (opt.outputType == OutputType::frequency_small)
+            return runOnIndex<EditDistance, uint8_t, TSeqNo, TSeqPos>(index, directoryInformation, opt, combinations);
+    }
+    else
+    {
+        if (opt.outputType != OutputType::frequency_small) // TODO: document precision for mappability
+            return runOnIndex<HammingDistance, uint16_t, TSeqNo, TSeqPos>(index, directoryInformation, opt, combinations);
+        else // if (opt.outputType == OutputType::frequency_small)
+            return runOnIndex<HammingDistance, uint8_t, TSeqNo, TSeqPos>(index, directoryInformation, opt, combinations);
+    }
+}
+
+template <typename TChar, typename TAllocConfig, typename TSeqNo, typename TSeqPos, typename TBWTLen>
+inline bool run(Options const & opt, std::vector<SearchParams> const & combinations)
+{
+    typedef String<TChar, TAllocConfig> TString;
+    typedef StringSet<TString, Owner<ConcatDirect<SizeSpec_<TSeqNo, TSeqPos> > > > TStringSet;
+
+    using TFMIndexConfig = TGemMapFastFMIndexConfig<TBWTLen>;
+    TFMIndexConfig::SAMPLING = opt.sampling;
+
+    using TIndex = Index<TStringSet, TBiIndexConfig<TFMIndexConfig> >;
+    TIndex index;
+    open(index, toCString(opt.indexPath), OPEN_RDONLY);
+
+    StringSet<CharString, Owner<ConcatDirect<> > > directoryInformation;
+    open(directoryInformation, toCString(std::string(toCString(opt.indexPath)) + ".ids"), OPEN_RDONLY);
+    appendValue(directoryInformation, "dummy.entry;0;chromosomename"); // dummy entry enforces that the mappability is
+                                                                       // computed for the last file in the while loop.
+
+    if (opt.serverSocket >= 0)
+    {
+        serveRequests<TSeqNo, TSeqPos>(index, directoryInformation, opt, combinations);
+        return true;
+    }
+
+    return runOnIndex<TSeqNo, TSeqPos>(index, directoryInformation, opt, combinations);
 }
 
-template <typename TChar, typename TAllocConfig, typename TDistance, typename TValue>
-inline void run(Options const & opt, SearchParams const & searchParams)
+template <typename TChar, typename TAllocConfig>
+inline bool run(Options const & opt, std::vector<SearchParams> const & combinations)
 {
     if (opt.seqNoWidth == 16 && opt.maxSeqLengthWidth == 32)
     {
         if (opt.totalLengthWidth == 32)
-            run<TChar, TAllocConfig, TDistance, TValue, uint16_t, uint32_t, uint32_t>(opt, searchParams);
+            return run<TChar, TAllocConfig, uint16_t, uint32_t, uint32_t>(opt, combinations);
         else if (opt.totalLengthWidth == 64)
-            run<TChar, TAllocConfig, TDistance, TValue, uint16_t, uint32_t, uint64_t>(opt, searchParams);
+            return run<TChar, TAllocConfig, uint16_t, uint32_t, uint64_t>(opt, combinations);
     }
     else if (opt.seqNoWidth == 32 && opt.maxSeqLengthWidth == 16 && opt.totalLengthWidth == 64)
-        run<TChar, TAllocConfig, TDistance, TValue, uint32_t, uint16_t, uint64_t>(opt, searchParams);
+        return run<TChar, TAllocConfig, uint32_t, uint16_t, uint64_t>(opt, combinations);
     else if (opt.seqNoWidth == 64 && opt.maxSeqLengthWidth == 64 && opt.totalLengthWidth == 64)
-        run<TChar, TAllocConfig, TDistance, TValue, uint64_t, uint64_t, uint64_t>(opt, searchParams);
-}
+        return run<TChar, TAllocConfig, uint64_t, uint64_t, uint64_t>(opt, combinations);
 
-template <typename TChar, typename TAllocConfig, typename TDistance>
-inline void run(Options const & opt, SearchParams const & searchParams)
-{
-    if (opt.outputType == OutputType::frequency_large || opt.outputType == OutputType::mappability) // TODO: document precision for mappability
-        run<TChar, TAllocConfig, TDistance, uint16_t>(opt, searchParams);
-    else // if (opt.outputType == OutputType::frequency_small)
-        run<TChar, TAllocConfig, TDistance, uint8_t>(opt, searchParams);
+    *opt.errors << "ERROR: Unsupported index dimensions.\n";
+    return false;
 }
 
 template <typename TChar>
-inline void run(Options const & opt, SearchParams const & searchParams)
+inline bool run(Options const & opt, std::vector<SearchParams> const & combinations)
 {
     if (opt.mmap && opt.packed_text)
-        run<TChar, Packed<MMap<> >, HammingDistance>(opt, searchParams);
+        return run<TChar, Packed<MMap<> > >(opt, combinations);
     else if (!opt.mmap && opt.packed_text)
-        run<TChar, Packed<Alloc<> >, HammingDistance>(opt, searchParams);
+        return run<TChar, Packed<Alloc<> > >(opt, combinations);
     else if (opt.mmap && !opt.packed_text)
-        run<TChar, MMap<>, HammingDistance>(opt, searchParams);
+        return run<TChar, MMap<> >(opt, combinations);
     else // if (!opt.mmap && !opt.packed_text)
-        run<TChar, Alloc<>, HammingDistance>(opt, searchParams);
+        return run<TChar, Alloc<> >(opt, combinations);
 }
 
-int mappabilityMain(int argc, char const ** argv)
+// Options describing a single mappability computation. Shared by `genmap map`, `genmap client` and requests
+// received by `genmap serve`. Index related options (i.e., --index and --memory-mapping) are added separately.
+void addMappabilityOptions(ArgumentParser & parser)
 {
-    // Argument parser
-    ArgumentParser parser("GenMap map");
-    sharedSetup(parser);
-    addDescription(parser,
-        "Tool for computing the mappability/frequency on nucleotide sequences. It supports multi-fasta files with DNA or RNA alphabets (A, C, G, T/U, N). Frequency is the absolute number of occurrences, mappability is the inverse, i.e., 1 / frequency-value.");
-
-    addOption(parser, ArgParseOption("I", "index", "Path to the index", ArgParseArgument::INPUT_FILE, "IN"));
-	setRequired(parser, "index");
-
     addOption(parser, ArgParseOption("O", "output", "Path to output directory (or path to filename if only a single fasta files has been indexed)", ArgParseArgument::OUTPUT_FILE, "OUT"));
     setRequired(parser, "output");
 
-    addOption(parser, ArgParseOption("E", "errors", "Number of errors", ArgParseArgument::INTEGER, "INT"));
+    addOption(parser, ArgParseOption("E", "errors", "Number of errors. Can be given multiple times, e.g., -E 0 -E 1. "
+        "At most 8, the running time grows exponentially in E.", ArgParseArgument::INTEGER, "INT", true));
+    setMinValue(parser, "errors", "0");
+    setMaxValue(parser, "errors", "8");
 
-    addOption(parser, ArgParseOption("K", "length", "Length of k-mers", ArgParseArgument::INTEGER, "INT"));
+    addOption(parser, ArgParseOption("K", "length", "Length of k-mers. Can be given multiple times, e.g., -K 36 -K 50. "
+        "All combinations of K and E are computed at once without reloading the index. Output files are then suffixed by K and E (e.g., .K36.E0). "
+        "NOTE: The results of all combinations are kept in main memory at the same time (see also --window-size).", ArgParseArgument::INTEGER, "INT", true));
     setRequired(parser, "length");
 
+    addOption(parser, ArgParseOption("ed", "edit-distance", "Counts occurrences with up to E edits (mismatches, insertions and deletions) instead of mismatches only. "
+        "Alignments do not start or end with an indel and each occurrence is only counted once, even if it is found by different alignments. Significantly slower than the default (Hamming distance): "
+        "occurrences have to be located to count them once, i.e., the running time grows quadratically with the number of copies of (approximate) repeats."));
+
     addOption(parser, ArgParseOption("S", "selection", "Path to a bed file (3 columns: chromosome, start, end) with selected coordinates to compute the mappability (e.g., exon coordinates)", ArgParseArgument::OUTPUT_FILE, "IN"));
 
     addOption(parser, ArgParseOption("nc", "no-reverse-complement", "Searches the k-mers *NOT* on the reverse strand."));
@@ -433,9 +723,20 @@ int mappabilityMain(int argc, char const ** argv)
 
     addOption(parser, ArgParseOption("fs", "frequency-small", "Stores frequencies using 8 bit per value (max. value 255) instead of the mappbility using a float per value (32 bit). Applies to all formats (raw, txt, wig, bedgraph)."));
     addOption(parser, ArgParseOption("fl", "frequency-large", "Stores frequencies using 16 bit per value (max. value 65535) instead of the mappbility using a float per value (32 bit). Applies to all formats (raw, txt, wig, bedgraph)."));
+    addOption(parser, ArgParseOption("mh", "mappability-half", "Stores the mappability using a half-precision float per value (16 bit) instead of a float (32 bit). Applies to all formats (raw, txt, wig, bedgraph, bigwig), text formats print the shortest decimal that yields the same half-precision float."));
+    addOption(parser, ArgParseOption("mq", "mappability-quantized", "Stores the mappability using an 8 bit code per value instead of a float (32 bit). Frequencies up to 191 are stored exactly, larger ones in bins growing by about 9 percent. Applies to all formats (raw, txt, wig, bedgraph, bigwig), text formats print the shortest decimal that yields the same half-precision float."));
 
     addOption(parser, ArgParseOption("r", "raw",
-        "Output raw files, i.e., the binary format of std::vector<T> with T = float, uint8_t or uint16_t (depending on whether -fs or -fl is set). For each fasta file that was indexed a separate file is created. File type is .map, .freq8 or .freq16."));
+        "Output raw files, i.e., the binary format of std::vector<T> with T = float, uint8_t or uint16_t (depending on whether -fs or -fl is set, uint32_t for -fl with --compact-frequencies). For each fasta file that was indexed a separate file is created. File type is .map, .freq8, .freq16 or .freq32."));
+
+    addOption(parser, ArgParseOption("rf", "raw-format",
+        "Format of the raw files (implies --raw). plain: std::vector<T> without a header. rle: run-length encoded blocks of 65536 positions "
+        "with a header (chromosomes, K, E, value type) and a block offset table for random access (file type .map.rle, .freq8.rle or .freq16.rle). "
+        "Usually an order of magnitude smaller. aligned: the values of each chromosome with the same header, each chromosome starts at "
+        "a multiple of 64 bytes such that memory mapped files can be indexed directly (file type .map.raw, .freq8.raw or .freq16.raw).",
+        ArgParseArgument::STRING, "FORMAT"));
+    setValidValues(parser, "raw-format", std::vector<std::string>{"plain", "rle", "aligned"});
+    setDefaultValue(parser, "raw-format", "plain");
 
     addOption(parser, ArgParseOption("t", "txt",
         "Output human readable text files, i.e., the mappability respectively frequency values separated by spaces (depending on whether -fs or -fl is set). For each fasta file that was indexed a separate txt file is created. WARNING: This output is significantly larger than raw files."));
@@ -446,60 +747,116 @@ int mappabilityMain(int argc, char const ** argv)
     addOption(parser, ArgParseOption("bg", "bedgraph",
         "Output bedgraph files. For each fasta file that was indexed a separate bedgraph-file is created."));
 
+    addOption(parser, ArgParseOption("bw", "bigwig",
+        "Output bigWig files (compressed and indexed, with zoom levels for genome browsers). For each fasta file that was indexed a separate bigWig file is created."));
+
     ArgParseOption bedFileOption("b", "bed",
         "Output bed files. For each fasta file that was indexed a separate bed-file is created.");
     hideOption(bedFileOption);
     addOption(parser, bedFileOption);
 
-    addOption(parser, ArgParseOption("d", "csv",
-        "Output a detailed csv file reporting the locations of each k-mer (WARNING: This will produce large files and makes computing the mappability significantly slower)."));
+    addOption(parser, ArgParseOption("um", "unique-mask",
+        "Output a mask of the unique k-mers (frequency of 1) with a bit per position (.unique.mask, each chromosome starts at a new byte, "
+        "least significant bit first) and a bed file of the intervals of unique k-mers (.unique.bed). If no other output format is chosen, "
+        "the search of a k-mer ends with its second occurrence (see --max-frequency)."));
 
-    addOption(parser, ArgParseOption("m", "memory-mapping",
-        "Turns memory-mapping on, i.e. the index is not loaded into RAM but accessed directly from secondary-memory. This may increase the overall running time, but do NOT use it if the index lies on network storage."));
+    addOption(parser, ArgParseOption("d", "csv",
+        "Output a detailed csv file reporting the locations of each k-mer (WARNING: This will produce large files and makes computing the mappability slower, see also --csv-memory)."));
+
+    addOption(parser, ArgParseOption("dc", "csv-classes",
+        "Output the locations of the k-mers deduplicated by repeat class instead of --csv: a .classes.csv file with the locations of each class "
+        "(all k-mers with the same sequence share a class) and a .kmers.csv file mapping each k-mer to its class. Significantly smaller for repetitive genomes."));
+
+    addOption(parser, ArgParseOption("db", "locations-binary",
+        "Output the locations of the k-mers in a compact binary format (.loc) instead of --csv. "
+        "Use `genmap locations` to convert it to the csv format or to look up single k-mers."));
+
+    addOption(parser, ArgParseOption("cm", "csv-memory", "Main memory (in MB) for buffering the locations of the csv output. "
+        "Locations exceeding it are written to temporary files (in TMPDIR) and merged when the csv file is written.", ArgParseArgument::INTEGER, "INT"));
+    setDefaultValue(parser, "csv-memory", 4096);
+    setMinValue(parser, "csv-memory", "1");
+
+    addOption(parser, ArgParseOption("ws", "window-size", "Computes and writes the mappability of windows of consecutive chromosomes with a total length of at most INT bases "
+        "(at least one chromosome per window) one after another, i.e., only the results of a single window are kept in main memory instead of the results of an entire fasta file. "
+        "0 processes entire fasta files at once. Cannot be combined with the csv outputs, --bigwig and --raw-format rle/aligned.", ArgParseArgument::INTEGER, "INT"));
+    setDefaultValue(parser, "window-size", 0);
+    setMinValue(parser, "window-size", "0");
+
+    addOption(parser, ArgParseOption("mf", "mmap-frequencies", "Stores the frequencies in memory mapped files instead of main memory, "
+        "i.e., the operating system can page them out if the index and the frequencies do not fit into main memory at the same time. "
+        "With --raw (plain) and -fs or -fl the raw files themselves are mapped and do not need to be written separately, otherwise temporary files "
+        "are created in TMPDIR (use local storage)."));
+
+    addOption(parser, ArgParseOption("cf", "compact-frequencies", "Stores the frequencies with a single byte per position in main memory "
+        "(frequencies of 255 and larger are stored exactly in a sparse table) instead of 2 bytes (-fl, mappability). "
+        "Saves memory unless a large fraction of the k-mers is highly repetitive. With -fl the frequencies are written exactly "
+        "(up to 2^32 - 1, raw files with 32 bit per value, file type .freq32), the mappability is still at least 1/65535. "
+        "Cannot be combined with -fs."));
+
+    addOption(parser, ArgParseOption("mx", "max-frequency", "Caps the frequencies at INT (i.e., the mappability at 1/INT). The search of a k-mer ends as "
+        "soon as it has INT occurrences and k-mers with at least INT exact occurrences are not searched with errors, which speeds up repeats considerably. "
+        "Cannot be combined with the csv outputs and --exclude-pseudo.", ArgParseArgument::INTEGER, "INT"));
+    setMinValue(parser, "max-frequency", "1");
 
     addOption(parser, ArgParseOption("T", "threads", "Number of threads", ArgParseArgument::INTEGER, "INT"));
     setDefaultValue(parser, "threads", omp_get_max_threads());
 
     addOption(parser, ArgParseOption("v", "verbose", "Outputs some additional information."));
 
-    addOption(parser, ArgParseOption("xo", "overlap", "Number of overlapping reads (xo + 1 Strings will be searched at once beginning with their overlap region). Default: K * (0.7^e * MIN(MAX(K,30),100) / 100)", ArgParseArgument::INTEGER, "INT"));
+    addOption(parser, ArgParseOption("xo", "overlap", "Number of overlapping reads (xo + 1 Strings will be searched at once beginning with their overlap region). "
+        "Default: K * (0.7^e * MIN(MAX(K,30),100) / 100). With 'auto' the fastest value is picked by timing a few candidates on randomly sampled regions.", ArgParseArgument::STRING, "INT|auto"));
     hideOption(parser, "overlap");
+}
 
-    ArgumentParser::ParseResult res = parse(parser, argc, argv);
-    if (res != ArgumentParser::PARSE_OK)
-        return res == ArgumentParser::PARSE_ERROR;
-
-    // Retrieve input parameters
-    Options opt;
-    SearchParams searchParams;
-    getOptionValue(opt.errors, parser, "errors");
-    getOptionValue(opt.indexPath, parser, "index");
+// Retrieves the options added by addMappabilityOptions(). Index related options are not touched.
+// Each combination of the given k-mer lengths and errors is stored as a separate element in `combinations`.
+ArgumentParser::ParseResult parseMappabilityOptions(ArgumentParser const & parser, Options & opt, std::vector<SearchParams> & combinations)
+{
     getOptionValue(opt.outputPath, parser, "output");
     if (isSet(parser, "selection"))
         getOptionValue(opt.selectionPath, parser, "selection");
 
-    opt.mmap = isSet(parser, "memory-mapping");
     opt.wigFile = isSet(parser, "wig");
     opt.bedgraphFile = isSet(parser, "bedgraph");
+    opt.bigwigFile = isSet(parser, "bigwig");
     opt.bedFile = isSet(parser, "bed");
-    opt.rawFile = isSet(parser, "raw");
+    opt.rawFile = isSet(parser, "raw") || isSet(parser, "raw-format");
+    std::string rawFormat;
+    getOptionValue(rawFormat, parser, "raw-format");
+    if (rawFormat == "rle")
+        opt.rawFormat = RawFormat::rle;
+    else if (rawFormat == "aligned")
+        opt.rawFormat = RawFormat::aligned;
+    else
+        opt.rawFormat = RawFormat::plain;
     opt.txtFile = isSet(parser, "txt");
-    opt.csvFile = isSet(parser, "csv");
+    opt.uniqueMask = isSet(parser, "unique-mask");
+    opt.csvClasses = isSet(parser, "csv-classes");
+    opt.locationsBinary = isSet(parser, "locations-binary");
+    if (isSet(parser, "csv") + opt.csvClasses + opt.locationsBinary > 1)
+    {
+        *opt.errors << "ERROR: Please choose only one of --csv, --csv-classes and --locations-binary.\n";
+        return ArgumentParser::PARSE_ERROR;
+    }
+    opt.csvFile = isSet(parser, "csv") || opt.csvClasses || opt.locationsBinary;
     opt.verbose = isSet(parser, "verbose");
 
-    if (!opt.wigFile && !opt.bedgraphFile && !opt.bedFile && !opt.rawFile && !opt.txtFile && !opt.csvFile)
+    bool const onlyUniqueMask = !opt.wigFile && !opt.bedgraphFile && !opt.bigwigFile && !opt.bedFile && !opt.rawFile && !opt.txtFile && !opt.csvFile;
+    if (onlyUniqueMask && !opt.uniqueMask)
     {
-        std::cerr << "ERROR: Please choose at least one output format (i.e., --wig, --bedgraph, --bed, --raw, --txt, --csv).\n";
+        *opt.errors << "ERROR: Please choose at least one output format (i.e., --wig, --bedgraph, --bigwig, --bed, --raw, --txt, --csv, --csv-classes, --locations-binary, --unique-mask).\n";
         return ArgumentParser::PARSE_ERROR;
     }
 
     // store in temporary variables to avoid parsing arguments twice
     bool const isSetFS = isSet(parser, "frequency-small");
     bool const isSetFL = isSet(parser, "frequency-large");
+    bool const isSetMH = isSet(parser, "mappability-half");
+    bool const isSetMQ = isSet(parser, "mappability-quantized");
 
-    if (isSetFS && isSetFL)
+    if (isSetFS + isSetFL + isSetMH + isSetMQ > 1)
     {
-        std::cerr << "ERROR: Cannot use both --frequency-small and --frequency-large. Please choose one.\n";
+        *opt.errors << "ERROR: Cannot use more than one of --frequency-small, --frequency-large, --mappability-half and --mappability-quantized. Please choose one.\n";
         return ArgumentParser::PARSE_ERROR;
     }
 
@@ -507,47 +864,153 @@ int mappabilityMain(int argc, char const ** argv)
         opt.outputType = OutputType::frequency_small;
     else if (isSetFL)
         opt.outputType = OutputType::frequency_large;
+    else if (isSetMH)
+        opt.outputType = OutputType::mappability_half;
+    else if (isSetMQ)
+        opt.outputType = OutputType::mappability_quantized;
     else // default value
         opt.outputType = OutputType::mappability;
 
-    getOptionValue(searchParams.length, parser, "length");
+    // the mask only distinguishes frequencies of 0, 1 and more, i.e., a single byte per frequency suffices
+    if (onlyUniqueMask)
+        opt.outputType = OutputType::frequency_small;
+
+    opt.editDistance = isSet(parser, "edit-distance");
+    getOptionValue(opt.csvMemory, parser, "csv-memory");
+    getOptionValue(opt.windowSize, parser, "window-size");
+    opt.mmapFrequencies = isSet(parser, "mmap-frequencies");
+    opt.compactFrequencies = isSet(parser, "compact-frequencies");
+
+    // frequencies of a single byte do not need any compaction
+    if (opt.compactFrequencies && opt.outputType == OutputType::frequency_small)
+    {
+        *opt.errors << "ERROR: --compact-frequencies cannot be combined with --frequency-small or with --unique-mask as the only output.\n";
+        return ArgumentParser::PARSE_ERROR;
+    }
+
+    // the locations of all k-mers of a fasta file are sorted before the csv file is written and the headers and indices
+    // of bigWig and raw files with a header cannot be extended
+    if (opt.windowSize > 0 && (opt.csvFile || opt.bigwigFile || opt.rawFormat != RawFormat::plain))
+    {
+        *opt.errors << "ERROR: --window-size cannot be combined with --csv, --csv-classes, --locations-binary, --bigwig or --raw-format rle/aligned.\n";
+        return ArgumentParser::PARSE_ERROR;
+    }
+
+    SearchParams searchParams;
     getOptionValue(searchParams.threads, parser, "threads");
     searchParams.revCompl = !isSet(parser, "no-reverse-complement");
     searchParams.excludePseudo = isSet(parser, "exclude-pseudo");
+    if (isSet(parser, "max-frequency"))
+    {
+        // all occurrences are needed for the locations and for counting the distinct fasta files
+        if (opt.csvFile || searchParams.excludePseudo)
+        {
+            *opt.errors << "ERROR: --max-frequency cannot be combined with --csv, --csv-classes, --locations-binary or --exclude-pseudo.\n";
+            return ArgumentParser::PARSE_ERROR;
+        }
+        getOptionValue(searchParams.maxFrequency, parser, "max-frequency");
+        if (opt.uniqueMask && searchParams.maxFrequency < 2)
+        {
+            *opt.errors << "ERROR: --unique-mask requires a --max-frequency of at least 2.\n";
+            return ArgumentParser::PARSE_ERROR;
+        }
+    }
+    // the mask only needs to know whether a k-mer has a second occurrence
+    if (onlyUniqueMask && !searchParams.excludePseudo)
+        searchParams.maxFrequency = std::min<uint32_t>(searchParams.maxFrequency, 2);
+
+    std::set<unsigned> lengths, errors;
+    for (unsigned i = 0; i < getOptionValueCount(parser, "length"); ++i)
+    {
+        unsigned length;
+        getOptionValue(length, parser, "length", i);
+        lengths.insert(length);
+    }
+    for (unsigned i = 0; i < getOptionValueCount(parser, "errors"); ++i)
+    {
+        unsigned e;
+        getOptionValue(e, parser, "errors", i);
+        errors.insert(e);
+    }
+    if (errors.empty())
+        errors.insert(0);
 
     // store in temporary variables to avoid parsing arguments twice
-    bool const isSetOverlap = isSet(parser, "overlap");
+    bool isSetOverlap = isSet(parser, "overlap");
+    bool autoOverlap = false;
+    unsigned overlap = 0;
     if (isSetOverlap)
-        getOptionValue(searchParams.overlap, parser, "overlap");
-    else if (opt.errors == 0)
-        searchParams.overlap = searchParams.length * 0.7;
-    else
-        searchParams.overlap = searchParams.length * std::min(std::max(searchParams.length, 30u), 100u) * pow(0.7f, opt.errors) / 100.0;
-
-    // (K - O >= E + 2 must hold since common overlap has length K - O and will be split into E + 2 parts)
-    uint64_t const maxPossibleOverlap = std::min(searchParams.length - 1, searchParams.length - opt.errors - 2);
-    if (searchParams.overlap > maxPossibleOverlap)
     {
-        if (!isSetOverlap)
+        std::string overlapValue;
+        getOptionValue(overlapValue, parser, "overlap");
+        if (overlapValue == "auto")
         {
-            searchParams.overlap = maxPossibleOverlap;
+            // the default is used as a candidate and as a fallback for small texts
+            autoOverlap = true;
+            isSetOverlap = false;
         }
-        else
+        else if (overlapValue.empty() || overlapValue.find_first_not_of("0123456789") != std::string::npos)
         {
-            std::cerr << "ERROR: overlap cannot be larger than min(K - 1, K - E - 2) = " << maxPossibleOverlap << ".\n";
+            *opt.errors << "ERROR: overlap has to be a non-negative integer or 'auto'.\n";
             return ArgumentParser::PARSE_ERROR;
         }
+        else
+        {
+            overlap = std::stoul(overlapValue);
+        }
     }
 
-    // searchParams.overlap = length of common overlap
-    searchParams.overlap = searchParams.length - searchParams.overlap;
+    combinations.clear();
+    for (unsigned const length : lengths)
+    {
+        for (unsigned const e : errors)
+        {
+            searchParams.length = length;
+            searchParams.errors = e;
+            searchParams.autoOverlap = autoOverlap;
 
-    // TODO: error message if output files already exist or directory is not writeable
-    // TODO: nice error messages if index is incorrect or doesnt exist
-    if (back(opt.indexPath) != '/')
-        opt.indexPath += '/';
-    opt.indexPath += "index";
+            if (length < e + 2)
+            {
+                *opt.errors << "ERROR: K has to be at least E + 2 (K = " << length << ", E = " << e << ").\n";
+                return ArgumentParser::PARSE_ERROR;
+            }
+
+            if (isSetOverlap)
+                searchParams.overlap = overlap;
+            else if (e == 0)
+                searchParams.overlap = searchParams.length * 0.7;
+            else
+                searchParams.overlap = searchParams.length * std::min(std::max(searchParams.length, 30u), 100u) * pow(0.7f, e) / 100.0;
+
+            // (K - O >= E + 2 must hold since common overlap has length K - O and will be split into E + 2 parts)
+            uint64_t const maxPossibleOverlap = std::min(searchParams.length - 1, searchParams.length - e - 2);
+            if (searchParams.overlap > maxPossibleOverlap)
+            {
+                if (!isSetOverlap)
+                {
+                    searchParams.overlap = maxPossibleOverlap;
+                }
+                else
+                {
+                    *opt.errors << "ERROR: overlap cannot be larger than min(K - 1, K - E - 2) = " << maxPossibleOverlap
+                              << " (K = " << length << ", E = " << e << ").\n";
+                    return ArgumentParser::PARSE_ERROR;
+                }
+            }
+
+            // searchParams.overlap = length of common overlap
+            searchParams.overlap = searchParams.length - searchParams.overlap;
+
+            combinations.push_back(searchParams);
+        }
+    }
+
+    return ArgumentParser::PARSE_OK;
+}
 
+// Reads the dimensions and alphabet of the index from index.info. opt.indexPath has to point to the index prefix.
+void readIndexInformation(Options & opt)
+{
     StringSet<CharString, Owner<ConcatDirect<> > > info;
     std::string infoPath = std::string(toCString(opt.indexPath)) + ".info";
     open(info, toCString(infoPath));
@@ -558,85 +1021,146 @@ int mappabilityMain(int argc, char const ** argv)
     opt.sampling = std::stoi(retrieve(info, "sampling_rate"));
     opt.directory = retrieve(info, "fasta_directory") == "true";
     opt.packed_text = retrieve(info, "packed_text") == "true";
+    opt.doubleStrand = retrieve(info, "double_strand") == "true";
+}
 
-    // Check whether the output path exists
+void printIndexInformation(Options const & opt)
+{
+    // TODO: dna5/rna5
+    std::cout << "Index was loaded (" << opt.alphabet << " alphabet, sampling rate of " << opt.sampling << ").\n"
+                 "- The BWT is represented by " << opt.totalLengthWidth << " bit values.\n"
+                 "- The sampled suffix array is represented by pairs of " << opt.seqNoWidth <<
+                 " and " << opt.maxSeqLengthWidth  << " bit values.\n";
+
+    if (opt.directory)
+        std::cout << "- Index was built on an entire directory.\n" << std::flush;
+    else
+        std::cout << "- Index was built on a single fasta file.\n" << std::flush;
+
+    if (opt.doubleStrand)
+        std::cout << "- Index contains the reverse complement of each sequence.\n" << std::flush;
+}
+
+// Checks whether the output path exists and whether it is a directory or includes a filename. Requires opt.directory.
+ArgumentParser::ParseResult checkOutputPath(Options & opt)
+{
+    struct stat st;
+    // is outputPath a directory and does it exist?
+    if (stat(toCString(opt.outputPath), &st) == 0 && S_ISDIR(st.st_mode))
+    {
+        // okay (default case)
+        opt.outputPathIncludesFilename = false;
+        if (back(opt.outputPath) != '/')
+            appendValue(opt.outputPath, '/');
+    }
+    // does outputPath include a filename?
+    else if (!opt.directory)
     {
-        struct stat st;
-        // is outputPath a directory and does it exist?
-        if (stat(toCString(opt.outputPath), &st) == 0 && S_ISDIR(st.st_mode))
+        // remove file name in temporary variable
+        CharString outputPath2 = opt.outputPath;
+        if (back(outputPath2) == '.')
         {
-            // okay (default case)
+            // if it ends with . or .., it is always considered a directory
+            appendValue(opt.outputPath, '/');
             opt.outputPathIncludesFilename = false;
-            if (back(opt.outputPath) != '/')
-                appendValue(opt.outputPath, '/');
         }
-        // does outputPath include a filename?
-        else if (!opt.directory)
+        else
         {
-            // remove file name in temporary variable
-            CharString outputPath2 = opt.outputPath;
-            if (back(outputPath2) == '.')
+            int32_t last_slash_pos = length(outputPath2) - 1;
+            // check for >= 0 in case it does not contain '/' at all (file in same directory)
+            while (last_slash_pos >= 0 && outputPath2[last_slash_pos] != '/')
+                --last_slash_pos;
+            if (last_slash_pos >= 0)
             {
-                // if it ends with . or .., it is always considered a directory
-                appendValue(opt.outputPath, '/');
-                opt.outputPathIncludesFilename = false;
+                erase(outputPath2, last_slash_pos, length(outputPath2));
             }
             else
             {
-                int32_t last_slash_pos = length(outputPath2) - 1;
-                // check for >= 0 in case it does not contain '/' at all (file in same directory)
-                while (last_slash_pos >= 0 && outputPath2[last_slash_pos] != '/')
-                    --last_slash_pos;
-                if (last_slash_pos >= 0)
-                {
-                    erase(outputPath2, last_slash_pos, length(outputPath2));
-                }
-                else
-                {
-                    // since we checked at the very beginning whether it is an existing directory,
-                    // we now assume that it is a filename and (in the current working directory)
-                    // hence the path without the filename is '.'
-                    outputPath2 = ".";
-                }
-                opt.outputPathIncludesFilename = true;
-            }
-
-            // check if the parent directory exists
-            if (!(stat(toCString(outputPath2), &st) == 0 && S_ISDIR(st.st_mode)))
-            {
-                std::cerr << "ERROR: The output cannot be written to the file " << opt.outputPath << ".\n"
-                          << "       It seems the directory " << outputPath2 << " does not exist.\n";
-                return ArgumentParser::PARSE_ERROR;
+                // since we checked at the very beginning whether it is an existing directory,
+                // we now assume that it is a filename and (in the current working directory)
+                // hence the path without the filename is '.'
+                outputPath2 = ".";
             }
+            opt.outputPathIncludesFilename = true;
         }
-        else
+
+        // check if the parent directory exists
+        if (!(stat(toCString(outputPath2), &st) == 0 && S_ISDIR(st.st_mode)))
         {
-            std::cerr << "ERROR: The output directory " << opt.outputPath << " does not exist.\n"
-                      << "       A filename can only be specified for single indexed fasta files (not for indexed fasta directories).\n"
-                      << "       Please create it, or choose a different location.\n";
+            *opt.errors << "ERROR: The output cannot be written to the file " << opt.outputPath << ".\n"
+                      << "       It seems the directory " << outputPath2 << " does not exist.\n";
             return ArgumentParser::PARSE_ERROR;
         }
     }
+    else
+    {
+        *opt.errors << "ERROR: The output directory " << opt.outputPath << " does not exist.\n"
+                  << "       A filename can only be specified for single indexed fasta files (not for indexed fasta directories).\n"
+                  << "       Please create it, or choose a different location.\n";
+        return ArgumentParser::PARSE_ERROR;
+    }
+
+    return ArgumentParser::PARSE_OK;
+}
+
+int mappabilityMain(int argc, char const ** argv)
+{
+    // Argument parser
+    ArgumentParser parser("GenMap map");
+    sharedSetup(parser);
+    addDescription(parser,
+        "Tool for computing the mappability/frequency on nucleotide sequences. It supports multi-fasta files with DNA or RNA alphabets (A, C, G, T/U, N). Frequency is the absolute number of occurrences, mappability is the inverse, i.e., 1 / frequency-value.");
+
+    addOption(parser, ArgParseOption("I", "index", "Path to the index", ArgParseArgument::INPUT_FILE, "IN"));
+	setRequired(parser, "index");
+
+    addMappabilityOptions(parser);
+
+    addOption(parser, ArgParseOption("m", "memory-mapping",
+        "Turns memory-mapping on, i.e. the index is not loaded into RAM but accessed directly from secondary-memory. This may increase the overall running time, but do NOT use it if the index lies on network storage."));
+
+    ArgumentParser::ParseResult res = parse(parser, argc, argv);
+    if (res != ArgumentParser::PARSE_OK)
+        return res == ArgumentParser::PARSE_ERROR;
+
+    // Retrieve input parameters
+    Options opt;
+    std::vector<SearchParams> combinations;
+    getOptionValue(opt.indexPath, parser, "index");
+    opt.mmap = isSet(parser, "memory-mapping");
+    opt.serverSocket = -1;
+
+    if (parseMappabilityOptions(parser, opt, combinations) != ArgumentParser::PARSE_OK)
+        return ArgumentParser::PARSE_ERROR;
+
+    // TODO: error message if output files already exist or directory is not writeable
+    // TODO: nice error messages if index is incorrect or doesnt exist
+    if (back(opt.indexPath) != '/')
+        opt.indexPath += '/';
+    opt.indexPath += "index";
+
+    readIndexInformation(opt);
+
+    if (checkOutputPath(opt) != ArgumentParser::PARSE_OK)
+        return ArgumentParser::PARSE_ERROR;
 
     if (opt.verbose)
-    {
-        // TODO: dna5/rna5
-        std::cout << "Index was loaded (" << opt.alphabet << " alphabet, sampling rate of " << opt.sampling << ").\n"
-                     "- The BWT is represented by " << opt.totalLengthWidth << " bit values.\n"
-                     "- The sampled suffix array is represented by pairs of " << opt.seqNoWidth <<
-                     " and " << opt.maxSeqLengthWidth  << " bit values.\n";
+        printIndexInformation(opt);
 
-        if (opt.directory)
-            std::cout << "- Index was built on an entire directory.\n" << std::flush;
+    // TODO: remove opt.alphabet and replace by bool
+    bool success;
+    try
+    {
+        if (opt.alphabet == "dna4")
+            success = run<Dna>(opt, combinations);
         else
-            std::cout << "- Index was built on a single fasta file.\n" << std::flush;
+            success = run<Dna5>(opt, combinations);
+    }
+    catch (std::exception const & e)
+    {
+        std::cerr << "ERROR: " << e.what() << '\n';
+        return ArgumentParser::PARSE_ERROR;
     }
 
-    // TODO: remove opt.alphabet and replace by bool
-    if (opt.alphabet == "dna4")
-        run<Dna>(opt, searchParams);
-    else
-        run<Dna5>(opt, searchParams);
-
-    return 0;
+    return !success;
 }
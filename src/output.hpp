@@ -1,3 +1,10 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <sstream>
 #include <vector>
 #include <string>
 #include <cstdint>
@@ -7,195 +14,646 @@
 
 using namespace seqan;
 
-template <typename T>
-void saveRaw(std::vector<T> const & c, std::string const & output_path, bool const mappability)
+enum OutputType
 {
-    char buffer[BUFFER_SIZE];
-    std::ofstream outfile(output_path, std::ios::out | std::ios::binary);
-    outfile.rdbuf()->pubsetbuf(buffer, BUFFER_SIZE);
+    mappability,          // float (32 bit)
+    frequency_large,      // uint16_t (16 bit)
+    frequency_small,      // uint8_t (8 bit)
+    mappability_half,     // half-precision float (16 bit)
+    mappability_quantized // 8 bit code (exact for frequencies < 192, binned above, see quantizeFrequency())
+};
+
+inline bool isMappability(OutputType const outputType)
+{
+    return outputType != OutputType::frequency_large && outputType != OutputType::frequency_small;
+}
+
+// Number of positions that are formatted at once by a thread for the raw, txt, wig and bedgraph files.
+static constexpr uint64_t outputChunkSize = 1 << 18;
+
+// IEEE 754 half-precision float (--mappability-half) nearest to value (rounded to even). Values beyond the range of a
+// half are mapped to infinity, NaN is not supported.
+inline uint16_t floatToHalf(float const value)
+{
+    uint32_t bits;
+    std::memcpy(&bits, &value, sizeof(float));
+    uint16_t const sign = (bits >> 16) & 0x8000;
+    int32_t const exponent = static_cast<int32_t>((bits >> 23) & 0xFF) - 127 + 15;
+    uint32_t const mantissa = bits & 0x7FFFFF;
 
-    if (mappability)
+    if (exponent >= 31)
+        return sign | 0x7C00;
+
+    uint32_t half, shift;
+    if (exponent > 0)
     {
-        for (T const v : c)
-        {
-            float const f = (v != 0) ? 1.0f / static_cast<float>(v) : 0;
-            outfile.write(reinterpret_cast<const char*>(&f), sizeof(float));
-        }
+        half = (static_cast<uint32_t>(exponent) << 10) | (mantissa >> 13);
+        shift = 13;
+    }
+    else if (exponent >= -10) // subnormal
+    {
+        shift = 14 - exponent;
+        half = (mantissa | 0x800000) >> shift;
     }
     else
     {
-        outfile.write((const char*) &c[0], c.size() * sizeof(T));
+        return sign;
     }
 
-    outfile.close();
+    // a carry of the mantissa increments the exponent, i.e., yields the next larger half
+    uint32_t const remainder = (mantissa | ((exponent > 0) ? 0 : 0x800000)) & ((1u << shift) - 1);
+    uint32_t const halfway = 1u << (shift - 1);
+    if (remainder > halfway || (remainder == halfway && (half & 1)))
+        ++half;
+    return sign | half;
 }
 
-template <typename T, typename TChromosomeNames, typename TChromosomeLengths>
-void saveTxt(std::vector<T> const & c, std::string const & output_path, TChromosomeNames const & chromNames, TChromosomeLengths const & chromLengths, bool const mappability)
+inline float halfToFloat(uint16_t const half)
 {
-    char buffer[BUFFER_SIZE];
-    std::ofstream outfile(output_path + ".txt", std::ios::out | std::ofstream::binary);
-    outfile.rdbuf()->pubsetbuf(buffer, BUFFER_SIZE);
+    uint32_t const exponent = (half >> 10) & 0x1F;
+    uint32_t const mantissa = half & 0x3FF;
+    float value;
+    if (exponent == 0)
+        value = std::ldexp(static_cast<float>(mantissa), -24);
+    else if (exponent == 31)
+        value = std::numeric_limits<float>::infinity();
+    else
+        value = std::ldexp(static_cast<float>(mantissa | 0x400), static_cast<int>(exponent) - 25);
+    return (half & 0x8000) ? -value : value;
+}
 
-    auto seqBegin = c.begin();
-    auto seqEnd = c.begin() + chromLengths[0];
-    for (uint64_t i = 0; i < length(chromLengths); ++i)
+// --mappability-quantized: frequencies below quantizedExactCodes are their own code, larger frequencies are binned into
+// the remaining codes. Each bin is 3/32 larger than the previous one, the last bin contains all larger frequencies.
+static constexpr uint64_t quantizedExactCodes = 192;
+
+// First frequency of each bin (code quantizedExactCodes + i) and the end of the last bin (frequencies are at most 16 bit).
+inline std::vector<uint64_t> const & quantizedBinBegins()
+{
+    static std::vector<uint64_t> const begins = []
     {
-        outfile << '>' << chromNames[i] << '\n';
+        std::vector<uint64_t> begins{quantizedExactCodes};
+        for (uint64_t code = quantizedExactCodes + 1; code < 256; ++code)
+            begins.push_back(begins.back() + std::max<uint64_t>(1, begins.back() * 3 / 32));
+        begins.push_back(std::numeric_limits<uint16_t>::max() + 1);
+        return begins;
+    }();
+    return begins;
+}
+
+inline uint8_t quantizeFrequency(uint64_t const frequency)
+{
+    if (frequency < quantizedExactCodes)
+        return frequency;
+    std::vector<uint64_t> const & begins = quantizedBinBegins();
+    uint64_t const bin = std::upper_bound(begins.begin(), begins.end() - 1, frequency) - begins.begin() - 1;
+    return quantizedExactCodes + bin;
+}
+
+// Mappability of a code, i.e., 1 / frequency (or 1 / center of the bin), 0 for a frequency of 0.
+inline float dequantizeMappability(uint8_t const code)
+{
+    if (code < quantizedExactCodes)
+        return (code != 0) ? 1.0f / static_cast<float>(code) : 0.0f;
+    std::vector<uint64_t> const & begins = quantizedBinBegins();
+    uint64_t const bin = code - quantizedExactCodes;
+    return 2.0f / static_cast<float>(begins[bin] + begins[bin + 1] - 1);
+}
 
-        if (mappability)
+// Value of a frequency v as written to the outputs of outputType, i.e., the frequency itself or the mappability
+// 1 / frequency (as stored by a float, half or quantized code).
+inline float outputValue(OutputType const outputType, uint64_t const v)
+{
+    float const reciprocal = (v != 0) ? 1.0f / static_cast<float>(v) : 0.0f;
+    switch (outputType)
+    {
+        case OutputType::mappability:           return reciprocal;
+        case OutputType::mappability_half:      return halfToFloat(floatToHalf(reciprocal));
+        case OutputType::mappability_quantized: return dequantizeMappability(quantizeFrequency(v));
+        default:                                return static_cast<float>(v);
+    }
+}
+
+inline void appendNumber(std::string & buffer, uint64_t value)
+{
+    char text[20];
+    char * const end = text + sizeof(text);
+    char * begin = end;
+    do
+    {
+        *--begin = '0' + value % 10;
+        value /= 10;
+    } while (value != 0);
+    buffer.append(begin, end);
+}
+
+// Text of each value of T as written to the txt, wig and bedgraph files, i.e., the frequency or the mappability
+// 1 / frequency (formatted like std::ostream does). Avoids converting and formatting a float for every position.
+// Half-precision and quantized mappabilities are written with the fewest digits that are parsed to the same half.
+// Values with more than 16 bits (the exact frequencies of --compact-frequencies) are only written as frequencies and
+// formatted when they are appended.
+template <typename T>
+class ValueTexts
+{
+public:
+    explicit ValueTexts(OutputType const outputType)
+    {
+        if (sizeof(T) > 2)
+            return;
+
+        uint64_t const maxValue = std::numeric_limits<T>::max();
+        offsets.reserve(maxValue + 2);
+        offsets.push_back(0);
+        char text[32];
+        for (uint64_t v = 0; v <= maxValue; ++v)
         {
-            for (auto it = seqBegin; it < seqEnd - 1; ++it)
+            float const value = outputValue(outputType, v);
+            int len = 0;
+            if (outputType == OutputType::mappability_half || outputType == OutputType::mappability_quantized)
             {
-                float const f = (*it != 0) ? 1.0f / static_cast<float>(*it) : 0;
-                outfile << f << ' ';
+                for (int precision = 1; precision <= 9; ++precision)
+                {
+                    len = std::snprintf(text, sizeof(text), "%.*g", precision, value);
+                    if (sameValue(text, value))
+                        break;
+                }
+            }
+            else if (outputType == OutputType::mappability)
+            {
+                len = std::snprintf(text, sizeof(text), "%g", value);
             }
-            float const f = (*(seqEnd - 1) != 0) ? 1.0f / static_cast<float>(*(seqEnd - 1)) : 0;
-            outfile << f; // no space after last value
+            else
+            {
+                len = std::snprintf(text, sizeof(text), "%llu", static_cast<unsigned long long>(v));
+            }
+            chars.insert(chars.end(), text, text + len);
+            offsets.push_back(chars.size());
         }
+    }
+
+    void append(std::string & buffer, T const value) const
+    {
+        if (offsets.empty())
+            appendNumber(buffer, value);
         else
+            buffer.append(chars.data() + offsets[value], offsets[value + 1] - offsets[value]);
+    }
+
+private:
+    // whether text is parsed to the same half as value (the halves of all codes are distinct)
+    static bool sameValue(char const * const text, float const value)
+    {
+        return floatToHalf(std::strtof(text, nullptr)) == floatToHalf(value);
+    }
+
+    std::vector<char> chars;
+    std::vector<uint32_t> offsets;
+};
+
+template <typename TChromosomeNames>
+inline std::vector<std::string> chromosomeNameStrings(TChromosomeNames const & chromNames)
+{
+    std::vector<std::string> names;
+    for (uint64_t i = 0; i < length(chromNames); ++i)
+    {
+        std::ostringstream name;
+        name << chromNames[i];
+        names.push_back(name.str());
+    }
+    return names;
+}
+
+struct OutputChunk
+{
+    uint64_t chromosome;
+    uint64_t chromBegin; // position of the chromosome in c
+    uint64_t chromEnd;
+    uint64_t begin;      // positions [begin, end) in c
+    uint64_t end;
+};
+
+// Splits the chromosomes into chunks of about chunkSize positions (at least one chunk per chromosome). If keepRuns is
+// set, chunks only end where the value changes, i.e., a run of equal values is never split.
+template <typename TContainer, typename TChromosomeLengths>
+inline std::vector<OutputChunk> outputChunks(TContainer const & c, TChromosomeLengths const & chromLengths, bool const keepRuns,
+                                             uint64_t const chunkSize = outputChunkSize)
+{
+    std::vector<OutputChunk> chunks;
+    uint64_t chromBegin = 0;
+    for (uint64_t i = 0; i < length(chromLengths); ++i)
+    {
+        uint64_t const chromEnd = chromBegin + chromLengths[i];
+        uint64_t begin = chromBegin;
+        do
+        {
+            uint64_t end = std::min(begin + chunkSize, chromEnd);
+            while (keepRuns && end < chromEnd && c[end] == c[end - 1])
+                ++end;
+            chunks.push_back({i, chromBegin, chromEnd, begin, end});
+            begin = end;
+        } while (begin < chromEnd);
+        chromBegin = chromEnd;
+    }
+    return chunks;
+}
+
+// Formats the chunks [0, nbrChunks) in parallel, each one into its own buffer, and passes the buffers to write() in the
+// order of the chunks. At most 2 * threads chunks are kept in memory at the same time.
+template <typename TFormat, typename TWrite>
+inline void formatChunks(uint64_t const nbrChunks, unsigned const threads, TFormat && format, TWrite && write)
+{
+    uint64_t const batchSize = 2 * threads;
+    std::vector<std::string> buffers(batchSize);
+    for (uint64_t batchBegin = 0; batchBegin < nbrChunks; batchBegin += batchSize)
+    {
+        uint64_t const batchEnd = std::min(batchBegin + batchSize, nbrChunks);
+
+        #pragma omp parallel for schedule(dynamic, 1) num_threads(threads)
+        for (uint64_t chunk = batchBegin; chunk < batchEnd; ++chunk)
         {
-            std::copy(seqBegin, seqEnd - 1, std::ostream_iterator<uint16_t>(outfile, " "));
-            outfile << static_cast<uint16_t>(*(seqEnd - 1)); // no space after last value
+            buffers[chunk - batchBegin].clear();
+            format(chunk, buffers[chunk - batchBegin]);
         }
-        outfile << '\n';
 
-        if (i + 1 < length(chromLengths))
+        for (uint64_t chunk = batchBegin; chunk < batchEnd; ++chunk)
+            write(chunk, buffers[chunk - batchBegin]);
+    }
+}
+
+// Copies the values [begin, end) of c to dest. Vectors are copied at once, other containers (e.g., CompactFrequencies)
+// value by value.
+template <typename T, typename TAllocator>
+inline void copyValues(std::vector<T, TAllocator> const & c, uint64_t const begin, uint64_t const end, char * const dest)
+{
+    std::memcpy(dest, c.data() + begin, (end - begin) * sizeof(T));
+}
+
+template <typename TContainer>
+inline void copyValues(TContainer const & c, uint64_t const begin, uint64_t const end, char * const dest)
+{
+    typedef typename TContainer::value_type T;
+
+    for (uint64_t pos = begin; pos < end; ++pos)
+    {
+        T const value = c[pos];
+        std::memcpy(dest + (pos - begin) * sizeof(T), &value, sizeof(T));
+    }
+}
+
+// Writes the values of c in the binary format of std::vector<T>.
+template <typename T, typename TAllocator>
+inline void writeValues(std::ostream & out, std::vector<T, TAllocator> const & c, unsigned const /*threads*/)
+{
+    out.write((const char*) c.data(), c.size() * sizeof(T));
+}
+
+template <typename TContainer>
+inline void writeValues(std::ostream & out, TContainer const & c, unsigned const threads)
+{
+    typedef typename TContainer::value_type T;
+
+    auto format = [&](uint64_t const chunk, std::string & bytes)
+    {
+        uint64_t const begin = chunk * outputChunkSize;
+        uint64_t const end = std::min<uint64_t>(begin + outputChunkSize, c.size());
+        bytes.resize((end - begin) * sizeof(T));
+        copyValues(c, begin, end, &bytes[0]);
+    };
+
+    formatChunks((c.size() + outputChunkSize - 1) / outputChunkSize, threads, format, [&out](uint64_t const, std::string const & bytes) {
+        out.write(bytes.data(), bytes.size());
+    });
+}
+
+// Binary encoding of each value of T in the raw files: the frequency itself (copied from c) or the mappability as a
+// float (32 bit), half-precision float (16 bit) or quantized code (8 bit). The mappability requires T to have at most
+// 16 bits (a code is stored for each value).
+template <typename T>
+class RawValues
+{
+public:
+    explicit RawValues(OutputType const outputType) :
+        valueSize(sizeof(T))
+    {
+        if (!isMappability(outputType))
+            return;
+
+        valueSize = (outputType == OutputType::mappability) ? sizeof(float)
+                  : ((outputType == OutputType::mappability_half) ? sizeof(uint16_t) : sizeof(uint8_t));
+        bytes.resize((static_cast<uint64_t>(std::numeric_limits<T>::max()) + 1) * valueSize);
+        for (uint64_t v = 0; v <= std::numeric_limits<T>::max(); ++v)
         {
-            seqBegin = seqEnd;
-            seqEnd += chromLengths[i + 1];
+            char * const dest = &bytes[v * valueSize];
+            float const value = outputValue(outputType, v);
+            if (outputType == OutputType::mappability)
+            {
+                std::memcpy(dest, &value, sizeof(float));
+            }
+            else if (outputType == OutputType::mappability_half)
+            {
+                uint16_t const half = floatToHalf(value);
+                std::memcpy(dest, &half, sizeof(uint16_t));
+            }
+            else
+            {
+                *dest = static_cast<char>(quantizeFrequency(v));
+            }
         }
     }
+
+    uint64_t size() const
+    {
+        return valueSize;
+    }
+
+    void append(std::string & buffer, T const value) const
+    {
+        if (bytes.empty())
+            buffer.append(reinterpret_cast<char const *>(&value), sizeof(T));
+        else
+            buffer.append(&bytes[value * valueSize], valueSize);
+    }
+
+    // Writes the values [begin, end) of c to dest (size() bytes each).
+    template <typename TContainer>
+    void copy(TContainer const & c, uint64_t const begin, uint64_t const end, char * const dest) const
+    {
+        if (bytes.empty())
+            copyValues(c, begin, end, dest);
+        else if (valueSize == sizeof(float))
+            copyEncoded<sizeof(float)>(c, begin, end, dest);
+        else if (valueSize == sizeof(uint16_t))
+            copyEncoded<sizeof(uint16_t)>(c, begin, end, dest);
+        else
+            copyEncoded<sizeof(uint8_t)>(c, begin, end, dest);
+    }
+
+private:
+    template <uint64_t size, typename TContainer>
+    void copyEncoded(TContainer const & c, uint64_t const begin, uint64_t const end, char * const dest) const
+    {
+        for (uint64_t pos = begin; pos < end; ++pos)
+            std::memcpy(dest + (pos - begin) * size, &bytes[c[pos] * size], size);
+    }
+
+    uint64_t valueSize;
+    std::vector<char> bytes; // empty for frequencies
+};
+
+template <typename TContainer>
+void saveRaw(TContainer const & c, std::string const & output_path, OutputType const outputType, unsigned const threads,
+             bool const append = false)
+{
+    typedef typename TContainer::value_type T;
+
+    char buffer[BUFFER_SIZE];
+    std::ofstream outfile(output_path, std::ios::out | std::ios::binary | (append ? std::ios::app : std::ios::trunc));
+    outfile.rdbuf()->pubsetbuf(buffer, BUFFER_SIZE);
+
+    if (isMappability(outputType))
+    {
+        RawValues<T> const values(outputType);
+
+        auto format = [&](uint64_t const chunk, std::string & bytes)
+        {
+            uint64_t const begin = chunk * outputChunkSize;
+            uint64_t const end = std::min<uint64_t>(begin + outputChunkSize, c.size());
+            bytes.resize((end - begin) * values.size());
+            values.copy(c, begin, end, &bytes[0]);
+        };
+
+        formatChunks((c.size() + outputChunkSize - 1) / outputChunkSize, threads, format, [&outfile](uint64_t const, std::string const & bytes) {
+            outfile.write(bytes.data(), bytes.size());
+        });
+    }
+    else
+    {
+        writeValues(outfile, c, threads);
+    }
+
     outfile.close();
 }
 
-// TODO: do not output sequences in .chrom.sizes if no entries are written to .wig
-template <typename T, typename TChromosomeNames, typename TChromosomeLengths>
-void saveWig(std::vector<T> const & c, std::string const & output_path, TChromosomeNames const & chromNames, TChromosomeLengths const & chromLengths, bool const mappability)
+template <typename TContainer, typename TChromosomeNames, typename TChromosomeLengths>
+void saveTxt(TContainer const & c, std::string const & output_path, TChromosomeNames const & chromNames, TChromosomeLengths const & chromLengths, OutputType const outputType,
+             unsigned const threads, bool const append = false)
 {
-    uint64_t pos = 0;
-    uint64_t begin_pos_string = 0;
-    uint64_t end_pos_string = chromLengths[0];
+    typedef typename TContainer::value_type T;
 
     char buffer[BUFFER_SIZE];
+    std::ofstream outfile(output_path + ".txt", std::ios::out | std::ofstream::binary | (append ? std::ios::app : std::ios::trunc));
+    outfile.rdbuf()->pubsetbuf(buffer, BUFFER_SIZE);
 
-    std::ofstream wigFile(output_path + ".wig");
-    wigFile.rdbuf()->pubsetbuf(buffer, BUFFER_SIZE);
+    ValueTexts<T> const values(outputType);
+    std::vector<std::string> const names = chromosomeNameStrings(chromNames);
+    std::vector<OutputChunk> const chunks = outputChunks(c, chromLengths, false);
 
-    for (uint64_t i = 0; i < length(chromLengths); ++i)
+    auto format = [&](uint64_t const chunkId, std::string & text)
     {
-        uint16_t current_val = c[pos];
-        uint64_t occ = 0;
-        uint64_t last_occ = 0;
+        OutputChunk const & chunk = chunks[chunkId];
+        if (chunk.begin == chunk.chromBegin)
+            text.append(">").append(names[chunk.chromosome]).append("\n");
 
-        while (pos < end_pos_string + 1) // iterate once more to output the last line
+        for (uint64_t pos = chunk.begin; pos < chunk.end; ++pos)
         {
-            if (pos == end_pos_string || current_val != c[pos])
-            {
-                // TODO: document this behavior (mappability of 0)
-                if (current_val != 0)
-                {
-                    if (last_occ != occ)
-                        wigFile << "variableStep chrom=" << chromNames[i] << " span=" << occ << '\n';
-
-                    if (mappability)
-                    {
-                        float const value = (current_val != 0) ? 1.0f / static_cast<float>(current_val) : 0;
-                        wigFile << (pos - occ + 1 - begin_pos_string) << ' ' << value << '\n'; // pos in wig start at 1
-                    }
-                    else
-                    {
-                        wigFile << (pos - occ + 1 - begin_pos_string) << ' ' << current_val << '\n'; // pos in wig start at 1
-                    }
-                    last_occ = occ;
-                }
+            values.append(text, c[pos]);
+            if (pos + 1 < chunk.chromEnd)
+                text.push_back(' '); // no space after last value
+        }
 
-                occ = 0;
-                if (pos < end_pos_string)
-                    current_val = c[pos];
-            }
+        if (chunk.end == chunk.chromEnd)
+            text.push_back('\n');
+    };
+
+    formatChunks(chunks.size(), threads, format, [&outfile](uint64_t const, std::string const & text) {
+        outfile.write(text.data(), text.size());
+    });
+    outfile.close();
+}
 
-            ++occ;
-            ++pos;
+// TODO: do not output sequences in .chrom.sizes if no entries are written to .wig
+template <typename TContainer, typename TChromosomeNames, typename TChromosomeLengths>
+void saveWig(TContainer const & c, std::string const & output_path, TChromosomeNames const & chromNames, TChromosomeLengths const & chromLengths, OutputType const outputType,
+             unsigned const threads, bool const append = false)
+{
+    typedef typename TContainer::value_type T;
+
+    char buffer[BUFFER_SIZE];
+
+    std::ofstream wigFile(output_path + ".wig", std::ios::out | (append ? std::ios::app : std::ios::trunc));
+    wigFile.rdbuf()->pubsetbuf(buffer, BUFFER_SIZE);
+
+    ValueTexts<T> const values(outputType);
+    std::vector<std::string> const names = chromosomeNameStrings(chromNames);
+    std::vector<OutputChunk> const chunks = outputChunks(c, chromLengths, true);
+
+    // A "variableStep" line is written whenever the span differs from the previous run of the chromosome. The line of
+    // the first run of a chunk depends on the previous chunk and is written in order (see below).
+    std::vector<std::pair<uint64_t, uint64_t> > spans(chunks.size(), {0, 0}); // span of the first and last run with a value != 0
+
+    auto format = [&](uint64_t const chunkId, std::string & text)
+    {
+        OutputChunk const & chunk = chunks[chunkId];
+        uint64_t lastSpan = 0;
+        for (uint64_t pos = chunk.begin, runEnd; pos < chunk.end; pos = runEnd)
+        {
+            for (runEnd = pos + 1; runEnd < chunk.end && c[runEnd] == c[pos]; ++runEnd)
+                ;
+
+            // TODO: document this behavior (mappability of 0)
+            if (c[pos] == 0)
+                continue;
+
+            uint64_t const span = runEnd - pos;
+            if (lastSpan == 0)
+                spans[chunkId].first = span;
+            else if (lastSpan != span)
+                text.append("variableStep chrom=").append(names[chunk.chromosome]).append(" span=").append(std::to_string(span)).append("\n");
+            lastSpan = span;
+
+            appendNumber(text, pos - chunk.chromBegin + 1); // pos in wig start at 1
+            text.push_back(' ');
+            values.append(text, c[pos]);
+            text.push_back('\n');
         }
-        --pos; // pos is incremented once too often by the additional last iteration, i.e., pos == end_pos_string
+        spans[chunkId].second = lastSpan;
+    };
 
-        begin_pos_string += chromLengths[i];
-        if (i + 1 < length(chromLengths))
-            end_pos_string += chromLengths[i + 1];
-    }
+    uint64_t lastSpan = 0;
+    auto write = [&](uint64_t const chunkId, std::string const & text)
+    {
+        OutputChunk const & chunk = chunks[chunkId];
+        if (chunk.begin == chunk.chromBegin)
+            lastSpan = 0;
+        if (spans[chunkId].first != 0)
+        {
+            if (spans[chunkId].first != lastSpan)
+                wigFile << "variableStep chrom=" << names[chunk.chromosome] << " span=" << spans[chunkId].first << '\n';
+            lastSpan = spans[chunkId].second;
+        }
+        wigFile.write(text.data(), text.size());
+    };
+
+    formatChunks(chunks.size(), threads, format, write);
     wigFile.close();
 
     // .chrom.sizes file
-    std::ofstream chromSizesFile(output_path + ".chrom.sizes");
+    std::ofstream chromSizesFile(output_path + ".chrom.sizes", std::ios::out | (append ? std::ios::app : std::ios::trunc));
     for (uint64_t i = 0; i < length(chromLengths); ++i)
         chromSizesFile << chromNames[i] << '\t' << chromLengths[i] << '\n';
     chromSizesFile.close();
 }
 
-template <typename T, typename TChromosomeNames, typename TChromosomeLengths>
-void saveBedGraph(std::vector<T> const & c, std::string const & output_path, TChromosomeNames const & chromNames, TChromosomeLengths const & chromLengths, bool const bedGraphFormat, bool const mappability)
+template <typename TContainer, typename TChromosomeNames, typename TChromosomeLengths>
+void saveBedGraph(TContainer const & c, std::string const & output_path, TChromosomeNames const & chromNames, TChromosomeLengths const & chromLengths, bool const bedGraphFormat, OutputType const outputType,
+                  unsigned const threads, bool const append = false)
 {
-    uint64_t pos = 0;
-    uint64_t begin_pos_string = 0;
-    uint64_t end_pos_string = chromLengths[0];
+    typedef typename TContainer::value_type T;
 
     char buffer[BUFFER_SIZE];
 
-    std::ofstream bedgraphFile(output_path + (bedGraphFormat ? ".bedgraph" : ".bed"));
+    std::ofstream bedgraphFile(output_path + (bedGraphFormat ? ".bedgraph" : ".bed"), std::ios::out | (append ? std::ios::app : std::ios::trunc));
     bedgraphFile.rdbuf()->pubsetbuf(buffer, BUFFER_SIZE);
 
-    for (uint64_t i = 0; i < length(chromLengths); ++i)
-    {
-        uint16_t current_val = c[pos];
-        uint64_t occ = 0;
+    ValueTexts<T> const values(outputType);
+    std::vector<std::string> const names = chromosomeNameStrings(chromNames);
+    std::vector<OutputChunk> const chunks = outputChunks(c, chromLengths, true);
 
-        while (pos < end_pos_string + 1) // iterate once more to output the last line
+    auto format = [&](uint64_t const chunkId, std::string & text)
+    {
+        OutputChunk const & chunk = chunks[chunkId];
+        for (uint64_t pos = chunk.begin, runEnd; pos < chunk.end; pos = runEnd)
         {
-            if (pos == end_pos_string || current_val != c[pos])
-            {
-                if (current_val != 0)
-                {
-                    bedgraphFile << chromNames[i] << '\t'                    // chrom name
-                                 << (pos - occ - begin_pos_string) << '\t'   // start pos (begins with 0)
-                                 << (pos - begin_pos_string) << '\t';        // name
+            for (runEnd = pos + 1; runEnd < chunk.end && c[runEnd] == c[pos]; ++runEnd)
+                ;
 
-                    if (!bedGraphFormat)
-                        bedgraphFile << '-' << '\t';
+            if (c[pos] == 0)
+                continue;
 
-                    if (mappability)
-                        bedgraphFile << ((current_val != 0) ? 1.0f / static_cast<float>(current_val) : 0) << '\n';
-                    else
-                        bedgraphFile << current_val << '\n';
-                }
+            text.append(names[chunk.chromosome]).push_back('\t');        // chrom name
+            appendNumber(text, pos - chunk.chromBegin);                  // start pos (begins with 0)
+            text.push_back('\t');
+            appendNumber(text, runEnd - chunk.chromBegin);               // end pos
+            text.push_back('\t');
 
-                occ = 0;
-                if (pos < end_pos_string)
-                    current_val = c[pos];
-            }
+            if (!bedGraphFormat)
+                text.append("-\t");                                      // name
 
-            ++occ;
-            ++pos;
+            values.append(text, c[pos]);
+            text.push_back('\n');
         }
-        --pos; // pos is incremented once too often by the additional last iteration, i.e., pos == end_pos_string
+    };
 
-        begin_pos_string += chromLengths[i];
-        if (i + 1 < length(chromLengths))
-            end_pos_string += chromLengths[i + 1];
-    }
+    formatChunks(chunks.size(), threads, format, [&bedgraphFile](uint64_t const, std::string const & text) {
+        bedgraphFile.write(text.data(), text.size());
+    });
     bedgraphFile.close();
 }
 
-template <typename TLocations, typename TDirectoryInformation, typename TCSVIntervals>
-void saveCsv(std::string const & output_path, TLocations const & locations,
-             SearchParams const & searchParams, TDirectoryInformation const & directoryInformation,
-             TCSVIntervals const & csvIntervals, bool const outputSelection)
+// --unique-mask: writes a mask with a bit per position that is set iff the k-mer starting there is unique (frequency of
+// 1) to .unique.mask and the runs of unique k-mers to .unique.bed. The mask of each chromosome starts at a new byte,
+// i.e., it has (length + 7) / 8 bytes and bit j % 8 (least significant bit first) of byte j / 8 refers to position j.
+template <typename TContainer, typename TChromosomeNames, typename TChromosomeLengths>
+void saveUniqueMask(TContainer const & c, std::string const & output_path, TChromosomeNames const & chromNames, TChromosomeLengths const & chromLengths,
+                    unsigned const threads, bool const append = false)
 {
+    static_assert(outputChunkSize % 8 == 0, "Chunks of the mask have to start at a new byte.");
+
     char buffer[BUFFER_SIZE];
 
-    std::ofstream csvFile(output_path + ".csv");
-    csvFile.rdbuf()->pubsetbuf(buffer, BUFFER_SIZE);
+    std::ofstream maskFile(output_path + ".unique.mask", std::ios::out | std::ios::binary | (append ? std::ios::app : std::ios::trunc));
+    maskFile.rdbuf()->pubsetbuf(buffer, BUFFER_SIZE);
 
+    std::vector<OutputChunk> const maskChunks = outputChunks(c, chromLengths, false);
+    auto formatMask = [&](uint64_t const chunkId, std::string & bytes)
+    {
+        OutputChunk const & chunk = maskChunks[chunkId];
+        bytes.assign((chunk.end - chunk.begin + 7) / 8, 0);
+        for (uint64_t pos = chunk.begin; pos < chunk.end; ++pos)
+        {
+            if (c[pos] == 1)
+                bytes[(pos - chunk.begin) / 8] |= 1 << ((pos - chunk.begin) % 8);
+        }
+    };
+
+    formatChunks(maskChunks.size(), threads, formatMask, [&maskFile](uint64_t const, std::string const & bytes) {
+        maskFile.write(bytes.data(), bytes.size());
+    });
+    maskFile.close();
+
+    std::ofstream bedFile(output_path + ".unique.bed", std::ios::out | (append ? std::ios::app : std::ios::trunc));
+    bedFile.rdbuf()->pubsetbuf(buffer, BUFFER_SIZE);
+
+    std::vector<std::string> const names = chromosomeNameStrings(chromNames);
+    std::vector<OutputChunk> const bedChunks = outputChunks(c, chromLengths, true);
+    auto formatBed = [&](uint64_t const chunkId, std::string & text)
+    {
+        OutputChunk const & chunk = bedChunks[chunkId];
+        for (uint64_t pos = chunk.begin, runEnd; pos < chunk.end; pos = runEnd)
+        {
+            for (runEnd = pos + 1; runEnd < chunk.end && c[runEnd] == c[pos]; ++runEnd)
+                ;
+
+            if (c[pos] != 1)
+                continue;
+
+            text.append(names[chunk.chromosome]).push_back('\t');
+            appendNumber(text, pos - chunk.chromBegin);
+            text.push_back('\t');
+            appendNumber(text, runEnd - chunk.chromBegin);
+            text.push_back('\n');
+        }
+    };
+
+    formatChunks(bedChunks.size(), threads, formatBed, [&bedFile](uint64_t const, std::string const & text) {
+        bedFile.write(text.data(), text.size());
+    });
+    bedFile.close();
+}
+
+// Fasta files and the cumulative number of their sequences (for separating the locations by fasta file in csv files).
+template <typename TDirectoryInformation>
+std::vector<std::pair<std::string, uint64_t> > csvFastaFiles(TDirectoryInformation const & directoryInformation)
+{
     uint64_t chromosomeCount = 0;
     std::vector<std::pair<std::string, uint64_t> > fastaFiles; // fasta file, cumulative nbr. of chromosomes
     std::string lastFastaFile = std::get<0>(retrieveDirectoryInformationLine(directoryInformation[0]));
@@ -209,80 +667,153 @@ void saveCsv(std::string const & output_path, TLocations const & locations,
         }
         ++chromosomeCount;
     }
+    return fastaFiles;
+}
 
-    csvFile << "\"k-mer\"";
+inline void writeCsvLocationsHeader(std::ofstream & csvFile, std::vector<std::pair<std::string, uint64_t> > const & fastaFiles,
+                                    bool const revCompl)
+{
     for (auto const & fastaFile : fastaFiles)
         csvFile << ";\"+ strand " << fastaFile.first << "\"";
-    if (searchParams.revCompl)
+    if (revCompl)
     {
         for (auto const & fastaFile : fastaFiles)
             csvFile << ";\"- strand " << fastaFile.first << "\"";
     }
     csvFile << '\n';
+}
 
-    auto interval = csvIntervals.begin();
-
-    for (auto const & kmerLocations : locations)
+// Writes the columns with the locations of a k-mer on the forward strand (and the reverse strand) for each fasta file.
+template <typename TLocations>
+inline void writeCsvLocations(std::ofstream & csvFile, std::vector<std::pair<std::string, uint64_t> > const & fastaFiles,
+                              TLocations const & plusStrandLoc, TLocations const & minusStrandLoc, bool const revCompl)
+{
+    uint64_t i = 0;
+    uint64_t nbrChromosomesInPreviousFastas = 0;
+    for (auto const & fastaFile : fastaFiles)
     {
-        auto const & kmerPos = kmerLocations.first;
-        auto const & plusStrandLoc = kmerLocations.second.first;
-        auto const & minusStrandLoc = kmerLocations.second.second;
-
-        while (interval != csvIntervals.end() &&
-               ((std::get<0>(*interval) < kmerPos.i1) ||
-               (std::get<0>(*interval) == kmerPos.i1 && std::get<2>(*interval) <= kmerPos.i2)))
-        {
-            ++interval;
-        }
-
-        if (outputSelection &&
-            !(std::get<0>(*interval) == kmerPos.i1 &&
-              std::get<1>(*interval) <= kmerPos.i2 &&
-              kmerPos.i2 < std::get<2>(*interval)))
+        csvFile << ';';
+        bool subsequentIterations = false;
+        while (i < plusStrandLoc.size() && plusStrandLoc[i].i1 <= fastaFile.second)
         {
-            continue;
+            if (subsequentIterations)
+                csvFile << '|'; // separator for multiple locations in one column
+            csvFile << (plusStrandLoc[i].i1 - nbrChromosomesInPreviousFastas) << ',' << plusStrandLoc[i].i2;
+            subsequentIterations = true;
+            ++i;
         }
+        nbrChromosomesInPreviousFastas = fastaFile.second + 1;
+    }
 
-        csvFile << kmerPos.i1 << ',' << kmerPos.i2;
-
+    if (revCompl)
+    {
         uint64_t i = 0;
         uint64_t nbrChromosomesInPreviousFastas = 0;
         for (auto const & fastaFile : fastaFiles)
         {
             csvFile << ';';
             bool subsequentIterations = false;
-            while (i < plusStrandLoc.size() && plusStrandLoc[i].i1 <= fastaFile.second)
+            while (i < minusStrandLoc.size() && minusStrandLoc[i].i1 <= fastaFile.second)
             {
                 if (subsequentIterations)
                     csvFile << '|'; // separator for multiple locations in one column
-                csvFile << (plusStrandLoc[i].i1 - nbrChromosomesInPreviousFastas) << ',' << plusStrandLoc[i].i2;
+                csvFile << (minusStrandLoc[i].i1 - nbrChromosomesInPreviousFastas) << ',' << minusStrandLoc[i].i2;
                 subsequentIterations = true;
                 ++i;
             }
             nbrChromosomesInPreviousFastas = fastaFile.second + 1;
         }
+    }
+}
 
-        if (searchParams.revCompl)
-        {
-            uint64_t i = 0;
-            uint64_t nbrChromosomesInPreviousFastas = 0;
-            for (auto const & fastaFile : fastaFiles)
-            {
-                csvFile << ';';
-                bool subsequentIterations = false;
-                while (i < minusStrandLoc.size() && minusStrandLoc[i].i1 <= fastaFile.second)
-                {
-                    if (subsequentIterations)
-                        csvFile << '|'; // separator for multiple locations in one column
-                    csvFile << (minusStrandLoc[i].i1 - nbrChromosomesInPreviousFastas) << ',' << minusStrandLoc[i].i2;
-                    subsequentIterations = true;
-                    ++i;
-                }
-                nbrChromosomesInPreviousFastas = fastaFile.second + 1;
-            }
-        }
-        csvFile << '\n';
+// Returns whether a k-mer is selected for the csv output (if only a subset shall be written, i.e., outputSelection).
+// The k-mers have to be passed in sorted order, `interval` is advanced accordingly.
+template <typename TCSVIntervals, typename TLocation>
+inline bool csvSelected(typename TCSVIntervals::const_iterator & interval, TCSVIntervals const & csvIntervals,
+                        TLocation const & kmerPos, bool const outputSelection)
+{
+    while (interval != csvIntervals.end() &&
+           ((std::get<0>(*interval) < kmerPos.i1) ||
+           (std::get<0>(*interval) == kmerPos.i1 && std::get<2>(*interval) <= kmerPos.i2)))
+    {
+        ++interval;
     }
 
+    return !outputSelection ||
+           (std::get<0>(*interval) == kmerPos.i1 &&
+            std::get<1>(*interval) <= kmerPos.i2 &&
+            kmerPos.i2 < std::get<2>(*interval));
+}
+
+template <typename TLocations, typename TDirectoryInformation, typename TCSVIntervals>
+void saveCsv(std::string const & output_path, TLocations & locations,
+             SearchParams const & searchParams, TDirectoryInformation const & directoryInformation,
+             TCSVIntervals const & csvIntervals, bool const outputSelection)
+{
+    char buffer[BUFFER_SIZE];
+
+    std::ofstream csvFile(output_path + ".csv");
+    csvFile.rdbuf()->pubsetbuf(buffer, BUFFER_SIZE);
+
+    auto const fastaFiles = csvFastaFiles(directoryInformation);
+
+    csvFile << "\"k-mer\"";
+    writeCsvLocationsHeader(csvFile, fastaFiles, searchParams.revCompl);
+
+    auto interval = csvIntervals.begin();
+
+    // k-mers are visited in sorted order of their positions
+    locations.forEach([&](auto const & kmerPos, auto const & plusStrandLoc, auto const & minusStrandLoc)
+    {
+        if (!csvSelected(interval, csvIntervals, kmerPos, outputSelection))
+            return;
+
+        csvFile << kmerPos.i1 << ',' << kmerPos.i2;
+        writeCsvLocations(csvFile, fastaFiles, plusStrandLoc, minusStrandLoc, searchParams.revCompl);
+        csvFile << '\n';
+    });
+
     csvFile.close();
 }
+
+// Deduplicated csv output (--csv-classes). The locations of each repeat class are written once to .classes.csv, the
+// k-mers only refer to their class in .kmers.csv. Classes are not filtered by the selection (outputSelection).
+template <typename TLocations, typename TDirectoryInformation, typename TCSVIntervals>
+void saveCsvClasses(std::string const & output_path, TLocations & locations,
+                    SearchParams const & searchParams, TDirectoryInformation const & directoryInformation,
+                    TCSVIntervals const & csvIntervals, bool const outputSelection)
+{
+    char buffer[BUFFER_SIZE];
+
+    {
+        std::ofstream kmersFile(output_path + ".kmers.csv");
+        kmersFile.rdbuf()->pubsetbuf(buffer, BUFFER_SIZE);
+
+        kmersFile << "\"k-mer\";\"class\"\n";
+
+        auto interval = csvIntervals.begin();
+        locations.forEachPosition([&](auto const & kmerPos, uint64_t const repeatClass)
+        {
+            if (csvSelected(interval, csvIntervals, kmerPos, outputSelection))
+                kmersFile << kmerPos.i1 << ',' << kmerPos.i2 << ';' << repeatClass << '\n';
+        });
+        kmersFile.close();
+    }
+
+    std::ofstream classesFile(output_path + ".classes.csv");
+    classesFile.rdbuf()->pubsetbuf(buffer, BUFFER_SIZE);
+
+    auto const fastaFiles = csvFastaFiles(directoryInformation);
+
+    classesFile << "\"class\"";
+    writeCsvLocationsHeader(classesFile, fastaFiles, searchParams.revCompl);
+
+    locations.forEachClass([&](uint64_t const repeatClass, auto const & plusStrandLoc, auto const & minusStrandLoc)
+    {
+        classesFile << repeatClass;
+        writeCsvLocations(classesFile, fastaFiles, plusStrandLoc, minusStrandLoc, searchParams.revCompl);
+        classesFile << '\n';
+    });
+
+    classesFile.close();
+}
@@ -0,0 +1,371 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <seqan/arg_parse.h>
+#include <seqan/bed_io.h>
+
+using namespace seqan;
+
+// Block summaries of a raw file (.sum), a sidecar of `genmap query` such that intervals spanning entire blocks do not
+// need to be scanned. Integers are LEB128 varints unless stated otherwise.
+//
+// magic "GMSUM01\0" (8 bytes)
+// header:  block size, threshold (double), number of chromosomes, for each chromosome: its length
+// blocks:  for each chromosome and each of its blocks (of block size positions, the last one can be shorter):
+//          minimum, maximum, sum (double), number of positions with a value >= threshold (uint64_t)
+
+constexpr char rawSummaryMagic[] = "GMSUM01";
+constexpr uint64_t rawSummaryBlockSize = 1 << 16; // positions per block
+
+// Statistics of the values of an interval. Also used for the blocks of the summaries.
+struct QueryStats
+{
+    double min = std::numeric_limits<double>::infinity();
+    double max = -std::numeric_limits<double>::infinity();
+    double sum = 0;
+    uint64_t count = 0; // positions with a value >= threshold
+    uint64_t length = 0;
+
+    void add(uint64_t const runLength, double const value, double const threshold)
+    {
+        min = std::min(min, value);
+        max = std::max(max, value);
+        sum += runLength * value;
+        count += (value >= threshold) ? runLength : 0;
+        length += runLength;
+    }
+
+    void add(QueryStats const & stats, uint64_t const statsCount)
+    {
+        min = std::min(min, stats.min);
+        max = std::max(max, stats.max);
+        sum += stats.sum;
+        count += statsCount;
+        length += stats.length;
+    }
+};
+
+struct RawSummaries
+{
+    uint64_t blockSize = rawSummaryBlockSize;
+    double threshold = 0;
+    std::vector<uint64_t> chromFirstBlock;
+    std::vector<QueryStats> blocks;
+
+    void init(RawInfo const & info)
+    {
+        chromFirstBlock.clear();
+        uint64_t nbrBlocks = 0;
+        for (uint64_t const chromLength : info.chromLengths)
+        {
+            chromFirstBlock.push_back(nbrBlocks);
+            nbrBlocks += (chromLength + blockSize - 1) / blockSize;
+        }
+        blocks.assign(nbrBlocks, QueryStats());
+    }
+};
+
+template <typename TValue>
+inline void scanRaw(RawReader const & reader, uint64_t const chrom, uint64_t const begin, uint64_t const end,
+                    double const threshold, QueryStats & stats)
+{
+    reader.forEachRun<TValue>(chrom, begin, end, [&](uint64_t const runBegin, uint64_t const runEnd, TValue const value) {
+        stats.add(runEnd - runBegin, reader.value(value), threshold);
+    });
+}
+
+// Computes the summaries of all blocks in parallel.
+template <typename TValue>
+inline void computeRawSummaries(RawReader const & reader, RawSummaries & summaries, unsigned const threads)
+{
+    summaries.init(reader.info);
+    for (uint64_t chrom = 0; chrom < reader.info.chromLengths.size(); ++chrom)
+    {
+        uint64_t const chromLength = reader.info.chromLengths[chrom];
+        uint64_t const nbrBlocks = (chromLength + summaries.blockSize - 1) / summaries.blockSize;
+        #pragma omp parallel for schedule(dynamic, 1) num_threads(threads)
+        for (uint64_t block = 0; block < nbrBlocks; ++block)
+        {
+            uint64_t const begin = block * summaries.blockSize;
+            uint64_t const end = std::min(begin + summaries.blockSize, chromLength);
+            scanRaw<TValue>(reader, chrom, begin, end, summaries.threshold, summaries.blocks[summaries.chromFirstBlock[chrom] + block]);
+        }
+    }
+}
+
+inline void saveRawSummaries(RawSummaries const & summaries, RawInfo const & info, std::string const & path)
+{
+    std::ofstream out(path, std::ios::out | std::ios::binary);
+    out.write(rawSummaryMagic, sizeof(rawSummaryMagic));
+    writeVarint(out, summaries.blockSize);
+    out.write(reinterpret_cast<char const *>(&summaries.threshold), sizeof(double));
+    writeVarint(out, info.chromLengths.size());
+    for (uint64_t const chromLength : info.chromLengths)
+        writeVarint(out, chromLength);
+    for (QueryStats const & block : summaries.blocks)
+    {
+        out.write(reinterpret_cast<char const *>(&block.min), sizeof(double));
+        out.write(reinterpret_cast<char const *>(&block.max), sizeof(double));
+        out.write(reinterpret_cast<char const *>(&block.sum), sizeof(double));
+        writeUint64(out, block.count);
+    }
+    out.close();
+}
+
+// Returns false if the file is not a summary of a raw file with the chromosome lengths of info.
+inline bool loadRawSummaries(RawSummaries & summaries, RawInfo const & info, std::string const & path)
+{
+    std::ifstream in(path, std::ios::in | std::ios::binary);
+    char magic[8];
+    uint64_t nbrChromosomes;
+    if (!in.read(magic, 8) || memcmp(magic, rawSummaryMagic, 8) != 0 || !readVarint(in, summaries.blockSize) ||
+        summaries.blockSize == 0 || !in.read(reinterpret_cast<char *>(&summaries.threshold), sizeof(double)) ||
+        !readVarint(in, nbrChromosomes) || nbrChromosomes != info.chromLengths.size())
+    {
+        return false;
+    }
+    for (uint64_t const chromLength : info.chromLengths)
+    {
+        uint64_t length;
+        if (!readVarint(in, length) || length != chromLength)
+            return false;
+    }
+
+    summaries.init(info);
+    for (uint64_t chrom = 0; chrom < info.chromLengths.size(); ++chrom)
+    {
+        for (uint64_t block = 0, begin = 0; begin < info.chromLengths[chrom]; ++block, begin += summaries.blockSize)
+        {
+            QueryStats & stats = summaries.blocks[summaries.chromFirstBlock[chrom] + block];
+            if (!in.read(reinterpret_cast<char *>(&stats.min), sizeof(double)) ||
+                !in.read(reinterpret_cast<char *>(&stats.max), sizeof(double)) ||
+                !in.read(reinterpret_cast<char *>(&stats.sum), sizeof(double)) || !readUint64(in, stats.count))
+            {
+                return false;
+            }
+            stats.length = std::min(summaries.blockSize, info.chromLengths[chrom] - begin);
+        }
+    }
+    return true;
+}
+
+// Statistics of [begin, end) of a chromosome. Blocks entirely covered by the interval are taken from the summaries
+// (if any). The count of a block can only be taken from the summaries if they were computed for the same threshold
+// or if all values of the block are on the same side of the threshold.
+template <typename TValue>
+inline QueryStats queryRaw(RawReader const & reader, RawSummaries const * summaries, uint64_t const chrom,
+                           uint64_t const begin, uint64_t const end, double const threshold)
+{
+    QueryStats stats;
+    if (summaries == nullptr)
+    {
+        scanRaw<TValue>(reader, chrom, begin, end, threshold, stats);
+        return stats;
+    }
+
+    uint64_t const blockSize = summaries->blockSize;
+    uint64_t const firstBlock = (begin + blockSize - 1) / blockSize;
+    uint64_t const lastBlock = end / blockSize; // blocks [firstBlock, lastBlock) are covered entirely
+    if (firstBlock >= lastBlock)
+    {
+        scanRaw<TValue>(reader, chrom, begin, end, threshold, stats);
+        return stats;
+    }
+
+    scanRaw<TValue>(reader, chrom, begin, firstBlock * blockSize, threshold, stats);
+    for (uint64_t block = firstBlock; block < lastBlock; ++block)
+    {
+        QueryStats const & blockStats = summaries->blocks[summaries->chromFirstBlock[chrom] + block];
+        if (summaries->threshold == threshold)
+            stats.add(blockStats, blockStats.count);
+        else if (blockStats.min >= threshold)
+            stats.add(blockStats, blockStats.length);
+        else if (blockStats.max < threshold)
+            stats.add(blockStats, 0);
+        else
+            scanRaw<TValue>(reader, chrom, block * blockSize, (block + 1) * blockSize, threshold, stats);
+    }
+    scanRaw<TValue>(reader, chrom, lastBlock * blockSize, end, threshold, stats);
+    return stats;
+}
+
+struct QueryInterval
+{
+    uint64_t chrom;
+    uint64_t begin;
+    uint64_t end;
+};
+
+template <typename TValue>
+inline void queryRawIntervals(RawReader const & reader, RawSummaries const * summaries,
+                              std::vector<QueryInterval> const & intervals, double const threshold,
+                              std::ostream & out, unsigned const threads)
+{
+    uint64_t const chunkSize = 1 << 12; // intervals per chunk
+    auto format = [&](uint64_t const chunk, std::string & text)
+    {
+        std::ostringstream stream;
+        uint64_t const end = std::min<uint64_t>((chunk + 1) * chunkSize, intervals.size());
+        for (uint64_t i = chunk * chunkSize; i < end; ++i)
+        {
+            QueryInterval const & interval = intervals[i];
+            stream << reader.info.chromNames[interval.chrom] << '\t' << interval.begin << '\t' << interval.end << '\t';
+            // positions beyond the end of the chromosome are ignored
+            uint64_t const intervalEnd = std::min(interval.end, reader.info.chromLengths[interval.chrom]);
+            if (interval.begin >= intervalEnd)
+            {
+                stream << "NA\tNA\tNA\t0\n";
+                continue;
+            }
+            QueryStats const stats = queryRaw<TValue>(reader, summaries, interval.chrom, interval.begin, intervalEnd, threshold);
+            stream << stats.min << '\t' << stats.max << '\t' << (stats.sum / stats.length) << '\t' << stats.count << '\n';
+        }
+        text = stream.str();
+    };
+
+    // the chunks of intervals are queried and formatted in parallel
+    formatChunks((intervals.size() + chunkSize - 1) / chunkSize, threads, format, [&out](uint64_t const, std::string const & text) {
+        out.write(text.data(), text.size());
+    });
+}
+
+int queryMain(int const argc, char const ** argv)
+{
+    ArgumentParser parser("GenMap query");
+    sharedSetup(parser);
+    addDescription(parser, "Computes statistics of intervals of a raw file with a header (`genmap map --raw-format rle` or "
+                           "`--raw-format aligned`), i.e., the minimum, maximum, mean and the number of positions with a value "
+                           "of at least the threshold (e.g., the number of unique positions of a .map file with -t 1). The raw "
+                           "file is memory mapped and the intervals are queried in parallel. The output has the columns "
+                           "chromosome, start, end, min, max, mean, count.");
+
+    addOption(parser, ArgParseOption("I", "input", "Path to the raw file (.raw or .rle).", ArgParseArgument::INPUT_FILE, "IN"));
+    setRequired(parser, "input");
+
+    addOption(parser, ArgParseOption("B", "bed", "Path to a bed file with the intervals (3 columns: chromosome, start, end).", ArgParseArgument::INPUT_FILE, "IN"));
+
+    addOption(parser, ArgParseOption("O", "output", "Path to the output file (default: standard output).", ArgParseArgument::OUTPUT_FILE, "OUT"));
+
+    addOption(parser, ArgParseOption("t", "threshold", "Positions with a value of at least the threshold are counted.", ArgParseArgument::DOUBLE, "DOUBLE"));
+    setDefaultValue(parser, "threshold", "1");
+
+    addOption(parser, ArgParseOption("s", "summary", "Path to the block summaries of the raw file (.sum). Intervals spanning "
+        "entire blocks are answered without scanning them. Create it with --create-summary.", ArgParseArgument::STRING, "FILE"));
+
+    addOption(parser, ArgParseOption("cs", "create-summary", "Creates the block summaries given by --summary (for the counts of "
+        "--threshold) before querying. --bed is optional."));
+
+    addOption(parser, ArgParseOption("sb", "summary-block-size", "Number of positions per block of the summaries created by --create-summary.", ArgParseArgument::INTEGER, "INT"));
+    setDefaultValue(parser, "summary-block-size", rawSummaryBlockSize);
+    setMinValue(parser, "summary-block-size", "1");
+
+    addOption(parser, ArgParseOption("T", "threads", "Number of threads", ArgParseArgument::INTEGER, "INT"));
+    setDefaultValue(parser, "threads", omp_get_max_threads());
+
+    ArgumentParser::ParseResult res = parse(parser, argc, argv);
+    if (res != ArgumentParser::PARSE_OK)
+        return res == ArgumentParser::PARSE_ERROR;
+
+    bool const createSummary = isSet(parser, "create-summary");
+    if (createSummary && !isSet(parser, "summary"))
+    {
+        std::cerr << "ERROR: --create-summary requires --summary.\n";
+        return ArgumentParser::PARSE_ERROR;
+    }
+    if (!createSummary && !isSet(parser, "bed"))
+    {
+        std::cerr << "ERROR: Please choose --bed or --create-summary.\n";
+        return ArgumentParser::PARSE_ERROR;
+    }
+
+    CharString inputPath, bedPath, outputPath, summaryPath;
+    double threshold;
+    unsigned threads;
+    getOptionValue(inputPath, parser, "input");
+    getOptionValue(bedPath, parser, "bed");
+    getOptionValue(outputPath, parser, "output");
+    getOptionValue(summaryPath, parser, "summary");
+    getOptionValue(threshold, parser, "threshold");
+    getOptionValue(threads, parser, "threads");
+
+    RawReader reader;
+    if (!reader.open(toCString(inputPath)))
+    {
+        std::cerr << "ERROR: " << inputPath << " is not a raw file with a header (see genmap map --raw-format).\n";
+        return ArgumentParser::PARSE_ERROR;
+    }
+
+    RawSummaries summaries;
+    if (createSummary)
+    {
+        getOptionValue(summaries.blockSize, parser, "summary-block-size");
+        summaries.threshold = threshold;
+        if (reader.info.valueType == RawValueType::frequency8 || reader.info.valueType == RawValueType::mappability8)
+            computeRawSummaries<uint8_t>(reader, summaries, threads);
+        else if (reader.info.valueType == RawValueType::frequency16 || reader.info.valueType == RawValueType::mappability16)
+            computeRawSummaries<uint16_t>(reader, summaries, threads);
+        else if (reader.info.valueType == RawValueType::frequency32)
+            computeRawSummaries<uint32_t>(reader, summaries, threads);
+        else // if (reader.info.valueType == RawValueType::mappability32)
+            computeRawSummaries<float>(reader, summaries, threads);
+        saveRawSummaries(summaries, reader.info, toCString(summaryPath));
+    }
+    else if (isSet(parser, "summary") && !loadRawSummaries(summaries, reader.info, toCString(summaryPath)))
+    {
+        std::cerr << "ERROR: " << summaryPath << " is not a summary of " << inputPath << ".\n";
+        return ArgumentParser::PARSE_ERROR;
+    }
+
+    if (!isSet(parser, "bed"))
+        return 0;
+
+    std::map<std::string, uint64_t> chromIds;
+    for (uint64_t i = 0; i < reader.info.chromNames.size(); ++i)
+        chromIds.emplace(reader.info.chromNames[i], i);
+
+    std::vector<QueryInterval> intervals;
+    BedFileIn bedIn(toCString(bedPath));
+    BedRecord<Bed3> record;
+    while (!atEnd(bedIn))
+    {
+        readRecord(record, bedIn);
+        auto const chromId = chromIds.find(toCString(record.ref));
+        if (chromId == chromIds.end())
+        {
+            std::cerr << "ERROR: The chromosome " << record.ref << " is not contained in " << inputPath << ".\n";
+            return 1;
+        }
+        intervals.push_back({chromId->second, static_cast<uint64_t>(record.beginPos), static_cast<uint64_t>(record.endPos)});
+    }
+
+    char buffer[BUFFER_SIZE];
+    std::ofstream outputFile;
+    if (isSet(parser, "output"))
+    {
+        outputFile.open(toCString(outputPath), std::ios::out | std::ios::binary);
+        outputFile.rdbuf()->pubsetbuf(buffer, BUFFER_SIZE);
+    }
+    std::ostream & out = isSet(parser, "output") ? outputFile : std::cout;
+
+    RawSummaries const * const summariesPtr = isSet(parser, "summary") ? &summaries : nullptr;
+    if (reader.info.valueType == RawValueType::frequency8 || reader.info.valueType == RawValueType::mappability8)
+        queryRawIntervals<uint8_t>(reader, summariesPtr, intervals, threshold, out, threads);
+    else if (reader.info.valueType == RawValueType::frequency16 || reader.info.valueType == RawValueType::mappability16)
+        queryRawIntervals<uint16_t>(reader, summariesPtr, intervals, threshold, out, threads);
+    else if (reader.info.valueType == RawValueType::frequency32)
+        queryRawIntervals<uint32_t>(reader, summariesPtr, intervals, threshold, out, threads);
+    else // if (reader.info.valueType == RawValueType::mappability32)
+        queryRawIntervals<float>(reader, summariesPtr, intervals, threshold, out, threads);
+
+    return 0;
+}
@@ -0,0 +1,466 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "locations_io.hpp"
+
+// Raw formats with a header (see --raw-format), i.e., the values can be interpreted without knowing the index or the
+// parameters of the run. All integers are LEB128 varints unless stated otherwise.
+//
+// Both formats start with a magic string (8 bytes) followed by the same header:
+//
+// header:  K, E, flags (bit 0: reverse complement, bit 1: exclude pseudo, bit 2: edit distance),
+//          value type (0: uint8_t frequency, 1: uint16_t frequency, 2: float mappability, 3: half-precision float
+//          mappability, 4: quantized mappability, see quantizeFrequency(), 5: uint32_t frequency), block size,
+//          number of chromosomes, for each chromosome: length and characters of its name, its length, its offset
+//          number of blocks
+//
+// rle (magic "GMRLE01\0"):
+// offsets: byte offset of each block and of the end of the last block (uint64_t)
+// blocks:  runs of equal values: length of the run, value (as value type, in host byte order)
+// Each chromosome is split into blocks of block size positions (the last one can be shorter), i.e., the values of a
+// position are found by decoding a single block. The offset of a chromosome is the number of its first block.
+//
+// aligned (magic "GMRAW01\0"):
+// values:  the values of each chromosome as an array of the value type (in host byte order), zero padded such that
+//          each chromosome starts at a multiple of rawAlignment bytes
+// The offset of a chromosome is the byte offset of its first value in the file, block size and number of blocks are 0,
+// i.e., a memory mapped file can be indexed directly.
+
+constexpr char rawRleMagic[] = "GMRLE01";
+constexpr uint64_t rawRleBlockSize = 1 << 16; // positions per block
+constexpr char rawAlignedMagic[] = "GMRAW01";
+constexpr uint64_t rawAlignment = 64; // bytes
+
+enum RawValueType
+{
+    frequency8,    // uint8_t
+    frequency16,   // uint16_t
+    mappability32, // float
+    mappability16, // half-precision float
+    mappability8,  // quantized code
+    frequency32    // uint32_t (exact frequencies of --compact-frequencies)
+};
+
+struct RawInfo
+{
+    uint64_t length;
+    uint64_t errors;
+    uint64_t flags;
+    uint64_t valueType;
+    uint64_t blockSize;
+    std::vector<std::string> chromNames;
+    std::vector<uint64_t> chromLengths;
+    std::vector<uint64_t> chromOffsets; // first block (rle) or byte offset of the first value (aligned)
+    uint64_t nbrBlocks;
+};
+
+inline void appendVarint(std::string & buffer, uint64_t value)
+{
+    while (value >= 0x80)
+    {
+        buffer.push_back(static_cast<char>((value & 0x7F) | 0x80));
+        value >>= 7;
+    }
+    buffer.push_back(static_cast<char>(value));
+}
+
+inline void writeRawInfo(std::ostream & out, RawInfo const & info)
+{
+    writeVarint(out, info.length);
+    writeVarint(out, info.errors);
+    writeVarint(out, info.flags);
+    writeVarint(out, info.valueType);
+    writeVarint(out, info.blockSize);
+    writeVarint(out, info.chromNames.size());
+    for (uint64_t i = 0; i < info.chromNames.size(); ++i)
+    {
+        writeVarint(out, info.chromNames[i].size());
+        out.write(info.chromNames[i].data(), info.chromNames[i].size());
+        writeVarint(out, info.chromLengths[i]);
+        writeVarint(out, info.chromOffsets[i]);
+    }
+    writeVarint(out, info.nbrBlocks);
+}
+
+inline bool readRawInfo(std::istream & in, RawInfo & info)
+{
+    uint64_t nbrChromosomes;
+    if (!readVarint(in, info.length) || !readVarint(in, info.errors) || !readVarint(in, info.flags) ||
+        !readVarint(in, info.valueType) || !readVarint(in, info.blockSize) || !readVarint(in, nbrChromosomes) ||
+        info.valueType > RawValueType::frequency32)
+    {
+        return false;
+    }
+
+    info.chromNames.resize(nbrChromosomes);
+    info.chromLengths.resize(nbrChromosomes);
+    info.chromOffsets.resize(nbrChromosomes);
+    for (uint64_t i = 0; i < nbrChromosomes; ++i)
+    {
+        uint64_t nameLength;
+        if (!readVarint(in, nameLength))
+            return false;
+        info.chromNames[i].resize(nameLength);
+        if (!in.read(&info.chromNames[i][0], nameLength) || !readVarint(in, info.chromLengths[i]) ||
+            !readVarint(in, info.chromOffsets[i]))
+        {
+            return false;
+        }
+    }
+    return readVarint(in, info.nbrBlocks);
+}
+
+template <typename T>
+inline uint64_t rawValueType(OutputType const outputType)
+{
+    if (outputType == OutputType::mappability)
+        return RawValueType::mappability32;
+    else if (outputType == OutputType::mappability_half)
+        return RawValueType::mappability16;
+    else if (outputType == OutputType::mappability_quantized)
+        return RawValueType::mappability8;
+    return (sizeof(T) == 1) ? RawValueType::frequency8 : ((sizeof(T) == 2) ? RawValueType::frequency16 : RawValueType::frequency32);
+}
+
+inline uint64_t rawValueSize(uint64_t const valueType)
+{
+    if (valueType == RawValueType::frequency8 || valueType == RawValueType::mappability8)
+        return 1;
+    else if (valueType == RawValueType::frequency16 || valueType == RawValueType::mappability16)
+        return 2;
+    return 4;
+}
+
+// Reads a varint from [data, end) and advances data. Returns false if the varint exceeds end.
+inline bool readVarint(char const * & data, char const * const end, uint64_t & value)
+{
+    value = 0;
+    for (unsigned shift = 0; data != end && shift < 64; shift += 7)
+    {
+        uint8_t const c = *data++;
+        value |= static_cast<uint64_t>(c & 0x7F) << shift;
+        if ((c & 0x80) == 0)
+            return true;
+    }
+    return false;
+}
+
+// Decodes a block of a run-length encoded raw file into `values` (appended, in the value type of the file).
+template <typename TValue>
+inline bool decodeRawRleBlock(char const * data, uint64_t const size, std::vector<TValue> & values)
+{
+    char const * const end = data + size;
+    while (data != end)
+    {
+        uint64_t runLength;
+        if (!readVarint(data, end, runLength) || data + sizeof(TValue) > end)
+            return false;
+        TValue value;
+        std::memcpy(&value, data, sizeof(TValue));
+        data += sizeof(TValue);
+        values.insert(values.end(), runLength, value);
+    }
+    return true;
+}
+
+// Writes c run-length encoded (--raw-format rle). The blocks are encoded in parallel.
+template <typename TContainer, typename TChromosomeNames, typename TChromosomeLengths>
+void saveRawRle(TContainer const & c, std::string const & output_path, TChromosomeNames const & chromNames,
+                TChromosomeLengths const & chromLengths, OutputType const outputType, RawInfo info, unsigned const threads)
+{
+    typedef typename TContainer::value_type T;
+
+    std::vector<OutputChunk> const blocks = outputChunks(c, chromLengths, false, rawRleBlockSize);
+
+    info.valueType = rawValueType<T>(outputType);
+    info.blockSize = rawRleBlockSize;
+    info.chromNames = chromosomeNameStrings(chromNames);
+    info.chromLengths.clear();
+    info.chromOffsets.clear();
+    for (uint64_t i = 0; i < length(chromLengths); ++i)
+        info.chromLengths.push_back(chromLengths[i]);
+    for (uint64_t block = 0; block < blocks.size(); ++block)
+    {
+        if (blocks[block].begin == blocks[block].chromBegin)
+            info.chromOffsets.push_back(block);
+    }
+    info.nbrBlocks = blocks.size();
+
+    std::ofstream out(output_path, std::ios::out | std::ios::binary);
+    out.write(rawRleMagic, sizeof(rawRleMagic));
+    writeRawInfo(out, info);
+
+    // the offsets are written once the blocks have been written
+    uint64_t const offsetsPos = out.tellp();
+    std::vector<uint64_t> offsets(blocks.size() + 1, 0);
+    out.write(reinterpret_cast<char const *>(offsets.data()), offsets.size() * sizeof(uint64_t));
+
+    RawValues<T> const values(outputType);
+
+    auto encode = [&](uint64_t const block, std::string & bytes)
+    {
+        for (uint64_t pos = blocks[block].begin, runEnd; pos < blocks[block].end; pos = runEnd)
+        {
+            for (runEnd = pos + 1; runEnd < blocks[block].end && c[runEnd] == c[pos]; ++runEnd)
+                ;
+            appendVarint(bytes, runEnd - pos);
+            values.append(bytes, c[pos]);
+        }
+    };
+
+    formatChunks(blocks.size(), threads, encode, [&](uint64_t const block, std::string const & bytes) {
+        offsets[block] = out.tellp();
+        out.write(bytes.data(), bytes.size());
+    });
+    offsets.back() = out.tellp();
+
+    out.seekp(offsetsPos);
+    out.write(reinterpret_cast<char const *>(offsets.data()), offsets.size() * sizeof(uint64_t));
+    out.close();
+}
+
+// Writes c with a header and each chromosome aligned to rawAlignment bytes (--raw-format aligned).
+template <typename TContainer, typename TChromosomeNames, typename TChromosomeLengths>
+void saveRawAligned(TContainer const & c, std::string const & output_path, TChromosomeNames const & chromNames,
+                    TChromosomeLengths const & chromLengths, OutputType const outputType, RawInfo info,
+                    unsigned const threads)
+{
+    typedef typename TContainer::value_type T;
+
+    std::vector<OutputChunk> const chunks = outputChunks(c, chromLengths, false);
+
+    info.valueType = rawValueType<T>(outputType);
+    info.blockSize = 0;
+    info.nbrBlocks = 0;
+    info.chromNames = chromosomeNameStrings(chromNames);
+    info.chromLengths.clear();
+    for (uint64_t i = 0; i < length(chromLengths); ++i)
+        info.chromLengths.push_back(chromLengths[i]);
+    uint64_t const valueSize = rawValueSize(info.valueType);
+
+    // the offsets are stored as varints in the header, i.e., the size of the header depends on the offsets
+    std::string header;
+    info.chromOffsets.assign(info.chromLengths.size(), 0);
+    while (true)
+    {
+        std::ostringstream headerStream;
+        headerStream.write(rawAlignedMagic, sizeof(rawAlignedMagic));
+        writeRawInfo(headerStream, info);
+        header = headerStream.str();
+
+        std::vector<uint64_t> offsets(info.chromLengths.size());
+        uint64_t offset = header.size();
+        for (uint64_t i = 0; i < offsets.size(); ++i)
+        {
+            offset = (offset + rawAlignment - 1) / rawAlignment * rawAlignment;
+            offsets[i] = offset;
+            offset += info.chromLengths[i] * valueSize;
+        }
+        if (offsets == info.chromOffsets)
+            break;
+        info.chromOffsets = offsets;
+    }
+
+    char buffer[BUFFER_SIZE];
+    std::ofstream out(output_path, std::ios::out | std::ios::binary);
+    out.rdbuf()->pubsetbuf(buffer, BUFFER_SIZE);
+    out.write(header.data(), header.size());
+    uint64_t written = header.size();
+
+    RawValues<T> const values(outputType);
+
+    auto format = [&](uint64_t const chunk, std::string & bytes)
+    {
+        uint64_t const begin = chunks[chunk].begin;
+        uint64_t const end = chunks[chunk].end;
+        bytes.resize((end - begin) * valueSize);
+        if (end > begin)
+            values.copy(c, begin, end, &bytes[0]);
+    };
+
+    formatChunks(chunks.size(), threads, format, [&](uint64_t const chunk, std::string const & bytes) {
+        if (chunks[chunk].begin == chunks[chunk].chromBegin)
+        {
+            std::string const padding(info.chromOffsets[chunks[chunk].chromosome] - written, '\0');
+            out.write(padding.data(), padding.size());
+            written += padding.size();
+        }
+        out.write(bytes.data(), bytes.size());
+        written += bytes.size();
+    });
+
+    out.close();
+}
+
+// Memory mapped raw file with a header (rle or aligned, see above).
+class RawReader
+{
+public:
+    RawInfo info;
+    bool rle = false;
+
+    RawReader() = default;
+    RawReader(RawReader const &) = delete;
+    RawReader & operator=(RawReader const &) = delete;
+
+    ~RawReader()
+    {
+        close();
+    }
+
+    bool open(std::string const & path)
+    {
+        close();
+
+        std::ifstream file(path, std::ios::in | std::ios::binary);
+        char magic[8];
+        if (!file.read(magic, 8))
+            return false;
+        if (memcmp(magic, rawRleMagic, 8) == 0)
+            rle = true;
+        else if (memcmp(magic, rawAlignedMagic, 8) == 0)
+            rle = false;
+        else
+            return false;
+        if (!readRawInfo(file, info))
+            return false;
+
+        codes.clear();
+        if (info.valueType == RawValueType::mappability16)
+        {
+            codes.resize(std::numeric_limits<uint16_t>::max() + 1);
+            for (uint64_t v = 0; v < codes.size(); ++v)
+                codes[v] = halfToFloat(v);
+        }
+        else if (info.valueType == RawValueType::mappability8)
+        {
+            codes.resize(std::numeric_limits<uint8_t>::max() + 1);
+            for (uint64_t v = 0; v < codes.size(); ++v)
+                codes[v] = dequantizeMappability(v);
+        }
+
+        if (rle)
+        {
+            blockOffsets.resize(info.nbrBlocks + 1);
+            for (uint64_t & offset : blockOffsets)
+            {
+                if (!readUint64(file, offset))
+                    return false;
+            }
+        }
+        file.close();
+
+        int const fd = ::open(path.c_str(), O_RDONLY);
+        if (fd == -1)
+            return false;
+        struct stat st;
+        if (fstat(fd, &st) == 0 && st.st_size > 0)
+        {
+            size = st.st_size;
+            void * const mapping = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+            data = (mapping == MAP_FAILED) ? nullptr : static_cast<char const *>(mapping);
+        }
+        ::close(fd);
+        if (data == nullptr)
+            return false;
+
+        // the offsets have to be within the file
+        uint64_t const valueSize = rawValueSize(info.valueType);
+        for (uint64_t i = 0; i < info.chromLengths.size(); ++i)
+        {
+            if (rle)
+            {
+                if (info.blockSize == 0 ||
+                    info.chromOffsets[i] + (info.chromLengths[i] + info.blockSize - 1) / info.blockSize > info.nbrBlocks)
+                {
+                    return false;
+                }
+            }
+            else if (info.chromOffsets[i] + info.chromLengths[i] * valueSize > size)
+            {
+                return false;
+            }
+        }
+        for (uint64_t block = 0; rle && block < info.nbrBlocks; ++block)
+        {
+            if (blockOffsets[block] > blockOffsets[block + 1] || blockOffsets[block + 1] > size)
+                return false;
+        }
+        return true;
+    }
+
+    void close()
+    {
+        if (data != nullptr)
+            munmap(const_cast<char *>(data), size);
+        data = nullptr;
+        size = 0;
+        blockOffsets.clear();
+    }
+
+    // Calls f(runBegin, runEnd, value) for consecutive runs of positions [runBegin, runEnd) of the chromosome with the
+    // same value, covering [begin, end). TValue has to match info.valueType, end must not exceed the chromosome length.
+    template <typename TValue, typename TFunctor>
+    void forEachRun(uint64_t const chrom, uint64_t const begin, uint64_t const end, TFunctor && f) const
+    {
+        if (!rle)
+        {
+            char const * const values = data + info.chromOffsets[chrom];
+            for (uint64_t pos = begin; pos < end; ++pos)
+            {
+                TValue value;
+                std::memcpy(&value, values + pos * sizeof(TValue), sizeof(TValue));
+                f(pos, pos + 1, value);
+            }
+            return;
+        }
+
+        for (uint64_t block = begin / info.blockSize; block * info.blockSize < end; ++block)
+        {
+            uint64_t const blockId = info.chromOffsets[chrom] + block;
+            char const * blockData = data + blockOffsets[blockId];
+            char const * const blockEnd = data + blockOffsets[blockId + 1];
+            uint64_t pos = block * info.blockSize;
+            uint64_t runLength;
+            while (pos < end && readVarint(blockData, blockEnd, runLength) && blockData + sizeof(TValue) <= blockEnd)
+            {
+                TValue value;
+                std::memcpy(&value, blockData, sizeof(TValue));
+                blockData += sizeof(TValue);
+                if (pos + runLength > begin)
+                    f(std::max(pos, begin), std::min(pos + runLength, end), value);
+                pos += runLength;
+            }
+        }
+    }
+
+    // Value of a position as stored in the file, i.e., decodes half-precision and quantized mappabilities.
+    float value(float const v) const
+    {
+        return v;
+    }
+
+    template <typename TValue>
+    float value(TValue const v) const
+    {
+        return codes.empty() ? v : codes[v];
+    }
+
+private:
+    char const * data = nullptr;
+    uint64_t size = 0;
+    std::vector<uint64_t> blockOffsets; // rle only
+    std::vector<float> codes; // value of each half or code (mappability16 and mappability8 only)
+};
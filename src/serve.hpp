@@ -0,0 +1,507 @@
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <csignal>
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <seqan/arg_parse.h>
+
+using namespace seqan;
+
+// Requests are sent by `genmap client` as a list of `genmap map` arguments, each terminated by '\0'. The client then
+// closes its end for writing. The server responds with a single status character ('0' on success, '1' on failure)
+// followed by the error messages of the request (if any) and closes the connection.
+
+// Kept in a static buffer such that the signal handler can remove the socket file (unlink() is async-signal-safe).
+static char serveSocketPath[sizeof(sockaddr_un::sun_path)];
+
+// Write end of a pipe that wakes up the acceptor once a signal asks the server to shut down, -1 before the server
+// accepts requests (e.g., while the index is loaded), in which case the server exits right away.
+static volatile sig_atomic_t serveStopFd = -1;
+
+void serveSignalHandler(int)
+{
+    if (serveStopFd < 0)
+    {
+        unlink(serveSocketPath);
+        _exit(0);
+    }
+    char const stop = 0;
+    ssize_t const written = write(serveStopFd, &stop, 1); // async-signal-safe as well
+    (void) written;
+}
+
+// Reads until the peer closes its end. With a timeout (in milliseconds) the entire read fails once it takes longer,
+// i.e., also if the peer keeps sending a few bytes at a time.
+inline bool readAll(int const fd, std::string & buffer, int const timeout = -1)
+{
+    auto const deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout);
+    char chunk[4096];
+    while (true)
+    {
+        if (timeout >= 0)
+        {
+            auto const remaining = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now()).count();
+            pollfd pending{fd, POLLIN, 0};
+            int const ready = (remaining > 0) ? poll(&pending, 1, remaining) : 0;
+            if (ready < 0 && errno == EINTR)
+                continue;
+            if (ready <= 0)
+                return false;
+        }
+
+        ssize_t const n = read(fd, chunk, sizeof(chunk));
+        if (n == 0)
+            return true;
+        if (n < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            return false;
+        }
+        buffer.append(chunk, n);
+    }
+}
+
+inline bool writeAll(int const fd, std::string const & buffer)
+{
+    uint64_t written = 0;
+    while (written < buffer.size())
+    {
+        ssize_t const n = write(fd, buffer.data() + written, buffer.size() - written);
+        if (n < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            return false;
+        }
+        written += n;
+    }
+    return true;
+}
+
+// Returns a connected or listening unix domain socket, or -1 on failure.
+inline int openServeSocket(std::string const & path, bool const listening)
+{
+    sockaddr_un address;
+    if (path.size() >= sizeof(address.sun_path))
+    {
+        std::cerr << "ERROR: The socket path " << path << " is too long (at most " << (sizeof(address.sun_path) - 1)
+                  << " characters).\n";
+        return -1;
+    }
+
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    strcpy(address.sun_path, path.c_str());
+
+    int const fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0)
+    {
+        std::cerr << "ERROR: Could not create a socket: " << strerror(errno) << '\n';
+        return -1;
+    }
+
+    if (!listening)
+    {
+        if (connect(fd, reinterpret_cast<sockaddr *>(&address), sizeof(address)) != 0)
+        {
+            std::cerr << "ERROR: Could not connect to " << path << ": " << strerror(errno) << '\n'
+                      << "       Is `genmap serve` running?\n";
+            close(fd);
+            return -1;
+        }
+        return fd;
+    }
+
+    // remove stale sockets from previous runs, but never any other file
+    struct stat st;
+    if (lstat(path.c_str(), &st) == 0)
+    {
+        if (!S_ISSOCK(st.st_mode))
+        {
+            std::cerr << "ERROR: " << path << " already exists and is not a socket.\n";
+            close(fd);
+            return -1;
+        }
+        unlink(path.c_str());
+    }
+
+    if (bind(fd, reinterpret_cast<sockaddr *>(&address), sizeof(address)) != 0 || listen(fd, 64) != 0)
+    {
+        std::cerr << "ERROR: Could not listen on " << path << ": " << strerror(errno) << '\n';
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+// Computes the mappability for a single request on the resident index. Error messages are written to errors, failures
+// of a request must never terminate the server.
+template <typename TSeqNo, typename TSeqPos, typename TIndex, typename TDirectoryInformation>
+inline bool serveRequest(TIndex & index, TDirectoryInformation const & directoryInformation,
+                         Options const & serverOpt, unsigned const serverThreads,
+                         std::vector<std::string> const & args, std::ostream & errors)
+{
+    std::vector<char const *> argv{"genmap map"};
+    for (auto const & arg : args)
+        argv.push_back(arg.c_str());
+
+    ArgumentParser parser("GenMap map");
+    addMappabilityOptions(parser);
+
+    if (parse(parser, argv.size(), argv.data(), errors, errors) != ArgumentParser::PARSE_OK)
+        return false;
+
+    // index related options are inherited from the server
+    Options opt = serverOpt;
+    std::vector<SearchParams> combinations;
+    opt.selectionPath = "";
+    opt.errors = &errors;
+
+    try
+    {
+        if (parseMappabilityOptions(parser, opt, combinations) != ArgumentParser::PARSE_OK ||
+            checkOutputPath(opt) != ArgumentParser::PARSE_OK)
+        {
+            return false;
+        }
+
+        // all requests share the thread pool of the server
+        for (auto & searchParams : combinations)
+            searchParams.threads = std::min(searchParams.threads, serverThreads);
+
+        return runOnIndex<TSeqNo, TSeqPos>(index, directoryInformation, opt, combinations);
+    }
+    catch (std::exception const & e)
+    {
+        errors << "ERROR: " << e.what() << '\n';
+        return false;
+    }
+}
+
+// Number of threads that read requests from accepted connections and maximum number of connections that have been
+// accepted but not read yet (further clients wait in the backlog of the socket).
+static constexpr unsigned serveReaderThreads = 4;
+static constexpr uint64_t serveMaxPendingConnections = 64;
+
+template <typename TSeqNo, typename TSeqPos, typename TIndex, typename TDirectoryInformation>
+inline void serveRequests(TIndex & index, TDirectoryInformation const & directoryInformation,
+                          Options const & opt, std::vector<SearchParams> const & combinations)
+{
+    struct Request
+    {
+        int fd;
+        uint64_t id;
+        std::vector<std::string> args;
+    };
+
+    // all members are guarded by mutex
+    std::mutex mutex;
+    std::condition_variable changed; // a connection or request was queued, a connection was taken or stop was set
+    std::deque<int> connections;     // accepted, but not read yet
+    std::deque<Request> queue;       // read completely, in order of arrival
+    uint64_t requestId = 0;
+    bool stop = false;
+
+    int stopPipe[2];
+    if (pipe(stopPipe) != 0)
+    {
+        std::cerr << "ERROR: Could not create a pipe: " << strerror(errno) << '\n';
+        return;
+    }
+    serveStopFd = stopPipe[1];
+
+    // Connections are accepted in a separate thread, such that clients can queue requests while a computation is
+    // running. It stops once a signal is written to the pipe.
+    std::thread acceptor([&]() {
+        while (true)
+        {
+            pollfd pending[2] = {{opt.serverSocket, POLLIN, 0}, {stopPipe[0], POLLIN, 0}};
+            if (poll(pending, 2, -1) < 0)
+            {
+                if (errno == EINTR)
+                    continue;
+                std::cerr << "ERROR: Could not wait for connections: " << strerror(errno) << '\n';
+                break;
+            }
+            if (pending[1].revents != 0)
+                break;
+
+            int const fd = accept(opt.serverSocket, nullptr, nullptr);
+            if (fd < 0)
+            {
+                if (errno == EINTR || errno == ECONNABORTED)
+                    continue;
+                std::cerr << "ERROR: Could not accept connections: " << strerror(errno) << '\n';
+                break;
+            }
+
+            std::unique_lock<std::mutex> lock(mutex);
+            changed.wait(lock, [&]() { return stop || connections.size() < serveMaxPendingConnections; });
+            connections.push_back(fd);
+            changed.notify_all();
+        }
+
+        std::lock_guard<std::mutex> lock(mutex);
+        stop = true;
+        changed.notify_all();
+    });
+
+    // Requests are read by a fixed number of threads, such that a client that stalls or sends its request slowly
+    // cannot delay the others. A request has to be sent completely within 10 seconds.
+    std::vector<std::thread> readers;
+    for (unsigned t = 0; t < serveReaderThreads; ++t)
+    {
+        readers.emplace_back([&]() {
+            while (true)
+            {
+                int fd;
+                {
+                    std::unique_lock<std::mutex> lock(mutex);
+                    changed.wait(lock, [&]() { return stop || !connections.empty(); });
+                    if (stop)
+                        return;
+                    fd = connections.front();
+                    connections.pop_front();
+                    changed.notify_all();
+                }
+
+                std::string buffer;
+                if (!readAll(fd, buffer, 10000))
+                {
+                    close(fd);
+                    continue;
+                }
+
+                Request request{fd, 0, {}};
+                uint64_t tokenBegin = 0;
+                for (uint64_t i = 0; i < buffer.size(); ++i)
+                {
+                    if (buffer[i] == '\0')
+                    {
+                        request.args.emplace_back(buffer.substr(tokenBegin, i - tokenBegin));
+                        tokenBegin = i + 1;
+                    }
+                }
+
+                std::lock_guard<std::mutex> lock(mutex);
+                request.id = ++requestId;
+                queue.push_back(std::move(request));
+                changed.notify_all();
+            }
+        });
+    }
+
+    std::cout << mytime() << "Waiting for requests on " << serveSocketPath << '\n' << std::flush;
+
+    // Requests are computed one after another, each using the threads of the server (see serveRequest()).
+    while (true)
+    {
+        Request request;
+        uint64_t pending;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            changed.wait(lock, [&]() { return stop || !queue.empty(); });
+            if (stop)
+                break;
+            request = std::move(queue.front());
+            queue.pop_front();
+            pending = queue.size();
+        }
+
+        std::cout << mytime() << "Request " << request.id << " (" << pending << " pending): genmap map";
+        for (auto const & arg : request.args)
+            std::cout << ' ' << arg;
+        std::cout << '\n' << std::flush;
+
+        // error messages are forwarded to the client
+        std::ostringstream errors;
+        double const start = get_wall_time();
+        bool const success = serveRequest<TSeqNo, TSeqPos>(index, directoryInformation, opt, combinations[0].threads,
+                                                           request.args, errors);
+
+        std::cout << mytime() << "Request " << request.id << (success ? " finished" : " failed") << " in "
+                  << (round((get_wall_time() - start) * 100.0) / 100.0) << " seconds\n" << std::flush;
+        if (!success)
+            std::cerr << errors.str();
+
+        writeAll(request.fd, (success ? "0" : "1") + errors.str());
+        close(request.fd);
+    }
+
+    // the current request (if any) has been finished, all others are rejected
+    acceptor.join();
+    for (std::thread & reader : readers)
+        reader.join();
+    for (Request const & request : queue)
+    {
+        writeAll(request.fd, "1ERROR: The server was shut down before the request was computed.\n");
+        close(request.fd);
+    }
+    for (int const fd : connections)
+        close(fd);
+
+    serveStopFd = -1;
+    close(stopPipe[0]);
+    close(stopPipe[1]);
+    std::cout << mytime() << "Shut down\n" << std::flush;
+}
+
+int serveMain(int argc, char const ** argv)
+{
+    // Argument parser
+    ArgumentParser parser("GenMap serve");
+    sharedSetup(parser);
+    addDescription(parser,
+        "Loads an index once and keeps it in memory to compute the mappability for requests sent with `genmap client`. "
+        "Requests are processed one after another using all threads of the server. "
+        "Relative paths in requests are resolved by the client. "
+        "SIGINT and SIGTERM let the running request finish and reject the queued ones.");
+
+    addOption(parser, ArgParseOption("I", "index", "Path to the index", ArgParseArgument::INPUT_FILE, "IN"));
+    setRequired(parser, "index");
+
+    addOption(parser, ArgParseOption("s", "socket", "Path of the unix domain socket to listen on", ArgParseArgument::OUTPUT_FILE, "OUT"));
+    setRequired(parser, "socket");
+
+    addOption(parser, ArgParseOption("m", "memory-mapping",
+        "Turns memory-mapping on, i.e. the index is not loaded into RAM but accessed directly from secondary-memory."));
+
+    addOption(parser, ArgParseOption("T", "threads", "Number of threads shared by all requests", ArgParseArgument::INTEGER, "INT"));
+    setDefaultValue(parser, "threads", omp_get_max_threads());
+
+    addOption(parser, ArgParseOption("v", "verbose", "Outputs some additional information."));
+
+    ArgumentParser::ParseResult res = parse(parser, argc, argv);
+    if (res != ArgumentParser::PARSE_OK)
+        return res == ArgumentParser::PARSE_ERROR;
+
+    // requests only inherit the number of threads, all other search parameters are set per request
+    Options opt;
+    std::vector<SearchParams> combinations(1);
+    CharString socketPath;
+    getOptionValue(opt.indexPath, parser, "index");
+    getOptionValue(socketPath, parser, "socket");
+    getOptionValue(combinations[0].threads, parser, "threads");
+    opt.mmap = isSet(parser, "memory-mapping");
+    opt.verbose = isSet(parser, "verbose");
+
+    if (back(opt.indexPath) != '/')
+        opt.indexPath += '/';
+    opt.indexPath += "index";
+
+    readIndexInformation(opt);
+
+    // bind the socket before loading the index such that clients can already queue requests
+    opt.serverSocket = openServeSocket(toCString(socketPath), true);
+    if (opt.serverSocket < 0)
+        return ArgumentParser::PARSE_ERROR;
+
+    strcpy(serveSocketPath, toCString(socketPath));
+    std::signal(SIGINT, serveSignalHandler);
+    std::signal(SIGTERM, serveSignalHandler);
+    std::signal(SIGPIPE, SIG_IGN); // clients that disconnect early must not terminate the server
+
+    if (opt.verbose)
+        printIndexInformation(opt);
+
+    bool success;
+    if (opt.alphabet == "dna4")
+        success = run<Dna>(opt, combinations);
+    else
+        success = run<Dna5>(opt, combinations);
+
+    unlink(serveSocketPath);
+    return !success;
+}
+
+int clientMain(int argc, char const ** argv)
+{
+    // Argument parser
+    ArgumentParser parser("GenMap client");
+    sharedSetup(parser);
+    addDescription(parser,
+        "Sends a mappability computation to a running `genmap serve` process and waits for it to finish. "
+        "Accepts the same arguments as `genmap map` except for the index related ones.");
+
+    addOption(parser, ArgParseOption("s", "socket", "Path of the unix domain socket of `genmap serve`", ArgParseArgument::INPUT_FILE, "IN"));
+    setRequired(parser, "socket");
+
+    addMappabilityOptions(parser);
+
+    ArgumentParser::ParseResult res = parse(parser, argc, argv);
+    if (res != ArgumentParser::PARSE_OK)
+        return res == ArgumentParser::PARSE_ERROR;
+
+    CharString socketPath;
+    getOptionValue(socketPath, parser, "socket");
+
+    char cwd[4096];
+    if (getcwd(cwd, sizeof(cwd)) == nullptr)
+    {
+        std::cerr << "ERROR: Could not retrieve the current working directory.\n";
+        return ArgumentParser::PARSE_ERROR;
+    }
+
+    auto absolutePath = [&cwd](std::string path) {
+        if (!path.empty() && path[0] != '/')
+            path = std::string(cwd) + '/' + path;
+        return path;
+    };
+
+    // Forwards all options except the socket as parsed, i.e., independent of how they were written on the command line
+    // (e.g., -O x, -Ox, --output=x). Paths are made absolute since the server runs in a different directory.
+    std::string request;
+    for (ArgParseOption const & option : parser.optionMap)
+    {
+        if (!isSet(option) || option.longName == "socket")
+            continue;
+
+        std::string const name = option.longName.empty() ? "-" + option.shortName : "--" + option.longName;
+        if (isBooleanOption(option))
+        {
+            request += name + '\0';
+            continue;
+        }
+
+        bool const isPath = isInputFileArgument(option) || isOutputFileArgument(option) ||
+                            isInputPrefixArgument(option) || isOutputPrefixArgument(option);
+        std::vector<std::string> const & values = getArgumentValues(option);
+        unsigned const valuesPerOccurrence = std::max<unsigned>(1, numberOfAllowedValues(option));
+        for (uint64_t i = 0; i < values.size(); i += valuesPerOccurrence)
+        {
+            request += name + '\0';
+            for (uint64_t j = i; j < std::min<uint64_t>(i + valuesPerOccurrence, values.size()); ++j)
+                request += (isPath ? absolutePath(values[j]) : values[j]) + '\0';
+        }
+    }
+
+    int const fd = openServeSocket(toCString(socketPath), false);
+    if (fd < 0)
+        return ArgumentParser::PARSE_ERROR;
+
+    std::string response;
+    if (!writeAll(fd, request) || shutdown(fd, SHUT_WR) != 0 || !readAll(fd, response) || response.empty())
+    {
+        std::cerr << "ERROR: The connection to the server was lost.\n";
+        close(fd);
+        return ArgumentParser::PARSE_ERROR;
+    }
+    close(fd);
+
+    std::cerr << response.substr(1);
+    return response[0] != '0';
+}
@@ -1,6 +1,8 @@
 #include <gtest/gtest.h>
 
 #include <chrono>
+#include <functional>
+#include <set>
 
 #include <seqan/arg_parse.h>
 #include <seqan/seq_io.h>
@@ -10,6 +12,9 @@ static constexpr bool outputProgress = false;
 
 #include "../src/common.hpp"
 #include "../src/algo.hpp"
+#include "../src/output.hpp"
+#include "../src/bigwig.hpp"
+#include "../src/compact_frequencies.hpp"
 
 using namespace seqan;
 
@@ -209,6 +214,718 @@ void test(uint64_t const nbrChromosomes, uint64_t const lengthChromosomes, uint6
     }
 }
 
+// Random genome of nbrChromosomes sequences of the same length, its index and the chromosome lengths needed by
+// computeMappability(). If repeatLength > 0, lengthChromosomes / 100 random infixes of each sequence are copied to
+// random positions of the same sequence (reverse complemented if reverseComplementRepeats).
+template <typename TChar>
+struct GenomeFixture
+{
+    typedef StringSet<String<TChar>, Owner<ConcatDirect<> > > TGenome;
+    typedef Index<TGenome, TBiIndexConfig<TGemMapFastFMIndexConfig<uint32_t> > > TIndex;
+
+    TGenome genome;
+    TIndex index; // refers to genome, hence the fixture cannot be copied
+    // TODO: replace with stringSetLimits
+    StringSet<uint64_t> chromLengths, chromCumLengths; // needed for localization and reset
+
+    GenomeFixture(uint64_t const nbrChromosomes, uint64_t const lengthChromosomes, uint64_t const repeatLength = 0,
+                  bool const reverseComplementRepeats = false) :
+        genome(randomGenome(nbrChromosomes, lengthChromosomes, repeatLength, reverseComplementRepeats)),
+        index(genome)
+    {
+        indexCreate(index, FibreSALF());
+
+        uint64_t cumLength = 0;
+        appendValue(chromCumLengths, 0);
+        for (uint64_t ss = 0; ss < nbrChromosomes; ++ss)
+        {
+            appendValue(chromLengths, lengthChromosomes);
+            cumLength += lengthChromosomes;
+            appendValue(chromCumLengths, cumLength);
+        }
+    }
+
+    GenomeFixture(GenomeFixture const &) = delete;
+    GenomeFixture & operator=(GenomeFixture const &) = delete;
+
+    static TGenome randomGenome(uint64_t const nbrChromosomes, uint64_t const lengthChromosomes,
+                                uint64_t const repeatLength, bool const reverseComplementRepeats)
+    {
+        TGenome genome;
+        for (uint64_t ss = 0; ss < nbrChromosomes; ++ss)
+        {
+            String<TChar> chr;
+            randomText(chr, rng, lengthChromosomes);
+            for (uint64_t r = 0; repeatLength > 0 && r < lengthChromosomes / 100; ++r)
+            {
+                uint64_t const src = rng() % (lengthChromosomes - repeatLength), dest = rng() % (lengthChromosomes - repeatLength);
+                String<TChar> repeat = infixWithLength(chr, src, repeatLength);
+                if (reverseComplementRepeats)
+                    reverseComplement(repeat);
+                for (uint64_t i = 0; i < repeatLength; ++i)
+                    chr[dest + i] = repeat[i];
+            }
+            appendValue(genome, chr);
+        }
+        return genome;
+    }
+};
+
+typedef Pair<uint16_t, uint32_t> TTestLocation;
+typedef std::map<TTestLocation, std::pair<std::vector<TTestLocation>, std::vector<TTestLocation> > > TTestLocations;
+
+// Frequencies of a single (K, E) combination computed by computeMappability() on the entire text of index. The locations
+// are only collected with csvComputation.
+template <unsigned errors, typename TDistance = HammingDistance, typename TLocations = TTestLocations, typename TIndex,
+          typename TText, typename TChromosomeLengths>
+std::vector<uint8_t> computeFrequencies(TIndex & index, TText const & text, TChromosomeLengths const & chromLengths,
+                                        TChromosomeLengths const & chromCumLengths, SearchParams const & searchParams,
+                                        TLocations * locations = nullptr, bool const csvComputation = false)
+{
+    std::vector<uint8_t> frequency(length(text), 0);
+    TLocations noLocations;
+    std::vector<uint16_t> mappingSeqIdFile(0);
+    std::vector<std::pair<uint64_t, uint64_t> > intervals;
+    bool completeSameKmers;
+    computeMappability<errors, TDistance>(index, text, frequency, searchParams, false /*dir*/, chromLengths, chromCumLengths,
+                                          (locations != nullptr) ? *locations : noLocations, mappingSeqIdFile, intervals,
+                                          completeSameKmers, 1/*currentFileNo*/, 1/*totalFileNo*/, csvComputation);
+    return frequency;
+}
+
+// Edit distance between a k-mer and a text infix where the first and last characters of the k-mer have to be aligned
+// to the first and last characters of the infix (i.e., no indels at the ends). N never matches.
+template <typename TNeedle, typename TInfix>
+unsigned restrictedEditDistance(TNeedle const & needle, TInfix const & infix)
+{
+    using TChar = typename Value<TNeedle>::Type;
+    auto cost = [](TChar const a, TChar const b)
+    {
+        return static_cast<unsigned>(!ordEqual(a, b) || (std::is_same<TChar, Dna5>::value && a == Dna5('N')));
+    };
+
+    uint64_t const n = length(needle) - 2, m = length(infix) - 2; // inner parts
+    std::vector<std::vector<unsigned> > d(n + 1, std::vector<unsigned>(m + 1));
+    for (uint64_t i = 0; i <= n; ++i)
+        d[i][0] = i;
+    for (uint64_t j = 0; j <= m; ++j)
+        d[0][j] = j;
+    for (uint64_t i = 1; i <= n; ++i)
+        for (uint64_t j = 1; j <= m; ++j)
+            d[i][j] = std::min({d[i - 1][j] + 1, d[i][j - 1] + 1, d[i - 1][j - 1] + cost(needle[i], infix[j])});
+
+    return cost(needle[0], infix[0]) + d[n][m] + cost(needle[n + 1], infix[m + 1]);
+}
+
+// counts the begin positions of all occurrences with up to `errors` edits (each begin position is only counted once)
+template <typename TText, typename TNeedle>
+uint64_t countEditOccurrences(TText const & text, TNeedle const & needle, unsigned const errors)
+{
+    uint64_t const k = length(needle);
+    uint64_t frequency = 0;
+    for (uint64_t seq = 0; seq < length(text); ++seq)
+    {
+        for (uint64_t p = 0; p < length(text[seq]); ++p)
+        {
+            for (uint64_t l = std::max<uint64_t>(2, k - errors); l <= k + errors && p + l <= length(text[seq]); ++l)
+            {
+                if (restrictedEditDistance(needle, infix(text[seq], p, p + l)) <= errors)
+                {
+                    ++frequency;
+                    break;
+                }
+            }
+        }
+    }
+    return frequency;
+}
+
+template <typename TChar, unsigned errors>
+void testEdit(uint64_t const nbrChromosomes, uint64_t const lengthChromosomes,
+              uint32_t const maxFrequency = std::numeric_limits<uint32_t>::max())
+{
+    GenomeFixture<TChar> fixture(nbrChromosomes, lengthChromosomes);
+    auto & index = fixture.index;
+    auto const & text = indexText(index).concat;
+    uint64_t const totalLength = seqan::length(text);
+
+    for (uint64_t k = errors + 2; k <= 8; ++k)
+    {
+        SearchParams searchParams;
+        searchParams.length = k;
+        searchParams.overlap = k - 1;
+        searchParams.threads = omp_get_num_threads();
+        searchParams.revCompl = rng() % 2;
+        searchParams.excludePseudo = false;
+        searchParams.maxFrequency = maxFrequency;
+
+        std::vector<uint8_t> frequencyTrivial(totalLength, 0);
+        uint64_t global_pos = 0;
+        for (uint64_t seq = 0; seq < nbrChromosomes; ++seq)
+        {
+            for (uint64_t i = 0; i + k <= lengthChromosomes; ++i, ++global_pos)
+            {
+                auto const & needle = infix(fixture.genome[seq], i, i + k);
+                uint64_t hits = countEditOccurrences(fixture.genome, needle, errors);
+                if (searchParams.revCompl)
+                {
+                    String<TChar> needleRevCompl(needle);
+                    reverseComplement(needleRevCompl);
+                    hits += countEditOccurrences(fixture.genome, needleRevCompl, errors);
+                }
+                frequencyTrivial[global_pos] = std::min<uint64_t>({hits, maxFrequency, 255});
+            }
+            global_pos += k - 1;
+        }
+
+        EXPECT_EQ(frequencyTrivial, (computeFrequencies<errors, EditDistance>(index, text, fixture.chromLengths,
+                                                                              fixture.chromCumLengths, searchParams)));
+    }
+}
+
+TEST(GenMapAlgo, edit_1_dna4)
+{
+    testEdit<Dna, 1>(2, 150);
+}
+
+TEST(GenMapAlgo, edit_2_dna4)
+{
+    testEdit<Dna, 2>(2, 150);
+}
+
+TEST(GenMapAlgo, edit_2_dna5)
+{
+    testEdit<Dna5, 2>(2, 150);
+}
+
+TEST(GenMapAlgo, edit_max_frequency_dna4)
+{
+    testEdit<Dna, 2>(2, 150, 3);
+}
+
+// short k-mers with errors mostly exceed the largest frequency of uint8_t, i.e., their search ends early
+TEST(GenMapAlgo, edit_saturated_dna4)
+{
+    testEdit<Dna, 1>(8, 200);
+}
+
+// computes several (K, E) combinations in a single call to computeMappability()
+template <typename TChar>
+void testSweep(uint64_t const nbrChromosomes, uint64_t const lengthChromosomes)
+{
+    GenomeFixture<TChar> fixture(nbrChromosomes, lengthChromosomes);
+    auto & index = fixture.index;
+    auto const & text = indexText(index).concat;
+    uint64_t const totalLength = seqan::length(text);
+
+    std::vector<std::pair<unsigned, unsigned> > const parameters{{4, 0}, {6, 1}, {8, 2}, {8, 0}, {5, 0}, {7, 0}}; // (K, E)
+    std::vector<std::vector<uint8_t> > frequencyGenMap(parameters.size(), std::vector<uint8_t>(totalLength, 0));
+    std::vector<TTestLocations> locations(parameters.size());
+    std::vector<MappabilityCombination<std::vector<uint8_t>, TTestLocations> > combinations;
+    bool const revCompl = rng() % 2;
+    for (uint64_t i = 0; i < parameters.size(); ++i)
+    {
+        SearchParams searchParams;
+        searchParams.length = parameters[i].first;
+        searchParams.errors = parameters[i].second;
+        searchParams.overlap = parameters[i].second + 2;
+        searchParams.threads = omp_get_num_threads();
+        searchParams.revCompl = revCompl;
+        searchParams.excludePseudo = false;
+        combinations.push_back({searchParams, frequencyGenMap[i], locations[i], false});
+    }
+
+    std::vector<uint16_t> mappingSeqIdFile(0);
+    std::vector<std::pair<uint64_t, uint64_t> > intervals;
+    computeMappability(index, text, combinations, false /*dir*/, fixture.chromLengths, fixture.chromCumLengths, mappingSeqIdFile,
+                       intervals, 1/*currentFileNo*/, 1/*totalFileNo*/, false /*csvComputation*/);
+
+    for (uint64_t i = 0; i < parameters.size(); ++i)
+    {
+        std::vector<uint8_t> frequencyTrivial(totalLength, 0);
+        computeMappabilityTrivial<HammingDistance, TChar>(index, frequencyTrivial, combinations[i].params, parameters[i].second);
+        EXPECT_EQ(frequencyTrivial, frequencyGenMap[i]);
+    }
+}
+
+// the frequencies have to be identical for any number of threads (frequencies of exact repeats are propagated concurrently)
+template <typename TChar, unsigned errors>
+void testDeterministic(uint64_t const nbrChromosomes, uint64_t const lengthChromosomes)
+{
+    // plant repeats such that many frequencies are propagated to other occurrences
+    GenomeFixture<TChar> fixture(nbrChromosomes, lengthChromosomes, 50);
+    auto & index = fixture.index;
+    auto const & text = indexText(index).concat;
+
+    SearchParams searchParams;
+    searchParams.length = 12;
+    searchParams.errors = errors;
+    searchParams.overlap = errors + 2;
+    searchParams.revCompl = true;
+    searchParams.excludePseudo = false;
+
+    std::vector<std::vector<uint8_t> > frequencies;
+    for (unsigned const threads : {1u, 2u, 4u, 8u})
+    {
+        searchParams.threads = threads;
+        frequencies.push_back(computeFrequencies<errors>(index, text, fixture.chromLengths, fixture.chromCumLengths, searchParams));
+    }
+
+    for (uint64_t i = 1; i < frequencies.size(); ++i)
+        EXPECT_EQ(frequencies[0], frequencies[i]);
+}
+
+TEST(GenMapAlgo, deterministic_dna4)
+{
+    testDeterministic<Dna, 2>(4, 5000);
+}
+
+TEST(GenMapAlgo, deterministic_dna5)
+{
+    testDeterministic<Dna5, 1>(4, 5000);
+}
+
+// --overlap auto: the pilot run (forced by short sampled regions) must not leave any frequencies of the sampled regions
+// behind, i.e., the frequencies computed with the chosen overlap have to be identical to the trivial ones
+template <typename TChar, unsigned errors>
+void testAutoOverlap(uint64_t const nbrChromosomes, uint64_t const lengthChromosomes)
+{
+    GenomeFixture<TChar> fixture(nbrChromosomes, lengthChromosomes, 50);
+    auto & index = fixture.index;
+    auto const & text = indexText(index).concat;
+    uint64_t const totalLength = seqan::length(text);
+
+    SearchParams searchParams;
+    searchParams.length = 12;
+    searchParams.errors = errors;
+    searchParams.overlap = errors + 2;
+    searchParams.threads = 4;
+    searchParams.revCompl = true;
+    searchParams.excludePseudo = false;
+    searchParams.autoOverlap = true;
+    searchParams.pilotRegionLength = 16;
+    // the pilot run is skipped for texts shorter than 100 times the sampled k-mers (16 regions for 4 threads)
+    ASSERT_GE(totalLength, searchParams.length + 100 * 16 * searchParams.pilotRegionLength);
+
+    std::vector<uint8_t> frequencyGenMap(totalLength, 0);
+    TTestLocations locations;
+    std::vector<MappabilityCombination<std::vector<uint8_t>, TTestLocations> > combinations{{searchParams, frequencyGenMap, locations, false}};
+    std::vector<uint16_t> mappingSeqIdFile(0);
+    std::vector<std::pair<uint64_t, uint64_t> > intervals;
+    computeMappability(index, text, combinations, false /*dir*/, fixture.chromLengths, fixture.chromCumLengths, mappingSeqIdFile,
+                       intervals, 1/*currentFileNo*/, 1/*totalFileNo*/, false /*csvComputation*/);
+
+    std::vector<uint8_t> frequencyTrivial(totalLength, 0);
+    computeMappabilityTrivial<HammingDistance, TChar>(index, frequencyTrivial, combinations[0].params, errors);
+    EXPECT_EQ(frequencyTrivial, frequencyGenMap);
+}
+
+TEST(GenMapAlgo, auto_overlap_dna4)
+{
+    testAutoOverlap<Dna, 2>(4, 8000);
+}
+
+TEST(GenMapAlgo, auto_overlap_dna5)
+{
+    testAutoOverlap<Dna5, 1>(4, 8000);
+}
+
+// --max-frequency: the search ends early, but the frequencies have to be the frequencies of a full search capped at N
+template <typename TChar, unsigned errors>
+void testMaxFrequency(uint64_t const nbrChromosomes, uint64_t const lengthChromosomes)
+{
+    // plant repeats such that some k-mers reach the cap without errors
+    GenomeFixture<TChar> fixture(nbrChromosomes, lengthChromosomes, 20);
+    auto & index = fixture.index;
+    auto const & text = indexText(index).concat;
+    uint64_t const totalLength = seqan::length(text);
+
+    std::vector<uint8_t> frequencyTrivial(totalLength);
+
+    for (uint64_t k = errors + 3; k <= 10; ++k)
+    {
+        SearchParams searchParams;
+        searchParams.length = k;
+        searchParams.overlap = errors + 2;
+        searchParams.threads = omp_get_num_threads();
+        searchParams.revCompl = rng() % 2;
+        searchParams.excludePseudo = false;
+
+        frequencyTrivial.assign(totalLength, 0);
+        computeMappabilityTrivial<HammingDistance, TChar>(index, frequencyTrivial, searchParams, errors);
+
+        for (uint32_t const maxFrequency : {1u, 3u, 20u})
+        {
+            searchParams.maxFrequency = maxFrequency;
+
+            std::vector<uint8_t> frequencyCapped(frequencyTrivial);
+            for (uint8_t & v : frequencyCapped)
+                v = std::min<uint32_t>(v, maxFrequency);
+
+            EXPECT_EQ(frequencyCapped, computeFrequencies<errors>(index, text, fixture.chromLengths, fixture.chromCumLengths,
+                                                                  searchParams));
+        }
+    }
+}
+
+TEST(GenMapAlgo, max_frequency_dna4)
+{
+    testMaxFrequency<Dna, 2>(2, 1000);
+}
+
+TEST(GenMapAlgo, max_frequency_dna5)
+{
+    testMaxFrequency<Dna5, 1>(2, 1000);
+}
+
+// The mappability computed on an index that contains the reverse complements of all sequences (genmap index
+// --double-strand) has to be identical to searching the reverse complements separately.
+template <typename TChar, unsigned errors>
+void testDoubleStrand(uint64_t const nbrChromosomes, uint64_t const lengthChromosomes)
+{
+    // plant reverse complemented repeats
+    GenomeFixture<TChar> fixture(nbrChromosomes, lengthChromosomes, 50, true);
+    auto & index = fixture.index;
+
+    typename GenomeFixture<TChar>::TGenome genomeDoubleStrand = fixture.genome;
+    for (uint64_t ss = 0; ss < nbrChromosomes; ++ss)
+    {
+        String<TChar> chr = fixture.genome[ss];
+        reverseComplement(chr);
+        appendValue(genomeDoubleStrand, chr);
+    }
+
+    typename GenomeFixture<TChar>::TIndex indexDoubleStrand(genomeDoubleStrand);
+    indexCreate(indexDoubleStrand, FibreSALF());
+    auto const & text = indexText(index).concat;
+    uint64_t const totalLength = seqan::length(text);
+    auto const & textDoubleStrand = infixWithLength(indexText(indexDoubleStrand).concat, 0, totalLength);
+
+    SearchParams searchParams;
+    searchParams.length = 12;
+    searchParams.errors = errors;
+    searchParams.overlap = errors + 2;
+    searchParams.threads = 4;
+    searchParams.excludePseudo = false;
+
+    TTestLocations locations, locationsDoubleStrand;
+
+    searchParams.revCompl = true;
+    std::vector<uint8_t> const frequency = computeFrequencies<errors>(index, text, fixture.chromLengths, fixture.chromCumLengths,
+                                                                      searchParams, &locations, true /*csvComputation*/);
+
+    searchParams.revCompl = false;
+    searchParams.doubleStrand = true;
+    std::vector<uint8_t> const frequencyDoubleStrand = computeFrequencies<errors>(indexDoubleStrand, textDoubleStrand, fixture.chromLengths,
+                                                                                  fixture.chromCumLengths, searchParams,
+                                                                                  &locationsDoubleStrand, true /*csvComputation*/);
+
+    EXPECT_EQ(frequency, frequencyDoubleStrand);
+    EXPECT_EQ(locations, locationsDoubleStrand);
+
+    // --csv-classes: a k-mer and its reverse complement share a repeat class, i.e., every position refers to a class with
+    // its locations and no class is written without a position referring to it
+    CsvLocations<TTestLocation> classes;
+    classes.init(true, true /*deduplicate*/, searchParams.threads, 1ull << 20);
+    computeFrequencies<errors>(indexDoubleStrand, textDoubleStrand, fixture.chromLengths, fixture.chromCumLengths,
+                               searchParams, &classes, true /*csvComputation*/);
+
+    std::map<uint64_t, typename TTestLocations::mapped_type> locationsOfClass;
+    classes.forEachClass([&locationsOfClass](uint64_t const repeatClass, auto const & fwd, auto const & rev) {
+        EXPECT_TRUE(locationsOfClass.emplace(repeatClass, std::make_pair(fwd, rev)).second);
+    });
+    std::set<uint64_t> referencedClasses;
+    TTestLocations locationsOfPositions;
+    classes.forEachPosition([&](TTestLocation const & location, uint64_t const repeatClass) {
+        ASSERT_TRUE(locationsOfClass.count(repeatClass));
+        locationsOfPositions.emplace(location, locationsOfClass[repeatClass]);
+        referencedClasses.insert(repeatClass);
+    });
+    classes.clear();
+
+    EXPECT_EQ(locationsDoubleStrand, locationsOfPositions);
+    EXPECT_EQ(locationsOfClass.size(), referencedClasses.size());
+}
+
+TEST(GenMapAlgo, double_strand_dna4)
+{
+    testDoubleStrand<Dna, 2>(4, 5000);
+}
+
+TEST(GenMapAlgo, double_strand_dna5)
+{
+    testDoubleStrand<Dna5, 1>(4, 5000);
+}
+
+// Locations collected by several threads and spilled to temporary files have to be merged into the same sorted
+// output as inserting them into a std::map.
+TEST(GenMapAlgo, csv_locations)
+{
+    using TLocation = Pair<uint16_t, uint32_t>;
+    using TLocations = CsvLocations<TLocation>;
+    using TEntry = std::pair<TLocation, typename TLocations::mapped_type>;
+
+    std::vector<TLocation> keys;
+    for (uint64_t i = 0; i < 20000; ++i)
+        keys.emplace_back(rng() % 10, rng() % 1000); // with duplicates
+
+    // the locations only depend on the repeat class
+    auto classOf = [](TLocation const & key) { return static_cast<uint64_t>(key.i2 % 15); };
+    auto entryOf = [](uint64_t const repeatClass)
+    {
+        typename TLocations::mapped_type entry;
+        for (uint64_t i = 0; i < repeatClass % 5; ++i)
+            entry.first.emplace_back(repeatClass, i);
+        for (uint64_t i = 0; i < repeatClass % 3; ++i)
+            entry.second.emplace_back(repeatClass + 1, i);
+        return entry;
+    };
+
+    std::map<TLocation, typename TLocations::mapped_type> expected;
+    for (auto const & key : keys)
+        expected.emplace(key, entryOf(classOf(key)));
+
+    for (uint64_t const memoryBudget : {4096ull, 1ull << 20, 1ull << 30})
+    {
+        for (bool const deduplicate : {false, true})
+        {
+            TLocations locations;
+            locations.init(true, deduplicate, 4, memoryBudget);
+            #pragma omp parallel for schedule(dynamic, 64) num_threads(4)
+            for (uint64_t i = 0; i < keys.size(); ++i)
+                insertLocation(locations, keys[i], entryOf(classOf(keys[i])), classOf(keys[i]));
+
+            std::vector<TEntry> merged;
+            if (deduplicate)
+            {
+                std::map<uint64_t, typename TLocations::mapped_type> classes;
+                locations.forEachClass([&classes](uint64_t const repeatClass, auto const & fwd, auto const & rev) {
+                    EXPECT_TRUE(classes.emplace(repeatClass, std::make_pair(fwd, rev)).second);
+                });
+                locations.forEachPosition([&merged, &classes](auto const & key, uint64_t const repeatClass) {
+                    merged.emplace_back(key, classes.at(repeatClass));
+                });
+            }
+            else
+            {
+                locations.forEach([&merged](auto const & key, auto const & fwd, auto const & rev) {
+                    merged.emplace_back(key, std::make_pair(fwd, rev));
+                });
+            }
+            locations.clear();
+
+            EXPECT_EQ(std::vector<TEntry>(expected.begin(), expected.end()), merged);
+        }
+    }
+}
+
+// Frequencies of 255 and more are stored in the overflow table by several threads at once. get() has to return them
+// exactly and [] saturated to the value type, exact frequencies (uint32_t) are written as they are.
+TEST(GenMapAlgo, compact_frequencies)
+{
+    uint64_t const size = 1 << 16;
+    auto frequencyOf = [](uint64_t const pos) { return static_cast<uint32_t>(pos * 3); }; // up to 196605
+
+    CompactFrequencies<uint16_t> c;
+    c.resize(size);
+    #pragma omp parallel for schedule(dynamic, 64) num_threads(4)
+    for (uint64_t pos = 0; pos < size; ++pos)
+        storeFrequency(c, pos, frequencyOf(pos));
+
+    uint64_t overflow = 0;
+    for (uint64_t pos = 0; pos < size; ++pos)
+    {
+        EXPECT_EQ(frequencyOf(pos), c.get(pos));
+        EXPECT_EQ(frequencyOf(pos), loadFrequency(c, pos));
+        EXPECT_EQ(std::min<uint32_t>(frequencyOf(pos), std::numeric_limits<uint16_t>::max()), c[pos]);
+        overflow += frequencyOf(pos) >= 255;
+    }
+    EXPECT_EQ(overflow, c.overflowSize());
+
+    std::string text;
+    ValueTexts<uint32_t> const values(OutputType::frequency_large);
+    for (uint32_t const frequency : {0u, 255u, 65536u, std::numeric_limits<uint32_t>::max()})
+    {
+        text.clear();
+        values.append(text, frequency);
+        EXPECT_EQ(std::to_string(frequency), text);
+    }
+}
+
+// Reads a little-endian number of a bigWig file.
+template <typename TValue>
+TValue bigWigRead(std::string const & file, uint64_t const offset)
+{
+    uint64_t bits = 0;
+    for (unsigned i = 0; i < sizeof(TValue); ++i)
+        bits |= static_cast<uint64_t>(static_cast<uint8_t>(file.at(offset + i))) << (8 * i);
+    TValue value;
+    std::memcpy(&value, &bits, sizeof(TValue));
+    return value;
+}
+
+// The chromosome B+ tree, the R-tree and the blocks of the bigWig file have to contain the same items as the bedgraph
+// file. More than 256 chromosomes resp. blocks require inner nodes in both trees.
+TEST(GenMapOutput, bigwig)
+{
+    typedef std::tuple<std::string, uint32_t, uint32_t, float> TItem;
+
+    std::vector<std::string> chromNames;
+    std::vector<uint64_t> chromLengths;
+    std::vector<uint16_t> frequencies;
+    for (uint64_t i = 0; i < 300; ++i)
+    {
+        chromNames.push_back("chr" + std::to_string(i)); // not sorted lexicographically
+        chromLengths.push_back(1 + rng() % 4000);
+        for (uint64_t pos = 0; pos < chromLengths.back(); ++pos)
+            frequencies.push_back(rng() % 4);
+    }
+
+    char const * tmpDir = std::getenv("TMPDIR");
+    std::string const path = std::string(tmpDir != nullptr ? tmpDir : "/tmp") + "/genmap_test_bigwig";
+    saveBedGraph(frequencies, path, chromNames, chromLengths, true, OutputType::frequency_large, 4);
+    saveBigWig(frequencies, path, chromNames, chromLengths, OutputType::frequency_large, 4);
+
+    std::vector<TItem> expected;
+    {
+        std::ifstream bedgraphFile(path + ".bedgraph");
+        TItem item;
+        while (bedgraphFile >> std::get<0>(item) >> std::get<1>(item) >> std::get<2>(item) >> std::get<3>(item))
+            expected.push_back(item);
+    }
+    std::string file;
+    {
+        std::ifstream bigwigFile(path + ".bw", std::ios::in | std::ios::binary);
+        file.assign(std::istreambuf_iterator<char>(bigwigFile), std::istreambuf_iterator<char>());
+    }
+    std::remove((path + ".bedgraph").c_str());
+    std::remove((path + ".bw").c_str());
+
+    ASSERT_EQ(bigWigMagic, bigWigRead<uint32_t>(file, 0));
+    ASSERT_EQ(bigWigMagic, bigWigRead<uint32_t>(file, file.size() - 4));
+    uint64_t const chromTreeOffset = bigWigRead<uint64_t>(file, 8);
+    uint64_t const fullDataOffset = bigWigRead<uint64_t>(file, 16);
+    uint64_t const fullIndexOffset = bigWigRead<uint64_t>(file, 24);
+    uint32_t const uncompressBufSize = bigWigRead<uint32_t>(file, 52);
+
+    // chromosome B+ tree: the leaves in order have to be the sorted chromosome names with ascending ids
+    ASSERT_EQ(bigWigChromTreeMagic, bigWigRead<uint32_t>(file, chromTreeOffset));
+    uint32_t const chromBlockSize = bigWigRead<uint32_t>(file, chromTreeOffset + 4);
+    uint32_t const keySize = bigWigRead<uint32_t>(file, chromTreeOffset + 8);
+    EXPECT_EQ(256u, chromBlockSize);
+    EXPECT_EQ(8u, bigWigRead<uint32_t>(file, chromTreeOffset + 12));
+    EXPECT_EQ(chromNames.size(), bigWigRead<uint64_t>(file, chromTreeOffset + 16));
+
+    std::vector<std::pair<std::string, uint32_t> > chromosomes; // name and length by id
+    std::function<void(uint64_t, std::string const &)> readChromNode = [&](uint64_t const offset, std::string const & firstKey)
+    {
+        bool const isLeaf = bigWigRead<uint8_t>(file, offset);
+        uint16_t const count = bigWigRead<uint16_t>(file, offset + 2);
+        ASSERT_GT(count, 0u);
+        ASSERT_LE(count, chromBlockSize);
+        for (uint64_t child = 0; child < count; ++child)
+        {
+            uint64_t const entry = offset + 4 + child * (keySize + 8);
+            std::string key = file.substr(entry, keySize);
+            key.resize(std::strlen(key.c_str()));
+            if (child == 0 && !firstKey.empty())
+            {
+                EXPECT_EQ(firstKey, key); // an inner node stores the first key of each child
+            }
+            if (isLeaf)
+            {
+                EXPECT_EQ(chromosomes.size(), bigWigRead<uint32_t>(file, entry + keySize));
+                chromosomes.emplace_back(key, bigWigRead<uint32_t>(file, entry + keySize + 4));
+            }
+            else
+            {
+                readChromNode(bigWigRead<uint64_t>(file, entry + keySize), key);
+            }
+        }
+    };
+    readChromNode(chromTreeOffset + 32, "");
+    ASSERT_EQ(chromNames.size(), chromosomes.size());
+    for (uint64_t i = 0; i < chromNames.size(); ++i)
+    {
+        auto const it = std::lower_bound(chromosomes.begin(), chromosomes.end(), std::make_pair(chromNames[i], uint32_t{0}));
+        ASSERT_TRUE(it != chromosomes.end() && it->first == chromNames[i]);
+        EXPECT_EQ(chromLengths[i], it->second);
+    }
+
+    // R-tree: the leaves in order have to refer to the blocks in order, the blocks contain the items of the bedgraph
+    // file (sorted by the chromosome ids)
+    ASSERT_EQ(bigWigIndexMagic, bigWigRead<uint32_t>(file, fullIndexOffset));
+    uint64_t const nbrBlocks = bigWigRead<uint64_t>(file, fullDataOffset);
+    EXPECT_GT(nbrBlocks, bigWigIndexBlockSize);
+    EXPECT_EQ(nbrBlocks, bigWigRead<uint64_t>(file, fullIndexOffset + 8));
+
+    std::vector<TItem> items;
+    uint64_t nbrLeafEntries = 0;
+    std::function<void(uint64_t)> readIndexNode = [&](uint64_t const offset)
+    {
+        bool const isLeaf = bigWigRead<uint8_t>(file, offset);
+        uint16_t const count = bigWigRead<uint16_t>(file, offset + 2);
+        ASSERT_GT(count, 0u);
+        ASSERT_LE(count, bigWigIndexBlockSize);
+        for (uint64_t child = 0; child < count; ++child)
+        {
+            uint64_t const entry = offset + 4 + child * (isLeaf ? 32 : 24);
+            if (!isLeaf)
+            {
+                readIndexNode(bigWigRead<uint64_t>(file, entry + 16));
+                continue;
+            }
+
+            std::string block = file.substr(bigWigRead<uint64_t>(file, entry + 16), bigWigRead<uint64_t>(file, entry + 24));
+            if (uncompressBufSize > 0)
+            {
+#if SEQAN_HAS_ZLIB
+                std::string uncompressed(uncompressBufSize, 0);
+                uLongf size = uncompressed.size();
+                ASSERT_EQ(Z_OK, uncompress(reinterpret_cast<Bytef *>(&uncompressed[0]), &size,
+                                           reinterpret_cast<Bytef const *>(block.data()), block.size()));
+                uncompressed.resize(size);
+                block.swap(uncompressed);
+#else
+                FAIL() << "Blocks are only compressed with zlib.";
+#endif
+            }
+
+            uint32_t const chromId = bigWigRead<uint32_t>(block, 0);
+            EXPECT_EQ(chromId, bigWigRead<uint32_t>(file, entry));     // start chromosome
+            EXPECT_EQ(chromId, bigWigRead<uint32_t>(file, entry + 8)); // end chromosome
+            EXPECT_EQ(bigWigRead<uint32_t>(block, 4), bigWigRead<uint32_t>(file, entry + 4));  // start
+            EXPECT_EQ(bigWigRead<uint32_t>(block, 8), bigWigRead<uint32_t>(file, entry + 12)); // end
+            EXPECT_EQ(1u, bigWigRead<uint8_t>(block, 20)); // bedGraph items
+            uint16_t const nbrItems = bigWigRead<uint16_t>(block, 22);
+            ASSERT_EQ(24u + nbrItems * 12u, block.size());
+            for (uint64_t item = 0; item < nbrItems; ++item)
+            {
+                items.emplace_back(chromosomes[chromId].first, bigWigRead<uint32_t>(block, 24 + item * 12),
+                                   bigWigRead<uint32_t>(block, 28 + item * 12), bigWigRead<float>(block, 32 + item * 12));
+            }
+            ++nbrLeafEntries;
+        }
+    };
+    readIndexNode(fullIndexOffset + 48);
+    EXPECT_EQ(nbrBlocks, nbrLeafEntries);
+
+    std::sort(expected.begin(), expected.end(), [](TItem const & a, TItem const & b) {
+        return std::make_tuple(std::get<0>(a), std::get<1>(a)) < std::make_tuple(std::get<0>(b), std::get<1>(b));
+    });
+    EXPECT_EQ(expected, items);
+}
+
+TEST(GenMapAlgo, sweep_dna4)
+{
+    testSweep<Dna>(3, 1000);
+}
+
+TEST(GenMapAlgo, sweep_dna5)
+{
+    testSweep<Dna5>(3, 1000);
+}
+
 TEST(GenMapAlgo, exact_dna4)
 {
     test<Dna, HammingDistance, 0>(3, 1000, 1);
@@ -234,6 +951,11 @@ TEST(GenMapAlgo, hamming_4_dna4)
     test<Dna, HammingDistance, 4>(3, 1000, 1);
 }
 
+TEST(GenMapAlgo, hamming_5_dna4)
+{
+    test<Dna, HammingDistance, 5>(3, 1000, 1);
+}
+
 TEST(GenMapAlgo, exact_dna5)
 {
     test<Dna5, HammingDistance, 0>(3, 1000, 1);
@@ -259,6 +981,11 @@ TEST(GenMapAlgo, hamming_4_dna5)
     test<Dna5, HammingDistance, 4>(3, 1000, 1);
 }
 
+TEST(GenMapAlgo, hamming_5_dna5)
+{
+    test<Dna5, HammingDistance, 5>(3, 1000, 1);
+}
+
 int main(int argc, char ** argv)
 {
     auto now = std::chrono::system_clock::now();
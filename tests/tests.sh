@@ -16,6 +16,12 @@ INDEX_FLAGS=$4
 FLAGS=$5
 EXPECTED_FOLDER=$6
 
+# INDEX_FLAGS can contain additional flags for the indexer after -F or -FD, e.g., "-F -ds"
+INDEX_EXTRA_FLAGS=""
+case "$INDEX_FLAGS" in
+    *" "*) INDEX_EXTRA_FLAGS="${INDEX_FLAGS#* }"; INDEX_FLAGS="${INDEX_FLAGS%% *}";;
+esac
+
 # Add -S argument for computing a subset of the mappability vector if a bed file exists
 if [ -f "${SRCDIR}/tests/test_cases/case_${CASE}/subset.bed" ]; then
     FLAGS="$FLAGS -S ${SRCDIR}/tests/test_cases/case_${CASE}/subset.bed"
@@ -35,9 +41,9 @@ cd "$MYTMP"
 [ $? -eq 0 ] || errorout "Could not cd to tmp"
 
 if [ "$INDEX_FLAGS" = "-FD" ]; then
-    ${BINDIR}/bin/genmap index -FD "${SRCDIR}/tests/test_cases/case_${CASE}" -I "${MYTMP}/index" -A skew
+    ${BINDIR}/bin/genmap index -FD "${SRCDIR}/tests/test_cases/case_${CASE}" -I "${MYTMP}/index" -A skew ${INDEX_EXTRA_FLAGS}
 else
-    ${BINDIR}/bin/genmap index -F "${SRCDIR}/tests/test_cases/case_${CASE}/genome.fa" -I "${MYTMP}/index" -A divsufsort
+    ${BINDIR}/bin/genmap index -F "${SRCDIR}/tests/test_cases/case_${CASE}/genome.fa" -I "${MYTMP}/index" -A divsufsort ${INDEX_EXTRA_FLAGS}
 fi
 
 ${BINDIR}/bin/genmap map -I "${MYTMP}/index" -O "${MYTMP}/output" ${FLAGS}
@@ -51,6 +57,201 @@ if [ "$CASE" != "1e" ] && [ "$CASE" != "1f" ] && [ "$CASE" != "1g" ]; then
     [ $? -eq 0 ] || errorout "Files are not equal!"
 fi
 
+# computing and writing each chromosome on its own (--window-size) has to yield the same output files
+if [ "$EXPECTED_FOLDER" != "csv" ]; then
+    rm -r "${MYTMP}/output" && mkdir -p "${MYTMP}/output"
+    ${BINDIR}/bin/genmap map -I "${MYTMP}/index" -O "${MYTMP}/output" ${FLAGS} -ws 1
+    diff -r --strip-trailing-cr "${SRCDIR}/tests/test_cases/case_${CASE}/${EXPECTED_FOLDER}" "${MYTMP}/output"
+    [ $? -eq 0 ] || errorout "Files are not equal!"
+fi
+
+# windows with several chromosomes each (chr1-2, chr3-4, chr5 for -ws 400) have to yield the same output files as no
+# windows. Repeats are planted across windows (chr1 into chr4 and chr5, the reverse complement of chr2 into chr3).
+if [ "$EXPECTED_FOLDER" != "csv" ] && [ ! -f "${SRCDIR}/tests/test_cases/case_${CASE}/subset.bed" ]; then
+    awk 'BEGIN { srand(42); split("200 150 300 100 250", len, " ")
+                 for (c = 1; c <= 5; ++c) { s[c] = ""; for (i = 0; i < len[c]; ++i) s[c] = s[c] substr("ACGT", int(rand() * 4) + 1, 1) }
+                 r = substr(s[1], 21, 40); s[4] = substr(s[4], 1, 10) r substr(s[4], 51); s[5] = substr(s[5], 1, 100) r substr(s[5], 141)
+                 r = ""; for (i = 40; i >= 1; --i) r = r substr("TGCA", index("ACGT", substr(s[2], i, 1)), 1)
+                 s[3] = substr(s[3], 1, 50) r substr(s[3], 91)
+                 for (c = 1; c <= 5; ++c) print ">chr" c "\n" s[c] }' > "${MYTMP}/windows.fa"
+    ${BINDIR}/bin/genmap index -F "${MYTMP}/windows.fa" -I "${MYTMP}/windows_index" -A divsufsort ${INDEX_EXTRA_FLAGS}
+    mkdir -p "${MYTMP}/windows_expected" "${MYTMP}/windows_output"
+    ${BINDIR}/bin/genmap map -I "${MYTMP}/windows_index" -O "${MYTMP}/windows_expected" ${FLAGS}
+    ${BINDIR}/bin/genmap map -I "${MYTMP}/windows_index" -O "${MYTMP}/windows_output" ${FLAGS} -ws 400
+    diff -r "${MYTMP}/windows_expected" "${MYTMP}/windows_output"
+    [ $? -eq 0 ] || errorout "Files with windows of several chromosomes are not equal!"
+    rm -r "${MYTMP}/windows.fa" "${MYTMP}/windows_index" "${MYTMP}/windows_expected" "${MYTMP}/windows_output"
+fi
+
+# memory mapped frequencies (the raw file itself with -r -fs/-fl) have to yield the same output files
+if [ "$EXPECTED_FOLDER" != "csv" ]; then
+    rm -r "${MYTMP}/output" && mkdir -p "${MYTMP}/output"
+    TMPDIR="${MYTMP}" ${BINDIR}/bin/genmap map -I "${MYTMP}/index" -O "${MYTMP}/output" ${FLAGS} -mf
+    diff -r --strip-trailing-cr "${SRCDIR}/tests/test_cases/case_${CASE}/${EXPECTED_FOLDER}" "${MYTMP}/output"
+    [ $? -eq 0 ] || errorout "Files are not equal!"
+fi
+
+# compact frequencies (one byte per position and an overflow table) have to yield the same output files, except for the
+# raw files of -fl which store the exact frequencies with 32 bit (.freq32). -fs cannot be combined with -cf.
+if [ "$EXPECTED_FOLDER" = "raw_freq8" ] || [ "$EXPECTED_FOLDER" = "txt_freq8" ]; then
+    ! ${BINDIR}/bin/genmap map -I "${MYTMP}/index" -O "${MYTMP}/output" ${FLAGS} -cf 2> /dev/null || errorout "-cf was accepted with -fs!"
+elif [ "$EXPECTED_FOLDER" != "csv" ]; then
+    rm -r "${MYTMP}/output" && mkdir -p "${MYTMP}/output"
+    ${BINDIR}/bin/genmap map -I "${MYTMP}/index" -O "${MYTMP}/output" ${FLAGS} -cf
+    if [ "$EXPECTED_FOLDER" = "raw_freq16" ]; then
+        [ `ls "${MYTMP}"/output/*.freq32 | wc -l` -eq `ls "${SRCDIR}/tests/test_cases/case_${CASE}/${EXPECTED_FOLDER}"/*.freq16 | wc -l` ] || errorout "Missing .freq32 files!"
+        for f in "${MYTMP}"/output/*.freq32; do
+            expected="${SRCDIR}/tests/test_cases/case_${CASE}/${EXPECTED_FOLDER}/$(basename "${f%.freq32}").freq16"
+            od -An -v -tu2 "$expected" | tr -s ' ' '\n' | sed '/^$/d' > "${MYTMP}/freq.expected"
+            od -An -v -tu4 "$f" | tr -s ' ' '\n' | sed '/^$/d' > "${MYTMP}/freq.out"
+            diff "${MYTMP}/freq.expected" "${MYTMP}/freq.out"
+            [ $? -eq 0 ] || errorout "Exact frequencies are not equal!"
+            rm "${MYTMP}/freq.expected" "${MYTMP}/freq.out"
+        done
+    else
+        diff -r --strip-trailing-cr "${SRCDIR}/tests/test_cases/case_${CASE}/${EXPECTED_FOLDER}" "${MYTMP}/output"
+        [ $? -eq 0 ] || errorout "Files are not equal!"
+    fi
+fi
+
+# the binary locations output converted to csv has to be identical to the csv output
+if [ "$EXPECTED_FOLDER" = "csv" ]; then
+    rm -r "${MYTMP}/output" && mkdir -p "${MYTMP}/output"
+    FLAGS_BINARY=`echo "${FLAGS}" | sed 's/ -d\( \|$\)/ -db\1/'`
+    ${BINDIR}/bin/genmap map -I "${MYTMP}/index" -O "${MYTMP}/output" ${FLAGS_BINARY}
+    for f in "${MYTMP}"/output/*.loc; do
+        # the last k-mer looked up via the index of the file, malformed k-mers have to be rejected
+        expected="${SRCDIR}/tests/test_cases/case_${CASE}/${EXPECTED_FOLDER}/$(basename "${f%.loc}").csv"
+        kmer=`tail -n 1 "$expected" | cut -d ';' -f 1`
+        if [ "$kmer" != "\"k-mer\"" ]; then
+            ${BINDIR}/bin/genmap locations -I "$f" -k "$kmer" > "${MYTMP}/kmer.csv"
+            (head -n 1 "$expected" && tail -n 1 "$expected") | diff --strip-trailing-cr - "${MYTMP}/kmer.csv"
+            [ $? -eq 0 ] || errorout "Locations of a single k-mer are not equal!"
+        fi
+        for kmer in "0," ",5" "0,1,2" "99999999999999999999,0"; do
+            ! ${BINDIR}/bin/genmap locations -I "$f" -k "$kmer" 2> /dev/null || errorout "Malformed k-mer was accepted!"
+        done
+        ${BINDIR}/bin/genmap locations -I "$f" -O "${f%.loc}.csv" && rm "$f"
+        [ $? -eq 0 ] || errorout "Could not convert binary locations file!"
+    done
+    diff -r --strip-trailing-cr "${SRCDIR}/tests/test_cases/case_${CASE}/${EXPECTED_FOLDER}" "${MYTMP}/output"
+    [ $? -eq 0 ] || errorout "Files are not equal!"
+fi
+
+# the deduplicated csv output (the classes of .kmers.csv replaced by their locations in .classes.csv) has to be identical
+# to the csv output
+if [ "$EXPECTED_FOLDER" = "csv" ]; then
+    rm -r "${MYTMP}/output" && mkdir -p "${MYTMP}/output"
+    FLAGS_CLASSES=`echo "${FLAGS}" | sed 's/ -d\( \|$\)/ -dc\1/'`
+    ${BINDIR}/bin/genmap map -I "${MYTMP}/index" -O "${MYTMP}/output" ${FLAGS_CLASSES}
+    for f in "${MYTMP}"/output/*.kmers.csv; do
+        classes="${f%.kmers.csv}.classes.csv"
+        awk -F ';' 'NR == FNR { if (FNR == 1) header = substr($0, index($0, ";")); else locations[$1] = substr($0, index($0, ";")); next }
+                    FNR == 1 { print "\"k-mer\"" header; next }
+                    { print $1 locations[$2] }' "$classes" "$f" > "${f%.kmers.csv}.csv"
+        [ $? -eq 0 ] || errorout "Could not join the csv classes!"
+        rm "$f" "$classes"
+    done
+    diff -r --strip-trailing-cr "${SRCDIR}/tests/test_cases/case_${CASE}/${EXPECTED_FOLDER}" "${MYTMP}/output"
+    [ $? -eq 0 ] || errorout "Files are not equal!"
+fi
+
+# genmap query on raw files with a header has to yield the statistics of each sequence of the txt output
+if [ "$EXPECTED_FOLDER" = "txt_freq16" ]; then
+    for RAW_FORMAT in aligned rle; do
+        rm -r "${MYTMP}/output" && mkdir -p "${MYTMP}/output"
+        ${BINDIR}/bin/genmap map -I "${MYTMP}/index" -O "${MYTMP}/output" ${FLAGS} -rf ${RAW_FORMAT}
+        for f in "${MYTMP}"/output/*.txt; do
+            raw="${f%.txt}.freq16.raw"
+            [ "$RAW_FORMAT" = "rle" ] && raw="${f%.txt}.freq16.rle"
+            awk '/^>/ { name = substr($0, 2); next } { print name "\t0\t" NF }' "$f" > "${MYTMP}/query.bed"
+            awk '/^>/ { name = substr($0, 2); next }
+                 { min = ""; max = ""; sum = 0; count = 0
+                   for (i = 1; i <= NF; ++i) { if (min == "" || $i < min) min = $i; if (max == "" || $i > max) max = $i; sum += $i; if ($i >= 2) ++count }
+                   if (NF == 0) print name "\t0\t0\tNA\tNA\tNA\t0"; else print name "\t0\t" NF "\t" min "\t" max "\t" sum / NF "\t" count }' "$f" > "${MYTMP}/query.expected"
+            ${BINDIR}/bin/genmap query -I "$raw" -B "${MYTMP}/query.bed" -t 2 -O "${MYTMP}/query.out"
+            diff "${MYTMP}/query.expected" "${MYTMP}/query.out"
+            [ $? -eq 0 ] || errorout "Query results are not equal!"
+            ${BINDIR}/bin/genmap query -I "$raw" -B "${MYTMP}/query.bed" -t 2 -O "${MYTMP}/query.out" -s "${MYTMP}/query.sum" -cs -sb 2
+            diff "${MYTMP}/query.expected" "${MYTMP}/query.out"
+            [ $? -eq 0 ] || errorout "Query results with summaries are not equal!"
+        done
+    done
+    rm -r "${MYTMP}/output" && mkdir -p "${MYTMP}/output"
+fi
+
+# half-precision and quantized mappabilities have to be close to 1 / frequency of the txt output (quantized frequencies
+# above 191 are binned)
+if [ "$EXPECTED_FOLDER" = "txt_freq16" ]; then
+    for MAPPABILITY_TYPE in -mh -mq; do
+        rm -r "${MYTMP}/output" && mkdir -p "${MYTMP}/output"
+        FLAGS_MAPPABILITY=`echo "${FLAGS}" | sed 's/ -fl\( \|$\)/ '"${MAPPABILITY_TYPE}"'\1/'`
+        ${BINDIR}/bin/genmap map -I "${MYTMP}/index" -O "${MYTMP}/output" ${FLAGS_MAPPABILITY}
+        for f in "${SRCDIR}/tests/test_cases/case_${CASE}/${EXPECTED_FOLDER}"/*.txt; do
+            paste -d ' ' "$f" "${MYTMP}/output/$(basename "$f")" | awk '/^>/ { next }
+                { for (i = 1; i <= NF / 2; ++i) { v = $i; x = $(i + NF / 2); tolerance = (v > 191) ? 0.1 : 0.002
+                      if ((v == 0 && x != 0) || (v != 0 && (x * v - 1 > tolerance || 1 - x * v > tolerance))) exit 1 } }'
+            [ $? -eq 0 ] || errorout "Mappabilities are not equal to 1 / frequency!"
+        done
+    done
+    rm -r "${MYTMP}/output" && mkdir -p "${MYTMP}/output"
+fi
+
+# the unique mask (search ends with the second occurrence) has to mark the positions with a frequency of 1 of the txt
+# output, each chromosome starting at a new byte
+if [ "$EXPECTED_FOLDER" = "txt_freq16" ]; then
+    rm -r "${MYTMP}/output" && mkdir -p "${MYTMP}/output"
+    FLAGS_MASK=`echo "${FLAGS}" | sed 's/ -t -fl\( \|$\)/ -um\1/'`
+    ${BINDIR}/bin/genmap map -I "${MYTMP}/index" -O "${MYTMP}/output" ${FLAGS_MASK}
+    for f in "${SRCDIR}/tests/test_cases/case_${CASE}/${EXPECTED_FOLDER}"/*.txt; do
+        out="${MYTMP}/output/$(basename "${f%.txt}")"
+        awk '/^>/ { name = substr($0, 2); next }
+             { begin = -1
+               for (i = 1; i <= NF + 1; ++i) { u = (i <= NF && $i == 1)
+                   if (u && begin < 0) begin = i - 1
+                   if (!u && begin >= 0) { print name "\t" begin "\t" i - 1; begin = -1 } } }' "$f" > "${MYTMP}/unique.bed"
+        diff "${MYTMP}/unique.bed" "${out}.unique.bed"
+        [ $? -eq 0 ] || errorout "Unique intervals are not equal!"
+        awk '/^>/ { next }
+             { for (b = 0; b * 8 < NF; ++b) { byte = 0
+                   for (j = 0; j < 8 && b * 8 + j < NF; ++j) if ($(b * 8 + j + 1) == 1) byte += 2 ^ j
+                   print byte } }' "$f" > "${MYTMP}/unique.mask"
+        od -An -v -tu1 "${out}.unique.mask" | tr -s ' ' '\n' | sed '/^$/d' > "${MYTMP}/unique.mask.out"
+        diff "${MYTMP}/unique.mask" "${MYTMP}/unique.mask.out"
+        [ $? -eq 0 ] || errorout "Unique masks are not equal!"
+    done
+    rm -r "${MYTMP}/output" && mkdir -p "${MYTMP}/output"
+fi
+
+# requests sent by genmap client to genmap serve (running in a different directory) have to yield the same output files,
+# relative paths are resolved by the client (in whatever form they are passed). An invalid request has to fail without
+# terminating the server.
+rm -r "${MYTMP}/output" && mkdir -p "${MYTMP}/output"
+FLAGS_CLIENT="${FLAGS}"
+if [ -f "${SRCDIR}/tests/test_cases/case_${CASE}/subset.bed" ]; then
+    cp "${SRCDIR}/tests/test_cases/case_${CASE}/subset.bed" "${MYTMP}/subset.bed"
+    FLAGS_CLIENT=`echo "${FLAGS}" | sed 's/ -S [^ ]*/ --selection=subset.bed/'`
+fi
+(cd / && exec ${BINDIR}/bin/genmap serve -I "${MYTMP}/index" -s "${MYTMP}/serve.sock") &
+SERVER=$!
+for i in `seq 1 100`; do
+    [ -S "${MYTMP}/serve.sock" ] && break
+    sleep 0.1
+done
+INVALID=0
+${BINDIR}/bin/genmap client -s "${MYTMP}/serve.sock" -O output ${FLAGS_CLIENT} -K 1 2> "${MYTMP}/client.err" || INVALID=$?
+VALID=0
+${BINDIR}/bin/genmap client -s "${MYTMP}/serve.sock" --output=output ${FLAGS_CLIENT} || VALID=$?
+# the server shuts down cleanly on SIGTERM, i.e., it joins its threads, removes the socket and exits with 0
+SERVER_STATUS=0
+kill ${SERVER} && wait ${SERVER} || SERVER_STATUS=$?
+[ ${SERVER_STATUS} -eq 0 ] && [ ! -e "${MYTMP}/serve.sock" ] || errorout "genmap serve did not shut down cleanly!"
+[ ${INVALID} -ne 0 ] && grep -q "ERROR: K has to be at least" "${MYTMP}/client.err" || errorout "Invalid request did not fail!"
+[ ${VALID} -eq 0 ] || errorout "Request to genmap serve failed!"
+diff -r --strip-trailing-cr "${SRCDIR}/tests/test_cases/case_${CASE}/${EXPECTED_FOLDER}" "${MYTMP}/output"
+[ $? -eq 0 ] || errorout "Files are not equal!"
+rm -f "${MYTMP}/subset.bed" "${MYTMP}/client.err"
+
 testnumber=`echo ${CASE} | cut -c1-1` # 1g -> 1 (retrieves the first character of ${CASE})
 
 if [ "$testnumber" != "1" ]; then